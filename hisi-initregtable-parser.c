@@ -19,7 +19,8 @@
  * Hisi-initregtable-parser
  * janne kaikkonen (c) 2020
  *
- * Build: gcc -Wall -g hisi-initregtable-parser.c -o hisi-initregtable-parser
+ * Build: make
+ *    or: gcc -Wall -g -pthread hisi-initregtable-parser.c hisi-initregtable.c -o hisi-initregtable-parser   (without built in SoCs)
  * Usage: call the program without parameters to see usage with examples
  *
  * 
@@ -32,6 +33,10 @@
  * Soc address space CSV file format(First Line omited)
  * BASE,     , END(OPT),   NAME
  * 0x00000000, 0xFFFFFFFF, REGISTER BASE
+ * - END is inclusive. END smaller than BASE(ie. 0x0) makes the range open ended.
+ * - Overlapping ranges are allowed. The range with the closest BASE wins.
+ * - Addresses outside every range are shown as (UNMAPPED).
+ * - NAME can be of any length. Empty lines are skipped.
  *
  *
  * Init register table:
@@ -161,45 +166,29 @@
 
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stddef.h>
 #include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
 
-#define SOC_REGISTER_NAME_LENGTH 15
-
-typedef struct{
-    uint32_t base_address;
-    uint32_t end_address;
-    char register_name[SOC_REGISTER_NAME_LENGTH];
-} soc_register_type;
-
-
-/* TODO add exclusion method(based on end address if set) and return -1 if no register matches */
-
-int32_t get_register_index(uint32_t address, size_t number_of_registers, const soc_register_type *table){
-    uint32_t temp;
-    uint32_t closest_register_index = 0;
-    uint32_t distance = UINT32_MAX;
-    for(uint32_t i = 0; i<number_of_registers; i++){
-        if(table[i].base_address <= address){               //Check that base address is smaller or equal to address 
-            temp = (address - table[i].base_address);
-            if(temp < distance){                            //Compare distances
-                closest_register_index = i;                 //We have found the closest register base
-                distance = temp;
-            }
-        }
-    }
-    return closest_register_index;                          //Return the register base index that was closest
-}
-
+#include "hisi-initregtable.h"
 
 /* SoC */
 
 typedef struct{
-    soc_register_type *soc_type_registers;
+    const soc_register_type *soc_type_registers;
     size_t soc_type_registers_count;
     char *soc_type_parameter_str;
+    const soc_register_index_type *soc_type_registers_index;   //Index laid out at build time. NULL = indexed at load time
 } soc_type;
 
 
@@ -212,86 +201,321 @@ const soc_register_type none_registers[] = {
     }
 };
 
-/* CSV import SoC */
-soc_register_type *csv_soc_registers_ptr = NULL;
+/* Shown for addresses that don't belong to any register base */
+const soc_register_type unmapped_register = {
+    0x0,
+    UINT32_MAX,
+    "(UNMAPPED)"
+};
+
+
+/*
+ * Built in SoCs. "make" generates soc-tables.h from every CSV file in csv/ with soc-tablegen(pre-sorted registers and prebuilt index).
+ * SoC type name is the CSV file name without ".csv"(ie. hi3516a_d). "csv" SoC type still overrides with any CSV file at run time.
+ */
+#ifdef BUILTIN_SOC_TABLES
+#include "soc-tables.h"
+#else
+#define SOC_TABLES_LIST
+#endif
 
 
-/* Soc List. Keep "none" and "csv" SoCs in their places in this list */
-soc_type soc_list[] = {
+/* Soc List. Keep "none" and "csv" SoCs in their places in this list. "csv" registers are imported at load time */
+#define SOC_TYPE_INDEX_NONE 0
+#define SOC_TYPE_INDEX_CSV 1
+
+const soc_type soc_list[] = {
     {
-        (soc_register_type*)&none_registers,
+        none_registers,
         (sizeof(none_registers)/sizeof(soc_register_type)),
-        "none"
+        "none",
+        NULL
     },
     {
         NULL,
         0,
-        "csv"
-    }
+        "csv",
+        NULL
+    },
+    SOC_TABLES_LIST
 };
 
 
-/* OPTIONAL PARAMETERS */
+/* Compiled -filter expression(see ROW FILTER) */
+typedef struct{
+    uint32_t op;                            //ROW_FILTER_OP_*
+    uint32_t field;                         //ROW_FILTER_FIELD_* of range op, region term bit of region op
+    uint32_t low;                           //Range op: field in [low, high]. Flags and errors ops: mask in low
+    uint32_t high;
+} row_filter_op_type;
+
+typedef struct{
+    row_filter_op_type *ops;                //Postfix program. NULL = every row is shown
+    uint32_t ops_count;
+    uint64_t *region_masks;                 //Per register index(unmapped last): bit n set if register matches region term n
+} row_filter_type;
+
+/* Loaded SoC. Read only after load_soc() so that it can be shared by concurrent parses */
+typedef struct{
+    const soc_register_type *registers;
+    size_t registers_count;
+    soc_register_index_type registers_index;
+    soc_register_type *csv_registers;       //Imported registers owned by this map. NULL for built in SoCs
+    char *csv_names;                        //Name arena of imported registers
+    void *map_file_ptr;                     //mmap() of SoC map file. Names and index segments point here. NULL if imported from CSV
+    size_t map_file_length;
+    uint32_t registers_index_static;        //Index segments are not owned(built in index or map file)
+    register_field_map_type fields;         //Register field map. Empty if not loaded
+    register_field_type *field_entries;
+    char *field_names;
+    row_filter_type row_filter;             //Compiled -filter. Empty if not given
+} soc_map_type;
+
+/* Returns register base the address belongs to. last_hit is lookup cache owned by the caller */
+static inline const soc_register_type *soc_map_lookup(const soc_map_type *soc, uint32_t address, uint32_t *last_hit){
+    int32_t register_index = get_register_index(address, &soc->registers_index, last_hit);
+    return ((register_index >= 0) ? &soc->registers[register_index] : &unmapped_register);
+}
+
 
-uint32_t color_enabled = 1;
-uint32_t print_offset = 0;
-uint32_t addresses_only = 0;
-uint32_t no_address = 0;
+/* OPTIONAL PARAMETERS */
 
 #define ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_DETECTED_ERRORS_COUNT 1      //Just print error count
 #define ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS 2               //Print errors
 
-uint32_t attribute_validity_output_format = ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS;
-uint32_t number_of_attribute_validity_errors_to_print = 1;
-uint32_t print_how_many_attribute_validity_errors_omited = 1;
+#define OUTPUT_FORMAT_TEXT 0                                          //Human readable rows
+#define OUTPUT_FORMAT_NDJSON 1                                        //-format=ndjson(see MACHINE READABLE ROWS)
+#define OUTPUT_FORMAT_CSV 2                                           //-format=csv
+
+typedef struct{
+    uint32_t color_enabled;
+    uint32_t print_offset;
+    uint32_t addresses_only;
+    uint32_t no_address;
+    uint32_t attribute_validity_output_format;
+    uint32_t number_of_attribute_validity_errors_to_print;
+    uint32_t print_how_many_attribute_validity_errors_omited;
+    uint32_t jobs;                          //Worker threads of -batch and large ranges. 0 = one per online cpu
+    char *output_directory;                 //Batch output directory. NULL = combined stdout
+    uint32_t diff_summary_only;             //Diff and optimization print only counts
+    char *seed_filename;                    //Simulation register dump. NULL = registers read as 0
+    char *clock_model_filename;             //Timing clock model. NULL = built in model
+    uint32_t timing_top_rows;               //Timing lists this many most expensive rows, autodetect this many best maps
+    char *map_cache_directory;              //SoC map files. NULL = next to CSV file
+    uint32_t map_cache_disabled;            //Always import CSV. Map files are not read or written
+    char *field_map_filename;               //Register field map. NULL = rows are not decoded to fields
+    char *maps_directory;                   //Autodetect scores CSV files of this directory too
+    uint32_t stop_at_null;                  //Stop parsing after the first terminating null entry
+    char *fingerprint_index_filename;       //Known tables. NULL = tables are not fingerprinted
+    char *fingerprint_label;                //Label of tables added to fingerprint index. NULL = source file name
+    uint32_t cluster_threshold;             //Percent of similarity joining tables to the same cluster
+    char *filter_expression;                //Rows shown. NULL = every row(see ROW FILTER)
+    uint32_t output_format;                 //OUTPUT_FORMAT_*
+} parse_options_type;
+
+const parse_options_type default_parse_options = {
+    1,
+    0,
+    0,
+    0,
+    ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS,
+    1,
+    1,
+    0,
+    NULL,
+    0,
+    NULL,
+    NULL,
+    10,
+    NULL,
+    0,
+    NULL,
+    NULL,
+    0,
+    NULL,
+    NULL,
+    80,
+    NULL,
+    OUTPUT_FORMAT_TEXT
+};
+
 
+#define OPTIONAL_PARAMETER_FLAG 0           //Set option to new value
+#define OPTIONAL_PARAMETER_NUMBER 1         //"-parameter=123". Set option to number
+#define OPTIONAL_PARAMETER_STRING 2         //"-parameter=text". Set option(char*) to text
 
 typedef struct{
-    uint32_t *variable_to_alter_ptr;
-    uint32_t variable_new_value;
+    size_t option_offset;                   //offsetof(parse_options_type, ...)
+    uint32_t option_new_value;
     char *parameter_str;
+    uint32_t parameter_value_type;
 } optional_parameter_type;
 
 const optional_parameter_type optional_parameter_list[] = {
     {
-        &color_enabled,
+        offsetof(parse_options_type, color_enabled),
         0,
-        "-nocolor"
+        "-nocolor",
+        OPTIONAL_PARAMETER_FLAG
     },
     {
-        &addresses_only,
+        offsetof(parse_options_type, addresses_only),
         1,
-        "-addronly"
+        "-addronly",
+        OPTIONAL_PARAMETER_FLAG
     },
     {
-        &no_address,
+        offsetof(parse_options_type, no_address),
         1,
-        "-noaddress"
+        "-noaddress",
+        OPTIONAL_PARAMETER_FLAG
     },
     {
-        &print_offset,
+        offsetof(parse_options_type, print_offset),
         1,
-        "-printoffset"
+        "-printoffset",
+        OPTIONAL_PARAMETER_FLAG
     },
     {
-        &attribute_validity_output_format,
+        offsetof(parse_options_type, attribute_validity_output_format),
         ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_DETECTED_ERRORS_COUNT,
-        "-printerrorcount"
+        "-printerrorcount",
+        OPTIONAL_PARAMETER_FLAG
     },
     {
-        &number_of_attribute_validity_errors_to_print,
+        offsetof(parse_options_type, number_of_attribute_validity_errors_to_print),
         UINT32_MAX,
-        "-printallerrors"
+        "-printallerrors",
+        OPTIONAL_PARAMETER_FLAG
+    },
+    {
+        offsetof(parse_options_type, jobs),
+        0,
+        "-jobs=",
+        OPTIONAL_PARAMETER_NUMBER
+    },
+    {
+        offsetof(parse_options_type, output_directory),
+        0,
+        "-outdir=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, diff_summary_only),
+        1,
+        "-summary",
+        OPTIONAL_PARAMETER_FLAG
+    },
+    {
+        offsetof(parse_options_type, seed_filename),
+        0,
+        "-seed=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, clock_model_filename),
+        0,
+        "-clock=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, timing_top_rows),
+        0,
+        "-top=",
+        OPTIONAL_PARAMETER_NUMBER
+    },
+    {
+        offsetof(parse_options_type, map_cache_directory),
+        0,
+        "-mapcache=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, map_cache_disabled),
+        1,
+        "-nomapcache",
+        OPTIONAL_PARAMETER_FLAG
+    },
+    {
+        offsetof(parse_options_type, field_map_filename),
+        0,
+        "-fields=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, maps_directory),
+        0,
+        "-maps=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, stop_at_null),
+        1,
+        "-stopatnull",
+        OPTIONAL_PARAMETER_FLAG
+    },
+    {
+        offsetof(parse_options_type, fingerprint_index_filename),
+        0,
+        "-index=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, fingerprint_label),
+        0,
+        "-label=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, cluster_threshold),
+        0,
+        "-threshold=",
+        OPTIONAL_PARAMETER_NUMBER
+    },
+    {
+        offsetof(parse_options_type, filter_expression),
+        0,
+        "-filter=",
+        OPTIONAL_PARAMETER_STRING
+    },
+    {
+        offsetof(parse_options_type, output_format),
+        OUTPUT_FORMAT_NDJSON,
+        "-format=ndjson",
+        OPTIONAL_PARAMETER_FLAG
+    },
+    {
+        offsetof(parse_options_type, output_format),
+        OUTPUT_FORMAT_CSV,
+        "-format=csv",
+        OPTIONAL_PARAMETER_FLAG
     }
 };
 
-int process_optional_parameters(int argc, char **argv, int argcoffset){                                             //argcoffset = how many parameters(including command name) to skip
+int process_optional_parameters(int argc, char **argv, int argcoffset, parse_options_type *options){              //argcoffset = how many parameters(including command name) to skip
     uint32_t i = 0;
+    size_t length;
+    char *option_ptr;
     for(;argcoffset<argc;argcoffset++){                                                                             //Go through optional parameters
         for(i = 0; i < (sizeof(optional_parameter_list)/sizeof(optional_parameter_type)); i++){                     //For loop all optional parameters
-            if(strcmp(argv[argcoffset],optional_parameter_list[i].parameter_str)==0){                               //If strings match
-                *optional_parameter_list[i].variable_to_alter_ptr = optional_parameter_list[i].variable_new_value;  //Alter value of variable
-                break;
+            option_ptr = ((char*)options + optional_parameter_list[i].option_offset);
+            if(optional_parameter_list[i].parameter_value_type == OPTIONAL_PARAMETER_FLAG){
+                if(strcmp(argv[argcoffset],optional_parameter_list[i].parameter_str)==0){                           //If strings match
+                    *(uint32_t*)option_ptr = optional_parameter_list[i].option_new_value;                           //Alter value of option
+                    break;
+                }
+            }
+            else{
+                length = strlen(optional_parameter_list[i].parameter_str);
+                if((strncmp(argv[argcoffset],optional_parameter_list[i].parameter_str,length)==0)&&(argv[argcoffset][length]!='\0')){
+                    if(optional_parameter_list[i].parameter_value_type == OPTIONAL_PARAMETER_NUMBER){
+                        *(uint32_t*)option_ptr = strtoul(&argv[argcoffset][length], NULL, 0);
+                    }
+                    else{
+                        *(char**)option_ptr = &argv[argcoffset][length];
+                    }
+                    break;
+                }
             }
         }
         if(i==(sizeof(optional_parameter_list)/sizeof(optional_parameter_type))){                                   //We went through the whole list without break; - Unknown parameter
@@ -301,34 +525,199 @@ int process_optional_parameters(int argc, char **argv, int argcoffset){
     return 0;       //Return success
 }
 
-/* STRINGS */
+/* OUTPUT */
+
+/*
+ * Output is rendered into a large buffer with hand written hex and decimal formatting and written out with single write() calls.
+ * Every output_*() function reserves room for its maximum length first, so buffer is flushed only when it is about to overflow.
+ */
+
+#define OUTPUT_BUFFER_SIZE (256*1024)
+
+#define OUTPUT_FD_MEMORY -1                 //Output is collected in memory. Buffer grows instead of flushing
+#define OUTPUT_FD_DISCARD -2                //Memory output after failed realloc(). Everything is discarded
+
+typedef struct{
+    int fd;
+    char *buffer;
+    size_t size;                            //Allocated size of buffer
+    size_t length;                          //Bytes waiting in buffer
+    uint32_t error;                         //Non-zero after write() or realloc() has failed. Rest of the output is discarded
+    uint32_t color_enabled;
+} output_buffer_type;
+
+const char hex_digits[] = "0123456789abcdef";
+
+const char *color_green_str =   "\x1B[32m";
+const char *color_red_str =     "\x1B[31m";
+const char *color_yellow_str =  "\x1B[33m";
+const char *color_blue_str =    "\x1B[34m";
+const char *color_default_str = "\x1B[0m";
+
+
+int output_open(output_buffer_type *output, int fd, uint32_t color_enabled){
+    output->fd = fd;
+    output->size = OUTPUT_BUFFER_SIZE;
+    output->length = 0;
+    output->error = 0;
+    output->color_enabled = color_enabled;
+    output->buffer = malloc(OUTPUT_BUFFER_SIZE);
+    if(output->buffer == NULL){
+        return -1;
+    }
+    return 0;
+}
+
+void output_write_all(output_buffer_type *output, const char *data, size_t count){
+    ssize_t temp;
+    if(output->fd == OUTPUT_FD_MEMORY){
+        return;                             //Nowhere to write. Caller takes buffer and length of memory output
+    }
+    while(count && !output->error){
+        temp = write(output->fd, data, count);
+        if(temp < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            output->error = 1;                  //ie. closed pipe
+            break;
+        }
+        data += temp;
+        count -= temp;
+    }
+}
+
+void output_flush(output_buffer_type *output){
+    output_write_all(output, output->buffer, output->length);
+    output->length = 0;
+}
+
+void output_close(output_buffer_type *output){
+    output_flush(output);
+    free(output->buffer);
+    output->buffer = NULL;
+}
+
+/* Grow memory output to fit count more bytes. On failure output is marked failed and discarded from there on */
+void output_grow(output_buffer_type *output, size_t count){
+    char *temp_ptr;
+    size_t size = output->size;
+    while((output->length + count) > size){
+        size *= 2;
+    }
+    temp_ptr = realloc(output->buffer, size);
+    if(temp_ptr == NULL){
+        output->error = 1;
+        output->fd = OUTPUT_FD_DISCARD;
+        output->length = 0;
+        return;
+    }
+    output->buffer = temp_ptr;
+    output->size = size;
+}
+
+/* Make room for count bytes. Returns pointer to the end of buffer */
+static inline char *output_reserve(output_buffer_type *output, size_t count){
+    if((output->length + count) > output->size){
+        if(output->fd == OUTPUT_FD_MEMORY){
+            output_grow(output, count);
+        }
+        else{
+            output_flush(output);
+        }
+    }
+    return (output->buffer + output->length);
+}
+
+static inline void output_data(output_buffer_type *output, const char *data, size_t count){
+    if((count > output->size) && (output->fd != OUTPUT_FD_MEMORY)){     //Would never fit. Write directly
+        output_flush(output);
+        output_write_all(output, data, count);
+        return;
+    }
+    memcpy(output_reserve(output, count), data, count);
+    output->length += count;
+}
+
+static inline void output_str(output_buffer_type *output, const char *str){
+    output_data(output, str, strlen(str));
+}
+
+static inline void output_char(output_buffer_type *output, char c){
+    *output_reserve(output, 1) = c;
+    output->length++;
+}
 
-void change_stdout_green(){
-    if(color_enabled){
-        fprintf(stdout, "\x1B[32m");
+/* printf("%-*s") */
+static inline void output_str_padded(output_buffer_type *output, const char *str, size_t width){
+    size_t length = strlen(str);
+    char *ptr;
+    output_data(output, str, length);
+    if(length < width){
+        ptr = output_reserve(output, (width - length));
+        memset(ptr, ' ', (width - length));
+        output->length += (width - length);
     }
 }
-void change_stdout_red(){
-    if(color_enabled){
-        fprintf(stdout, "\x1B[31m");
+
+/* printf("0x%08x") */
+static inline void output_hex32(output_buffer_type *output, uint32_t value){
+    char *ptr = output_reserve(output, 10);
+    ptr[0] = '0';
+    ptr[1] = 'x';
+    for(uint32_t i = 9; i >= 2; i--){
+        ptr[i] = hex_digits[value & 0xf];
+        value >>= 4;
     }
+    output->length += 10;
 }
-void change_stdout_yellow(){
-    if(color_enabled){
-        fprintf(stdout, "\x1B[33m");
+
+/* printf("%016lx") */
+static inline void output_hex64(output_buffer_type *output, uint64_t value){
+    char *ptr = output_reserve(output, 16);
+    for(int32_t i = 15; i >= 0; i--){
+        ptr[i] = hex_digits[value & 0xf];
+        value >>= 4;
     }
+    output->length += 16;
+}
+
+/* printf("%x") */
+static inline void output_hex(output_buffer_type *output, uint64_t value){
+    char temp[16];
+    uint32_t i = sizeof(temp);
+    do{
+        temp[--i] = hex_digits[value & 0xf];
+        value >>= 4;
+    }while(value);
+    output_data(output, &temp[i], (sizeof(temp) - i));
 }
-void change_stdout_blue(){
-    if(color_enabled){
-        fprintf(stdout, "\x1B[34m");
+
+/* printf("%0*lu"). Width 0 or 1 equals printf("%lu") */
+static inline void output_dec_padded(output_buffer_type *output, uint64_t value, uint32_t width){
+    char temp[24];
+    uint32_t i = sizeof(temp);
+    do{
+        temp[--i] = '0' + (value % 10);
+        value /= 10;
+    }while(value);
+    while(((sizeof(temp) - i) < width) && (i > 0)){
+        temp[--i] = '0';
     }
+    output_data(output, &temp[i], (sizeof(temp) - i));
 }
-void change_stdout_default(){
-    if(color_enabled){
-        fprintf(stdout, "\x1B[0m");
+
+static inline void output_dec(output_buffer_type *output, uint64_t value){
+    output_dec_padded(output, value, 0);
+}
+
+static inline void output_color(output_buffer_type *output, const char *color_str){
+    if(output->color_enabled){
+        output_str(output, color_str);
     }
 }
 
+
 /* LABEL STRINGS */
 
 const char *addr_str =       "ADDR: ";
@@ -357,22 +746,6 @@ const char *none_str =       "  NONE(INVLD) ";
 const char *terminate_str =  "  (TERMINATE) ";
 
 
-/* ATTRIBUTE ERROR STRINGS */
-
-const char *null_addr_str =  "(NULL ADDR)";
-
-const char *non_zero_attr_byte_range_8_10_str = "(NON-ZERO ATTR BYTE RANGE [8-10])";
-const char *non_zero_attr_byte_range_24_26_str = "(NON-ZERO ATTR BYTE RANGE [24-26])";
-
-const char *write_parameters_without_write_flag_str = "(WRITE PARAMETERS W/O WRITE FLAG)";
-const char *read_parameters_without_read_flag_str = "(READ PARAMETERS W/O READ FLAG)";
-
-const char *write_sum_of_count_and_start_exceeds_31_str = "(WRITE SUM OF BIT COUNT AND START BIT >31)";
-const char *read_sum_of_count_and_start_exceeds_31_str = "(READ SUM OF BIT COUNT AND START BIT >31)";
-
-const char *both_read_and_write_str = "(BOTH READ AND WRITE FLAGS ARE PRESENT)";
-
-
 /* ERROR STRINGS */
 
 #define ERROR_PARAMETER_COUNT               -1
@@ -387,6 +760,35 @@ const char *both_read_and_write_str = "(BOTH READ AND WRITE FLAGS ARE PRESENT)";
 #define ERROR_NO_LINES_CSV_FILE             -10
 #define ERROR_CSV_MALLOC_FAILED             -11
 #define ERROR_CSV_PARSING_ERROR             -12
+#define ERROR_OUTPUT_MALLOC_FAILED          -13
+#define ERROR_INDEX_MALLOC_FAILED           -14
+#define ERROR_SCAN_MALLOC_FAILED            -15
+#define ERROR_UNKNOWN_MODE                  -16
+#define ERROR_BATCH_MALLOC_FAILED           -17
+#define ERROR_OPEN_OUTPUT_FILE              -18
+#define ERROR_DIFF_MALLOC_FAILED            -19
+#define ERROR_TABLE_MALLOC_FAILED           -20
+#define ERROR_SIMULATION_MALLOC_FAILED      -21
+#define ERROR_OPEN_SEED_FILE                -22
+#define ERROR_TIMING_MALLOC_FAILED          -23
+#define ERROR_OPEN_CLOCK_MODEL_FILE         -24
+#define ERROR_CLOCK_MODEL_PARSING_ERROR     -25
+#define ERROR_OPTIMIZE_MALLOC_FAILED        -26
+#define ERROR_OPEN_FIELD_MAP_FILE           -27
+#define ERROR_FIELD_MAP_MALLOC_FAILED       -28
+#define ERROR_FIELD_MAP_PARSING_ERROR       -29
+#define ERROR_AUTODETECT_MALLOC_FAILED      -30
+#define ERROR_NO_SOC_MAPS                   -31
+#define ERROR_FINGERPRINT_INDEX_FILE        -32
+#define ERROR_FINGERPRINT_MALLOC_FAILED     -33
+#define ERROR_CLUSTER_MALLOC_FAILED         -34
+#define ERROR_ACCESS_INDEX_FILE             -35
+#define ERROR_QUERY_PARAMETER               -36
+#define ERROR_FILTER_PARAMETER              -37
+#define ERROR_OUTPUT_FORMAT_NOT_SUPPORTED   -38
+#define ERROR_STREAM_INPUT_NOT_SUPPORTED    -39
+
+void print_modes_stderr();
 
 void print_error_stderr(int error_no){
     if(error_no == ERROR_PARAMETER_COUNT){
@@ -394,6 +796,10 @@ void print_error_stderr(int error_no){
         fprintf(stderr, "Example 1: ./hisi-initregtable-parser u-boot.bin 64 4k csv hi3516a_d.csv -printoffset\n");    
         fprintf(stderr, "Example 2: ./hisi-initregtable-parser u-boot.bin 64 4k csv hi3516_d.csv -nocolor > output.txt \n");
         fprintf(stderr, "Example 3: ./hisi-initregtable-parser u-boot.bin 64 4k none -addronly > addr_list.txt \n");
+        fprintf(stderr, "Example 4: ./hisi-initregtable-parser -scan u-boot.bin\n");
+        fprintf(stderr, "Example 5: ./hisi-initregtable-parser emmc.img 5G 16k hi3516a_d   (k, M and G suffixes, 64-bit offsets)\n");
+        fprintf(stderr, "Modes:\n");
+        print_modes_stderr();
         fprintf(stderr, "SoC types:\n");
         for(uint32_t i = 0; i<(sizeof(soc_list)/sizeof(soc_type)); i++){
             fprintf(stderr, "%s\n", soc_list[i].soc_type_parameter_str);
@@ -443,546 +849,7856 @@ void print_error_stderr(int error_no){
     else if(error_no == ERROR_CSV_PARSING_ERROR){
         fprintf(stderr, "CVS parsing error line no: ");
     }
+    else if(error_no == ERROR_OUTPUT_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for output buffer failed!\n");
+    }
+    else if(error_no == ERROR_INDEX_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for register index failed!\n");
+    }
+    else if(error_no == ERROR_SCAN_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for scan failed!\n");
+    }
+    else if(error_no == ERROR_BATCH_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for batch failed!\n");
+    }
+    else if(error_no == ERROR_SIMULATION_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for simulation failed!\n");
+    }
+    else if(error_no == ERROR_OPEN_SEED_FILE){
+        fprintf(stderr, "Open seed DumpFile error!\n");
+    }
+    else if(error_no == ERROR_TIMING_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for timing failed!\n");
+    }
+    else if(error_no == ERROR_OPEN_CLOCK_MODEL_FILE){
+        fprintf(stderr, "Open clock ModelFile error!\n");
+    }
+    else if(error_no == ERROR_CLOCK_MODEL_PARSING_ERROR){
+        fprintf(stderr, "Clock model parsing error line no: ");
+    }
+    else if(error_no == ERROR_OPTIMIZE_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for optimization failed!\n");
+    }
+    else if(error_no == ERROR_OPEN_FIELD_MAP_FILE){
+        fprintf(stderr, "Open register FieldMapFile error!\n");
+    }
+    else if(error_no == ERROR_FIELD_MAP_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for register field map failed!\n");
+    }
+    else if(error_no == ERROR_FIELD_MAP_PARSING_ERROR){
+        fprintf(stderr, "Register field map parsing error line no: ");
+    }
+    else if(error_no == ERROR_AUTODETECT_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for autodetect failed!\n");
+    }
+    else if(error_no == ERROR_NO_SOC_MAPS){
+        fprintf(stderr, "No SoC maps to score! Build with make for built in SoCs or give -maps=CsvDir\n");
+    }
+    else if(error_no == ERROR_FINGERPRINT_INDEX_FILE){
+        fprintf(stderr, "Fingerprint index file error! Not an index file or can't be written\n");
+    }
+    else if(error_no == ERROR_FINGERPRINT_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for fingerprint index failed!\n");
+    }
+    else if(error_no == ERROR_CLUSTER_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for clustering failed!\n");
+    }
+    else if(error_no == ERROR_ACCESS_INDEX_FILE){
+        fprintf(stderr, "Access index file error! Not an access index file or corrupted\n");
+    }
+    else if(error_no == ERROR_FILTER_PARAMETER){
+        fprintf(stderr, "Check filter! Terms: addr|value|delay|attr|offset|count|start OP Number(=Number-Number), region=NAME(NAME*), write, read, invalid, delayonly, terminate, none, error(=KIND)\n");
+        fprintf(stderr, "Combine with !, &&, || and (). Example: -filter=\"region=DDRC* && (write || delay>0)\"\n");
+    }
+    else if(error_no == ERROR_OUTPUT_FORMAT_NOT_SUPPORTED){
+        fprintf(stderr, "-format=ndjson and -format=csv are supported when parsing a range of one input!\n");
+    }
+    else if(error_no == ERROR_STREAM_INPUT_NOT_SUPPORTED){
+        fprintf(stderr, "Stdin(\"-\") and pipes are supported when parsing a range! Save input to a file for this mode\n");
+    }
+    else if(error_no == ERROR_QUERY_PARAMETER){
+        fprintf(stderr, "Check query! Address, Address-Address, Region or Region+Offset with optional :write or :read\n");
+    }
+    else if(error_no == ERROR_TABLE_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for table failed!\n");
+    }
+    else if(error_no == ERROR_DIFF_MALLOC_FAILED){
+        fprintf(stderr, "malloc() for diff failed!\n");
+    }
+    else if(error_no == ERROR_OPEN_OUTPUT_FILE){
+        fprintf(stderr, "Open OutputFile error!\n");
+    }
+    else if(error_no == ERROR_UNKNOWN_MODE){
+        fprintf(stderr, "Unknown mode! Try:\n");
+        print_modes_stderr();
+    }
     return;
 }
 
 
-int import_csv_soc_registers(char *filename){
-#define LENGTH_LINE 100
-#define OMIT_LINES_COUNT 1
-    const char delimiter[] = ",";       //Delimiter
-    char line[LENGTH_LINE];             //Line
-    char* line_ptr = line;              //Pointer
-    uint32_t line_length = 0;
-    uint32_t number_of_lines = 0;       //Number of lines in a file
-    uint32_t line_number = 0;           //Counter for line number
-    
-    FILE *fptr = NULL;                  //File pointer
-    
-    fptr = fopen(filename ,"r");        //Open file
-    
-    uint32_t j = 0;
+/* INPUT */
 
-    /* Check that we have a file open */
-    if(fptr == NULL){
-        print_error_stderr(ERROR_OPEN_CSV_FILE);       //Return open input file error to stderr
-        return ERROR_OPEN_CSV_FILE;
+/*
+ * Input file is accessed with mmap() whenever possible. Table rows are decoded straight from the mapping without copying.
+ * Only a window of INPUT_MAP_WINDOW_SIZE bytes(or the requested length if larger) is mapped at a time and it slides with the reads,
+ * so multi-gigabyte images(eMMC/NAND dumps) are read with a bounded working set. All offsets are 64-bit.
+ * If the input can't be mapped(ie. some character devices or special files) rows are read with pread() in windows of INPUT_WINDOW_SIZE bytes.
+ * Non-seekable input(stdin as "-", pipes, sockets) is a stream. It is read sequentially with read() through a ring buffer
+ * of INPUT_STREAM_RING_SIZE bytes, so memory use doesn't depend on input size. Offset is reached by consuming input.
+ */
+
+#define INPUT_MAP_WINDOW_SIZE (64*1024*1024) //mmap() window size. Larger ranges are mapped a window at a time
+#define INPUT_WINDOW_SIZE (64*1024)         //pread() fallback window size. Must be multiple of DATA_ROW_SIZE
+#define INPUT_STREAM_RING_SIZE (256*1024)   //Stream ring buffer size. Power of two and multiple of DATA_ROW_SIZE
+
+typedef struct{
+    int fd;
+    uint32_t fd_shared;                     //fd is owned by other input_file_type(see input_share()). Not closed
+    uint64_t file_size;
+
+    uint64_t range_end;                     //End of the range given to input_map_range()
+    const uint8_t *map_ptr;                 //mmap() window of the read range. NULL if not mapped
+    size_t map_length;
+    uint64_t map_offset;                    //File offset of map_ptr[0]. Page aligned
+
+    uint8_t *window_ptr;                    //pread() fallback window. NULL if mapped
+    size_t window_size;                     //Allocated size of window
+    size_t window_length;                   //Valid bytes in window
+    uint64_t window_offset;                 //File offset of window_ptr[0]
+
+    uint32_t stream;                        //Non-seekable input. Only input_stream_*() functions can be used
+    uint32_t stream_eof;
+    uint8_t *ring_ptr;
+    uint64_t ring_head;                     //Stream offset of first unconsumed byte
+    uint64_t ring_tail;                     //Stream offset after last byte read
+} input_file_type;
+
+
+int input_open(input_file_type *input, const char *filename){
+    struct stat file_stat;
+    off_t temp;
+
+    memset(input, 0, sizeof(input_file_type));
+
+    input->fd = (strcmp(filename, "-") == 0) ? STDIN_FILENO : open(filename, O_RDONLY);
+    if(input->fd < 0){
+        return ERROR_OPEN_FILE;
     }
-        
-    /* How many lines file has */
-    while(!feof(fptr)){
-        fgets(line,LENGTH_LINE,fptr);
-        line_length = strlen(line);
-        if(line[line_length-1] == '\n' || feof(fptr)){  //Newline or EOF
-            number_of_lines++;                          //Increment line number
+    if(fstat(input->fd, &file_stat) != 0){
+        if(input->fd != STDIN_FILENO){
+            close(input->fd);
         }
-        
-        /* See that line has actual contents */
-        line_ptr = line;                //Reset line pointer
-        /* Field 0 - Base address   */
-        if(number_of_lines>OMIT_LINES_COUNT){
-            while(*line_ptr==' '){ 
-                line_ptr++;
-            }
-            if((*line_ptr<48)||(*line_ptr>57)){
-                fclose(fptr);                                   
-                print_error_stderr(ERROR_CSV_PARSING_ERROR);
-                fprintf(stderr, "%lu\n", number_of_lines);
-                return ERROR_CSV_PARSING_ERROR;
+        return ERROR_OPEN_FILE;
+    }
+
+    if(!S_ISREG(file_stat.st_mode) && !S_ISBLK(file_stat.st_mode) && (lseek(input->fd, 0, SEEK_CUR) < 0)){
+        input->stream = 1;                                  //Pipe, socket or tty
+        input->ring_ptr = malloc(INPUT_STREAM_RING_SIZE);
+        if(input->ring_ptr == NULL){
+            if(input->fd != STDIN_FILENO){
+                close(input->fd);
             }
+            return ERROR_OPEN_FILE;
         }
-        
     }
-    
-    rewind(fptr);                                       //Rewind file to 0
-    
-    if((number_of_lines < 2)){                          //Check we have lines
-        fclose(fptr);                                   
-        print_error_stderr(ERROR_NO_LINES_CSV_FILE);
-        return ERROR_NO_LINES_CSV_FILE;
+    else if(S_ISREG(file_stat.st_mode)){
+        input->file_size = file_stat.st_size;
     }
-    
-    /* Malloc */
-    csv_soc_registers_ptr = malloc(sizeof(soc_register_type)*(number_of_lines-OMIT_LINES_COUNT));
-    if(csv_soc_registers_ptr==NULL){
-        fclose(fptr);
-        print_error_stderr(ERROR_CSV_MALLOC_FAILED);
-        return ERROR_CSV_MALLOC_FAILED;
+    else{
+        temp = lseek(input->fd, 0, SEEK_END);               //Block devices report zero st_size
+        input->file_size = (temp > 0) ? (uint64_t)temp : 0;
     }
-    
-    /* Read lines loop */
-    for(uint32_t i = 0; ((i<OMIT_LINES_COUNT)&&(!feof(fptr))); i++){
-        fgets(line,LENGTH_LINE,fptr);   //Omit lines
+    return 0;
+}
+
+
+/* Second input_file_type reading the same file, ie. for another thread. fd stays owned by input */
+void input_share(input_file_type *shared, const input_file_type *input){
+    memset(shared, 0, sizeof(input_file_type));
+    shared->fd = input->fd;
+    shared->fd_shared = 1;
+    shared->file_size = input->file_size;
+}
+
+
+/* Map window of at least length bytes at offset. Window is INPUT_MAP_WINDOW_SIZE bytes or up to the end of the range. Returns 0 or -1 */
+static int input_map_window(input_file_type *input, uint64_t offset, size_t length){
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    uint64_t map_offset = offset - (offset % page_size);    //mmap() offset must be page aligned
+    uint64_t map_end = map_offset + INPUT_MAP_WINDOW_SIZE;
+    void *temp_ptr;
+
+    if(map_end < (offset + length)){
+        map_end = offset + length;
     }
-    for(line_number = 0; ((line_number<(number_of_lines-OMIT_LINES_COUNT))&&(!feof(fptr)));line_number++){
-        fgets(line,LENGTH_LINE,fptr);   //Get line
-        line_ptr = line;                //Reset line pointer
-        /* Field 0 - Base address   */
-        while(*line_ptr==' '){ 
-            line_ptr++;
-        }
-        if((*line_ptr=='\0')||(*line_ptr=='\n')){
-            break;          //Break the loop
-        }
-        csv_soc_registers_ptr[line_number].base_address = strtoul(line_ptr, NULL, 0);   //Store base address    //TODO error handling
-        while(*line_ptr!=*delimiter){
-            line_ptr++;
-            if((*line_ptr=='\0')||(*line_ptr=='\n')){
-                break;          //Break the loop
-            }
-        }
-        line_ptr++;     //Increment from delimiter
-        
-        
-        
-        /* Field 1 - End address    */
-        while(*line_ptr==' '){  
-            line_ptr++;
-        }
-        if((*line_ptr=='\0')||(*line_ptr=='\n')){
-            break;          //Break the loop
-        }
-        csv_soc_registers_ptr[line_number].end_address = strtoul(line_ptr, NULL, 0);    //Store end address     //TODO error handling
-        while(*line_ptr!=*delimiter){
-            line_ptr++;
-            if((*line_ptr=='\0')||(*line_ptr=='\n')){
-                break;          //Break the loop
-            }
-        }
-        line_ptr++;     //Increment from delimiter
-        
-        
-        
-        /* Field 2 - Name           */
-        while(*line_ptr==' '){
-            line_ptr++;
-        }
-        if((*line_ptr=='\0')||(*line_ptr=='\n')){
-            break;          //Break the loop
-        }
-        if(strchr(line_ptr, '\n')){             //See if '\n' can be found
-            *(strchr(line_ptr, '\n')) = '\0';   //Replace '\n'
-        }
-        //Copy name safelly.
-        for(j = 0; ((j<SOC_REGISTER_NAME_LENGTH)&&(*line_ptr!='\0')); j++){
-            csv_soc_registers_ptr[line_number].register_name[j] = *line_ptr;
-            line_ptr++;
-        }
-        if(j >= SOC_REGISTER_NAME_LENGTH){
-            j = (SOC_REGISTER_NAME_LENGTH-1);
-            csv_soc_registers_ptr[line_number].register_name[j] = '\0';
-        }
+    if(map_end > input->range_end){
+        map_end = input->range_end;
     }
-    
-    if(line_number<(number_of_lines-OMIT_LINES_COUNT)){
-        free(csv_soc_registers_ptr);
-        fclose(fptr);
-        print_error_stderr(ERROR_CSV_PARSING_ERROR);
-        fprintf(stderr, "%lu\n", (line_number + 1));
-        return ERROR_CSV_PARSING_ERROR;
+    if(input->map_ptr){
+        munmap((void*)input->map_ptr, input->map_length);
+        input->map_ptr = NULL;
+        input->map_length = 0;
     }
-    
-    fclose(fptr);   //Close file
-    return line_number;  //Return how many registers where stored
+
+    temp_ptr = mmap(NULL, (size_t)(map_end - map_offset), PROT_READ, MAP_PRIVATE, input->fd, (off_t)map_offset);
+    if(temp_ptr == MAP_FAILED){
+        return -1;
+    }
+    input->map_ptr = temp_ptr;
+    input->map_offset = map_offset;
+    input->map_length = map_end - map_offset;
+    madvise(temp_ptr, input->map_length, MADV_SEQUENTIAL);
+    return 0;
+}
+
+
+/* Map [offset, end) of input file. Falls back to pread() window if the file can't be mapped */
+int input_map_range(input_file_type *input, uint64_t offset, uint64_t end){
+    input->range_end = end;
+    if(input_map_window(input, offset, 0) == 0){
+        return 0;
+    }
+
+    /* Fallback. Window is kept when input is mapped again */
+    if(input->window_ptr == NULL){
+        input->window_ptr = malloc(INPUT_WINDOW_SIZE);
+        if(input->window_ptr == NULL){
+            return ERROR_READ_FILE_ERROR;
+        }
+        input->window_size = INPUT_WINDOW_SIZE;
+    }
+    input->window_length = 0;
+    input->window_offset = 0;
+    return 0;
 }
 
 
 /*
- argv[0]    - command
- argv[1]    - inputfile
- argv[2]    - bytes offset
- argv[3]    - bytes count
- argv[4]    - soc type
- argv[>=5]  - optional parameters
+ * Returns pointer to length bytes at offset. Range must be inside range given to input_map_range(). NULL on read error.
+ * Pointer is valid until the next call: a request outside the current mapping slides the window.
  */
+const uint8_t *input_get_range(input_file_type *input, uint64_t offset, size_t length){
+    ssize_t temp;
+    uint8_t *temp_ptr;
 
-#define NUMBER_OF_FIXED_PARAMETERS_INCL_CMDNAME 5 
+    if(input->map_ptr){
+        if((offset < input->map_offset) || ((offset + length) > (input->map_offset + input->map_length))){
+            if(input_map_window(input, offset, length) != 0){
+                return NULL;
+            }
+        }
+        return (input->map_ptr + (offset - input->map_offset));
+    }
+
+    if((offset >= input->window_offset) && ((offset + length) <= (input->window_offset + input->window_length))){
+        return (input->window_ptr + (offset - input->window_offset));
+    }
+
+    if(length > input->window_size){                        //Grow window
+        temp_ptr = realloc(input->window_ptr, length);
+        if(temp_ptr == NULL){
+            return NULL;
+        }
+        input->window_ptr = temp_ptr;
+        input->window_size = length;
+    }
+
+    /* Refill window starting from offset */
+    input->window_offset = offset;
+    input->window_length = 0;
+    while(input->window_length < length){
+        temp = pread(input->fd, (input->window_ptr + input->window_length), (length - input->window_length), (off_t)(offset + input->window_length));
+        if(temp <= 0){
+            return NULL;                                    //Read error or unexpected EOF
+        }
+        input->window_length += temp;
+    }
+    return input->window_ptr;
+}
+
+
+/* Read more stream input into the ring. Returns bytes read, 0 at end of stream or if the ring is full, -1 on read error */
+ssize_t input_stream_fill(input_file_type *input){
+    size_t position = input->ring_tail % INPUT_STREAM_RING_SIZE;
+    size_t space = INPUT_STREAM_RING_SIZE - (input->ring_tail - input->ring_head);
+    ssize_t temp;
+
+    if(space > (INPUT_STREAM_RING_SIZE - position)){
+        space = INPUT_STREAM_RING_SIZE - position;          //Up to the wrap. Next fill continues from the start
+    }
+    if((space == 0) || input->stream_eof){
+        return 0;
+    }
+    do{
+        temp = read(input->fd, (input->ring_ptr + position), space);
+    }while((temp < 0) && (errno == EINTR));
+    if(temp == 0){
+        input->stream_eof = 1;
+    }
+    if(temp > 0){
+        input->ring_tail += temp;
+    }
+    return temp;
+}
+
+/* Contiguous unconsumed bytes at stream offset ring_head(up to the wrap). Returns count and pointer to them in *data */
+static inline size_t input_stream_peek(const input_file_type *input, const uint8_t **data){
+    size_t position = input->ring_head % INPUT_STREAM_RING_SIZE;
+    size_t length = input->ring_tail - input->ring_head;
+
+    *data = input->ring_ptr + position;
+    return (length < (INPUT_STREAM_RING_SIZE - position)) ? length : (INPUT_STREAM_RING_SIZE - position);
+}
+
+/* Copy length unconsumed bytes(may wrap) into buffer. Caller checks that they are available */
+static inline void input_stream_copy(const input_file_type *input, uint8_t *buffer, size_t length){
+    size_t position = input->ring_head % INPUT_STREAM_RING_SIZE;
+    size_t first = ((INPUT_STREAM_RING_SIZE - position) < length) ? (INPUT_STREAM_RING_SIZE - position) : length;
+
+    memcpy(buffer, (input->ring_ptr + position), first);
+    memcpy((buffer + first), input->ring_ptr, (length - first));
+}
+
+static inline void input_stream_consume(input_file_type *input, size_t length){
+    input->ring_head += length;
+}
+
+/* Consume stream input until stream offset. Returns 0, ERROR_RANGE_EXCEEDS_FILE at end of stream or ERROR_READ_FILE_ERROR */
+int input_stream_skip(input_file_type *input, uint64_t offset){
+    ssize_t temp;
+    while(input->ring_head < offset){
+        if(input->ring_tail == input->ring_head){
+            temp = input_stream_fill(input);
+            if(temp < 0){
+                return ERROR_READ_FILE_ERROR;
+            }
+            if(temp == 0){
+                return ERROR_RANGE_EXCEEDS_FILE;
+            }
+        }
+        input->ring_head = ((offset - input->ring_head) < (input->ring_tail - input->ring_head)) ? offset : input->ring_tail;
+    }
+    return 0;
+}
+
+
+void input_close(input_file_type *input){
+    if(input->map_ptr){
+        munmap((void*)input->map_ptr, input->map_length);
+    }
+    free(input->window_ptr);
+    free(input->ring_ptr);
+    if((input->fd >= 0) && (input->fd != STDIN_FILENO) && !input->fd_shared){
+        close(input->fd);
+    }
+    input->map_ptr = NULL;
+    input->window_ptr = NULL;
+    input->ring_ptr = NULL;
+    input->fd = -1;
+}
+
+/* input_open() for random access(input_map_range()/input_get_range()). Returns 0, ERROR_OPEN_FILE or ERROR_STREAM_INPUT_NOT_SUPPORTED (not printed) */
+int input_open_file(input_file_type *input, const char *filename){
+    if(input_open(input, filename) != 0){
+        return ERROR_OPEN_FILE;
+    }
+    if(input->stream){
+        input_close(input);
+        return ERROR_STREAM_INPUT_NOT_SUPPORTED;
+    }
+    return 0;
+}
+
+
+/* SOC CSV */
+
+/*
+ * CSV file is mapped(see INPUT) and parsed in one pass straight from the mapping. Lines can be of any length.
+ * Register names are copied into one string arena and never truncated. Arena is sized by the file size so names don't move while parsing.
+ * Names are interned through a small direct mapped table that stays in cache: repeated names(ie. RESERVED) are stored once.
+ * A name that has been evicted by a colliding name may be stored again. Registers and arena are owned by the SoC map.
+ */
+
+#define CSV_OMIT_LINES_COUNT 1              //Header line
+#define CSV_INTERN_SLOTS 1024               //Power of two
+#define CSV_REGISTERS_MIN_SIZE 256
+
+typedef struct{
+    uint32_t offset;                        //Arena offset + 1 of interned name. 0 = free slot
+    uint32_t hash;
+} csv_intern_slot_type;
+
+typedef struct{
+    char *arena;
+    size_t arena_length;
+    csv_intern_slot_type slots[CSV_INTERN_SLOTS];
+} csv_intern_type;
+
+/* FNV-1a */
+static inline uint32_t csv_name_hash(const char *name, size_t length){
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < length; i++){
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/* Returns interned copy of name[0, length) */
+static const char *csv_intern(csv_intern_type *intern, const char *name, size_t length){
+    uint32_t hash = csv_name_hash(name, length);
+    csv_intern_slot_type *slot = &intern->slots[(hash * 0x9e3779b1u) >> (32 - __builtin_ctz(CSV_INTERN_SLOTS))];
+    char *interned;
+
+    if(slot->offset && (slot->hash == hash)){
+        interned = &intern->arena[slot->offset - 1];
+        if((strncmp(interned, name, length) == 0) && (interned[length] == '\0')){
+            return interned;
+        }
+    }
+    interned = &intern->arena[intern->arena_length];
+    memcpy(interned, name, length);
+    interned[length] = '\0';
+    slot->offset = intern->arena_length + 1;
+    slot->hash = hash;
+    intern->arena_length += length + 1;
+    return interned;
+}
+
+/* strtoul(ptr, &end, 0) that stops at line_end. Returns pointer after the number or NULL if there is no number */
+static const char *csv_parse_number(const char *ptr, const char *line_end, uint32_t *value){
+    uint32_t base = 10;
+    uint32_t digit;
+    const char *start;
+
+    *value = 0;
+    if((ptr < line_end) && (*ptr == '0')){
+        base = 8;
+        ptr++;
+        if((ptr < (line_end - 1)) && ((*ptr == 'x') || (*ptr == 'X')) && isxdigit((uint8_t)ptr[1])){
+            base = 16;
+            ptr++;
+        }
+        else if((ptr == line_end) || (*ptr < '0') || (*ptr > '7')){
+            return ptr;                     //Just "0"
+        }
+    }
+    start = ptr;
+    for(; ptr < line_end; ptr++){
+        if((*ptr >= '0') && (*ptr <= '9')){
+            digit = *ptr - '0';
+        }
+        else if((*ptr | 0x20) >= 'a' && (*ptr | 0x20) <= 'f'){
+            digit = (*ptr | 0x20) - 'a' + 10;
+        }
+        else{
+            break;
+        }
+        if(digit >= base){
+            break;
+        }
+        *value = (*value * base) + digit;
+    }
+    return (ptr == start) ? NULL : ptr;
+}
+
+static inline const char *csv_skip_blanks(const char *ptr, const char *line_end){
+    while((ptr < line_end) && ((*ptr == ' ') || (*ptr == '\t'))){
+        ptr++;
+    }
+    return ptr;
+}
+
+/* Number field followed by delimiter. Returns pointer after delimiter or NULL */
+static const char *csv_parse_number_field(const char *ptr, const char *line_end, uint32_t *value){
+    ptr = csv_parse_number(csv_skip_blanks(ptr, line_end), line_end, value);
+    if(ptr == NULL){
+        return NULL;
+    }
+    ptr = memchr(ptr, ',', (line_end - ptr));
+    return ptr ? (ptr + 1) : NULL;
+}
+
+/* Returns how many registers were stored in *registers_ptr and their names in *names_ptr(both to be freed by caller) or ERROR_* (not printed, see print_soc_error()). Line of ERROR_CSV_PARSING_ERROR is stored in *error_line */
+int import_csv_soc_registers(const char *filename, soc_register_type **registers_ptr, char **names_ptr, size_t *error_line){
+    input_file_type input;
+    csv_intern_type intern;                 //Slots are on stack
+    soc_register_type *registers = NULL;
+    soc_register_type *temp_ptr;
+    size_t registers_count = 0;
+    size_t registers_size = 0;
+    size_t line_number = 0;
+    const char *data;
+    const char *data_end;
+    const char *line_end;
+    const char *ptr;
+    const char *name_end;
+    uint32_t base_address;
+    uint32_t end_address;
+    int result = 0;
+
+    *registers_ptr = NULL;
+    *names_ptr = NULL;
+    *error_line = 0;
+    memset(&intern, 0, sizeof(intern));
+    result = input_open_file(&input, filename);
+    if(result != 0){
+        return ((result == ERROR_OPEN_FILE) ? ERROR_OPEN_CSV_FILE : result);
+    }
+    if(input.file_size == 0){
+        input_close(&input);
+        return ERROR_NO_LINES_CSV_FILE;
+    }
+    if((input_map_range(&input, 0, input.file_size) != 0) || ((data = (const char*)input_get_range(&input, 0, input.file_size)) == NULL)){
+        input_close(&input);
+        return ERROR_OPEN_CSV_FILE;
+    }
+    data_end = data + input.file_size;
+    intern.arena = malloc(input.file_size + 1);             //Names with terminators never exceed the lines they came from
+    if(intern.arena == NULL){
+        result = ERROR_CSV_MALLOC_FAILED;
+    }
+
+    /* Lines */
+    for(; (data < data_end) && !result; data = line_end + 1){
+        line_end = memchr(data, '\n', (data_end - data));
+        if(line_end == NULL){
+            line_end = data_end;
+        }
+        line_number++;
+        if(line_number <= CSV_OMIT_LINES_COUNT){
+            continue;
+        }
+
+        /* Name ends before trailing blanks and '\r' */
+        name_end = line_end;
+        while((name_end > data) && ((name_end[-1] == ' ') || (name_end[-1] == '\t') || (name_end[-1] == '\r'))){
+            name_end--;
+        }
+        ptr = csv_skip_blanks(data, name_end);
+        if(ptr == name_end){
+            continue;                       //Empty line
+        }
+
+        /* Fields: base address, end address, name */
+        ptr = csv_parse_number_field(ptr, name_end, &base_address);
+        if(ptr){
+            ptr = csv_parse_number_field(ptr, name_end, &end_address);
+        }
+        if(ptr){
+            ptr = csv_skip_blanks(ptr, name_end);
+        }
+        if((ptr == NULL) || (ptr == name_end)){
+            result = ERROR_CSV_PARSING_ERROR;
+            break;
+        }
+
+        if(registers_count == registers_size){
+            registers_size = registers_size ? (registers_size * 2) : CSV_REGISTERS_MIN_SIZE;
+            temp_ptr = realloc(registers, (sizeof(soc_register_type) * registers_size));
+            if(temp_ptr == NULL){
+                result = ERROR_CSV_MALLOC_FAILED;
+                break;
+            }
+            registers = temp_ptr;
+        }
+        registers[registers_count].base_address = base_address;
+        registers[registers_count].end_address = end_address;
+        registers[registers_count].register_name = csv_intern(&intern, ptr, (name_end - ptr));
+        registers_count++;
+    }
+    input_close(&input);
+
+    if(!result && (registers_count == 0)){
+        result = ERROR_NO_LINES_CSV_FILE;
+    }
+    if(result){
+        free(registers);
+        free(intern.arena);
+        if(result == ERROR_CSV_PARSING_ERROR){
+            *error_line = line_number;
+        }
+        return result;
+    }
+    *registers_ptr = registers;
+    *names_ptr = intern.arena;
+    return registers_count;                 //Return how many registers where stored
+}
+
+
+/* REGISTER FIELD MAP */
+
+/*
+ * Register field map file describes individual registers and their bitfields(-fields=FieldMapFile). Format(First Line omited):
+ * ADDRESS   , REGISTER , FIELD        , START, BITS
+ * 0x20030000, APLL_CFG0, APLL_POSTDIV1, 24   , 3
+ * - One line per field. START is the lowest bit(0-31) and BITS the width(1-32) of the field.
+ * - Fields of one register can be on any lines and may overlap. Empty lines are skipped.
+ * Write and read-poll rows are decoded to the fields their START/COUNT attribute bits touch(see render_register_fields()).
+ * File is parsed like SoC CSV(see SOC CSV). Names are interned into one arena.
+ */
+
+#define FIELD_MAP_MIN_SIZE 1024
+
+/* Text field followed by delimiter. Blanks are trimmed. Returns pointer after delimiter or NULL if field is empty */
+static const char *csv_parse_text_field(const char *ptr, const char *line_end, const char **text, size_t *length){
+    const char *end;
+    ptr = csv_skip_blanks(ptr, line_end);
+    end = memchr(ptr, ',', (line_end - ptr));
+    if(end == NULL){
+        return NULL;
+    }
+    *text = ptr;
+    *length = end - ptr;
+    while(*length && ((ptr[*length-1] == ' ') || (ptr[*length-1] == '\t'))){
+        (*length)--;
+    }
+    return *length ? (end + 1) : NULL;
+}
+
+/* Returns how many fields were stored in *fields_ptr and their names in *names_ptr(both to be freed by caller) or ERROR_* (printed to stderr) */
+int import_register_field_map(const char *filename, register_field_type **fields_ptr, char **names_ptr){
+    input_file_type input;
+    csv_intern_type intern;                 //Slots are on stack
+    register_field_type *fields = NULL;
+    register_field_type *temp_ptr;
+    size_t fields_count = 0;
+    size_t fields_size = 0;
+    size_t line_number = 0;
+    const char *data;
+    const char *data_end;
+    const char *line_end;
+    const char *ptr;
+    const char *name_end;
+    const char *register_name;
+    const char *field_name;
+    size_t register_name_length;
+    size_t field_name_length;
+    uint32_t address;
+    uint32_t start_bit;
+    uint32_t bits;
+    int result = 0;
+
+    *fields_ptr = NULL;
+    *names_ptr = NULL;
+    memset(&intern, 0, sizeof(intern));
+    result = input_open_file(&input, filename);
+    if(result != 0){
+        result = ((result == ERROR_OPEN_FILE) ? ERROR_OPEN_FIELD_MAP_FILE : result);
+        print_error_stderr(result);
+        return result;
+    }
+    if(input.file_size == 0){
+        input_close(&input);
+        return 0;
+    }
+    if((input_map_range(&input, 0, input.file_size) != 0) || ((data = (const char*)input_get_range(&input, 0, input.file_size)) == NULL)){
+        input_close(&input);
+        print_error_stderr(ERROR_OPEN_FIELD_MAP_FILE);
+        return ERROR_OPEN_FIELD_MAP_FILE;
+    }
+    data_end = data + input.file_size;
+    intern.arena = malloc(input.file_size + 1);
+    if(intern.arena == NULL){
+        result = ERROR_FIELD_MAP_MALLOC_FAILED;
+    }
+
+    /* Lines */
+    for(; (data < data_end) && !result; data = line_end + 1){
+        line_end = memchr(data, '\n', (data_end - data));
+        if(line_end == NULL){
+            line_end = data_end;
+        }
+        line_number++;
+        if(line_number <= CSV_OMIT_LINES_COUNT){
+            continue;
+        }
+        name_end = line_end;
+        while((name_end > data) && ((name_end[-1] == ' ') || (name_end[-1] == '\t') || (name_end[-1] == '\r'))){
+            name_end--;
+        }
+        ptr = csv_skip_blanks(data, name_end);
+        if(ptr == name_end){
+            continue;                       //Empty line
+        }
+
+        /* Fields: address, register name, field name, start bit, bits */
+        ptr = csv_parse_number_field(ptr, name_end, &address);
+        if(ptr){
+            ptr = csv_parse_text_field(ptr, name_end, &register_name, &register_name_length);
+        }
+        if(ptr){
+            ptr = csv_parse_text_field(ptr, name_end, &field_name, &field_name_length);
+        }
+        if(ptr){
+            ptr = csv_parse_number_field(ptr, name_end, &start_bit);
+        }
+        if(ptr){
+            ptr = csv_parse_number(csv_skip_blanks(ptr, name_end), name_end, &bits);
+        }
+        if((ptr == NULL) || (ptr != name_end) || (start_bit > 31) || (bits == 0) || ((start_bit + bits) > 32)){
+            result = ERROR_FIELD_MAP_PARSING_ERROR;
+            break;
+        }
+
+        if(fields_count == fields_size){
+            fields_size = fields_size ? (fields_size * 2) : FIELD_MAP_MIN_SIZE;
+            temp_ptr = realloc(fields, (sizeof(register_field_type) * fields_size));
+            if(temp_ptr == NULL){
+                result = ERROR_FIELD_MAP_MALLOC_FAILED;
+                break;
+            }
+            fields = temp_ptr;
+        }
+        fields[fields_count].address = address;
+        fields[fields_count].start_bit = start_bit;
+        fields[fields_count].bits = bits;
+        fields[fields_count].register_name = csv_intern(&intern, register_name, register_name_length);
+        fields[fields_count].field_name = csv_intern(&intern, field_name, field_name_length);
+        fields_count++;
+    }
+    input_close(&input);
+
+    if(result){
+        free(fields);
+        free(intern.arena);
+        print_error_stderr(result);
+        if(result == ERROR_FIELD_MAP_PARSING_ERROR){
+            fprintf(stderr, "%zu\n", line_number);
+        }
+        return result;
+    }
+    *fields_ptr = fields;
+    *names_ptr = intern.arena;
+    return fields_count;
+}
+
+
+/* SOC MAP CACHE */
+
+/*
+ * Imported CSV map is compiled into a binary map file: sorted register array, name table and the register index(segments and radix).
+ * Later runs mmap() the map file and use the index straight from the mapping. Only name pointers of registers are fixed up.
+ * - Map file is stored next to the CSV file(<csv file>.map) or with -mapcache=DIR in DIR/<csv content hash>.map. -nomapcache disables it.
+ * - Map file records CSV size, modification time and content hash. Next to CSV file a map with the same size and time is used as is,
+ *   otherwise CSV content hash decides. Stale map is rebuilt automatically.
+ * - Map file is native endian and tied to SOC_MAP_FILE_VERSION. Files of other hosts or versions are rebuilt.
+ * - Map file is written to a temporary file and renamed so concurrent runs never see a partial map. Write errors are ignored.
+ */
+
+#define SOC_MAP_FILE_MAGIC "HIRTMAP"
+#define SOC_MAP_FILE_VERSION 1
+#define SOC_MAP_FILE_BYTE_ORDER 0x01020304
+
+typedef struct{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;                    //SOC_MAP_FILE_BYTE_ORDER in host order
+    uint64_t csv_size;
+    int64_t csv_mtime_sec;
+    int64_t csv_mtime_nsec;
+    uint64_t csv_hash;
+    uint32_t registers_count;
+    uint32_t segments_count;
+    uint32_t names_size;
+    uint32_t reserved;
+    uint32_t radix[SOC_REGISTER_INDEX_RADIX_COUNT+1];
+} soc_map_file_header_type;
+
+/* Followed by registers, segments and names */
+typedef struct{
+    uint32_t base_address;
+    uint32_t end_address;
+    uint32_t name_offset;                   //Offset in names
+} soc_map_file_register_type;
+
+
+/* 64bit content hash. 8 bytes at a time multiply and rotate */
+static uint64_t hash_bytes64(const uint8_t *data, size_t length){
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ length;
+    uint64_t word;
+    size_t i;
+
+    for(i = 0; (i + 8) <= length; i += 8){
+        memcpy(&word, &data[i], 8);
+        hash = (hash ^ (word * 0xff51afd7ed558ccdull));
+        hash = ((hash << 31) | (hash >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    }
+    word = 0;
+    memcpy(&word, &data[i], (length - i));
+    hash ^= word * 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/* Content hash of file. Returns 0 or -1 */
+static int hash_file64(const char *filename, uint64_t *hash){
+    input_file_type input;
+    const uint8_t *data;
+
+    if(input_open_file(&input, filename) != 0){
+        return -1;
+    }
+    if(input.file_size == 0){
+        *hash = hash_bytes64((const uint8_t*)"", 0);
+        input_close(&input);
+        return 0;
+    }
+    if((input_map_range(&input, 0, input.file_size) != 0) || ((data = input_get_range(&input, 0, input.file_size)) == NULL)){
+        input_close(&input);
+        return -1;
+    }
+    *hash = hash_bytes64(data, input.file_size);
+    input_close(&input);
+    return 0;
+}
+
+/* Map file path of CSV file. Returns malloc()ed path or NULL. csv_hash is needed with cache directory */
+static char *soc_map_file_path(const char *csv_filename, const char *cache_directory, uint64_t csv_hash){
+    char *path;
+    if(cache_directory){
+        path = malloc(strlen(cache_directory) + 22);
+        if(path){
+            sprintf(path, "%s/%016llx.map", cache_directory, (unsigned long long)csv_hash);
+        }
+    }
+    else{
+        path = malloc(strlen(csv_filename) + 5);
+        if(path){
+            sprintf(path, "%s.map", csv_filename);
+        }
+    }
+    return path;
+}
+
+/* Use map file if it is valid for the CSV file. Returns 0 or -1(not usable, nothing allocated) */
+static int soc_map_file_load(soc_map_type *soc, const char *path, const struct stat *csv_stat, const uint64_t *csv_hash, const char *csv_filename){
+    const soc_map_file_header_type *header;
+    const soc_map_file_register_type *registers;
+    const soc_register_segment_type *segments;
+    const char *names;
+    struct stat file_stat;
+    uint64_t length;
+    uint64_t hash;
+    void *map_ptr;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0){
+        return -1;
+    }
+    if((fstat(fd, &file_stat) != 0) || (file_stat.st_size < (off_t)sizeof(soc_map_file_header_type))){
+        close(fd);
+        return -1;
+    }
+    map_ptr = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map_ptr == MAP_FAILED){
+        return -1;
+    }
+
+    /* Header */
+    header = map_ptr;
+    length = sizeof(soc_map_file_header_type) + ((uint64_t)header->registers_count * sizeof(soc_map_file_register_type)) +
+             ((uint64_t)header->segments_count * sizeof(soc_register_segment_type)) + header->names_size;
+    if((memcmp(header->magic, SOC_MAP_FILE_MAGIC, sizeof(SOC_MAP_FILE_MAGIC)) != 0) || (header->version != SOC_MAP_FILE_VERSION) ||
+       (header->byte_order != SOC_MAP_FILE_BYTE_ORDER) || (length != (uint64_t)file_stat.st_size) || (header->csv_size != (uint64_t)csv_stat->st_size) ||
+       (header->registers_count == 0) || (header->names_size == 0) || (header->radix[SOC_REGISTER_INDEX_RADIX_COUNT] > header->segments_count)){
+        goto soc_map_file_load_fail;
+    }
+    registers = (const soc_map_file_register_type*)(header + 1);
+    segments = (const soc_register_segment_type*)(registers + header->registers_count);
+    names = (const char*)(segments + header->segments_count);
+    if(names[header->names_size - 1] != '\0'){
+        goto soc_map_file_load_fail;
+    }
+    for(uint32_t i = 0; i < SOC_REGISTER_INDEX_RADIX_COUNT; i++){
+        if(header->radix[i] > header->radix[i+1]){
+            goto soc_map_file_load_fail;
+        }
+    }
+
+    /* Same CSV. Modification time is trusted next to CSV file, otherwise(or if time differs) content decides */
+    if(csv_hash == NULL){
+        if((header->csv_mtime_sec != (int64_t)csv_stat->st_mtim.tv_sec) || (header->csv_mtime_nsec != (int64_t)csv_stat->st_mtim.tv_nsec)){
+            if((hash_file64(csv_filename, &hash) != 0) || (hash != header->csv_hash)){
+                goto soc_map_file_load_fail;
+            }
+        }
+    }
+    else if(*csv_hash != header->csv_hash){
+        goto soc_map_file_load_fail;
+    }
+
+    /* Registers with name pointers into the mapping */
+    soc->csv_registers = malloc(sizeof(soc_register_type) * header->registers_count);
+    if(soc->csv_registers == NULL){
+        goto soc_map_file_load_fail;
+    }
+    for(uint32_t i = 0; i < header->registers_count; i++){
+        if(registers[i].name_offset >= header->names_size){
+            free(soc->csv_registers);
+            soc->csv_registers = NULL;
+            goto soc_map_file_load_fail;
+        }
+        soc->csv_registers[i].base_address = registers[i].base_address;
+        soc->csv_registers[i].end_address = registers[i].end_address;
+        soc->csv_registers[i].register_name = &names[registers[i].name_offset];
+    }
+    for(uint32_t i = 0; i < header->segments_count; i++){
+        if(segments[i].register_index >= header->registers_count){
+            free(soc->csv_registers);
+            soc->csv_registers = NULL;
+            goto soc_map_file_load_fail;
+        }
+    }
+    soc->registers = soc->csv_registers;
+    soc->registers_count = header->registers_count;
+    soc->registers_index.segments = (soc_register_segment_type*)segments;
+    soc->registers_index.segments_count = header->segments_count;
+    memcpy(soc->registers_index.radix, header->radix, sizeof(header->radix));
+    soc->map_file_ptr = map_ptr;
+    soc->map_file_length = file_stat.st_size;
+    soc->registers_index_static = 1;
+    return 0;
+
+soc_map_file_load_fail:
+    munmap(map_ptr, file_stat.st_size);
+    return -1;
+}
+
+/* Write imported and indexed map of soc to path. Errors are ignored */
+static void soc_map_file_save(const soc_map_type *soc, const char *path, const struct stat *csv_stat, uint64_t csv_hash){
+    soc_map_file_header_type header;
+    soc_map_file_register_type *registers;
+    output_buffer_type output;
+    const char *names_end = soc->csv_names;
+    char *temp_path;
+    int fd;
+
+    /* Names are offsets in the arena. Arena ends after the last name */
+    for(size_t i = 0; i < soc->registers_count; i++){
+        if((soc->registers[i].register_name + strlen(soc->registers[i].register_name) + 1) > names_end){
+            names_end = soc->registers[i].register_name + strlen(soc->registers[i].register_name) + 1;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SOC_MAP_FILE_MAGIC, sizeof(SOC_MAP_FILE_MAGIC));
+    header.version = SOC_MAP_FILE_VERSION;
+    header.byte_order = SOC_MAP_FILE_BYTE_ORDER;
+    header.csv_size = csv_stat->st_size;
+    header.csv_mtime_sec = csv_stat->st_mtim.tv_sec;
+    header.csv_mtime_nsec = csv_stat->st_mtim.tv_nsec;
+    header.csv_hash = csv_hash;
+    header.registers_count = soc->registers_count;
+    header.segments_count = soc->registers_index.segments_count;
+    header.names_size = names_end - soc->csv_names;
+    memcpy(header.radix, soc->registers_index.radix, sizeof(header.radix));
+
+    registers = malloc(sizeof(soc_map_file_register_type) * soc->registers_count);
+    temp_path = malloc(strlen(path) + 16);
+    if((registers == NULL) || (temp_path == NULL)){
+        free(registers);
+        free(temp_path);
+        return;
+    }
+    for(size_t i = 0; i < soc->registers_count; i++){
+        registers[i].base_address = soc->registers[i].base_address;
+        registers[i].end_address = soc->registers[i].end_address;
+        registers[i].name_offset = soc->registers[i].register_name - soc->csv_names;
+    }
+
+    sprintf(temp_path, "%s.%d", path, (int)getpid());
+    fd = open(temp_path, (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+    if((fd >= 0) && (output_open(&output, fd, 0) == 0)){
+        output_data(&output, (const char*)&header, sizeof(header));
+        output_data(&output, (const char*)registers, (sizeof(soc_map_file_register_type) * soc->registers_count));
+        output_data(&output, (const char*)soc->registers_index.segments, (sizeof(soc_register_segment_type) * soc->registers_index.segments_count));
+        output_data(&output, soc->csv_names, header.names_size);
+        output_close(&output);
+        if((close(fd) != 0) || output.error || (rename(temp_path, path) != 0)){
+            unlink(temp_path);
+        }
+    }
+    else if(fd >= 0){
+        close(fd);
+        unlink(temp_path);
+    }
+    free(registers);
+    free(temp_path);
+}
+
+
+/* Registers and index of SoC. Returns 0 or ERROR_* (not printed, see print_soc_error()). Line of ERROR_CSV_PARSING_ERROR is stored in *error_line */
+static int load_soc_registers(soc_map_type *soc, uint32_t soc_type_index, const char *csv_filename, const parse_options_type *options, size_t *error_line){
+    struct stat csv_stat;
+    uint64_t csv_hash = 0;
+    uint32_t csv_hashed = 0;
+    char *map_path = NULL;
+    int32_t itemp;
+
+    memset(soc, 0, sizeof(soc_map_type));
+    *error_line = 0;
+    soc->registers = soc_list[soc_type_index].soc_type_registers;
+    soc->registers_count = soc_list[soc_type_index].soc_type_registers_count;
+
+    if(soc_list[soc_type_index].soc_type_registers_index){
+        soc->registers_index = *soc_list[soc_type_index].soc_type_registers_index;
+        soc->registers_index_static = 1;
+        return 0;
+    }
+
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        /* Use map file if it is up to date */
+        if(!options->map_cache_disabled && (stat(csv_filename, &csv_stat) == 0) && S_ISREG(csv_stat.st_mode)){
+            if(options->map_cache_directory){
+                csv_hashed = (hash_file64(csv_filename, &csv_hash) == 0);
+            }
+            if(csv_hashed || !options->map_cache_directory){
+                map_path = soc_map_file_path(csv_filename, options->map_cache_directory, csv_hash);
+            }
+            if(map_path && (soc_map_file_load(soc, map_path, &csv_stat, (csv_hashed ? &csv_hash : NULL), csv_filename) == 0)){
+                free(map_path);
+                return 0;
+            }
+        }
+
+        itemp = import_csv_soc_registers(csv_filename, &soc->csv_registers, &soc->csv_names, error_line);
+        if(itemp<=0){
+            free(map_path);
+            return itemp;
+        }
+        soc->registers = soc->csv_registers;
+        soc->registers_count = itemp;
+    }
+
+    /* Index register bases */
+    if(build_soc_register_index(&soc->registers_index, soc->registers, soc->registers_count)!=0){
+        free(soc->csv_registers);
+        free(soc->csv_names);
+        free(map_path);
+        soc->csv_registers = NULL;
+        soc->csv_names = NULL;
+        return ERROR_INDEX_MALLOC_FAILED;
+    }
+
+    /* Map file for next runs */
+    if(map_path){
+        if(csv_hashed || (hash_file64(csv_filename, &csv_hash) == 0)){
+            soc_map_file_save(soc, map_path, &csv_stat, csv_hash);
+        }
+        free(map_path);
+    }
+    return 0;
+}
+
+/* ROW FILTER */
+
+/*
+ * -filter=Expression shows only rows the expression matches. Expression is compiled once into a postfix program when SoC is loaded and
+ * evaluated on every decoded row before render_row(), so rows filtered out cost no formatting.
+ * Terms:
+ * - addr, value, delay, attr, offset(from region base), count and start(bit count and start bit fields of the write, or read if no write)
+ *   compared with =, !=, <, <=, > or >= to a number. = and != also take a range: addr=0x20000000-0x2fffffff
+ * - region=NAME or region!=NAME. NAME* matches names starting with NAME, "NAME WITH SPACES" can be quoted. (UNMAPPED) is no region
+ * - write, read, invalid(invalid write or read flag), delayonly, terminate and none(ROW_FLAG_*)
+ * - error(any shown attribute error) or error=KIND, KIND one of row_filter_error_list
+ * Terms are combined with ! (not), && (and), || (or) and parenthesis: -filter="region=DDRC* && write || delay>0"
+ * Program runs on a bit stack, so nesting is limited to ROW_FILTER_STACK_DEPTH and region terms to ROW_FILTER_MAX_REGION_TERMS.
+ */
+
+#define ROW_FILTER_OP_RANGE 0
+#define ROW_FILTER_OP_FLAGS 1
+#define ROW_FILTER_OP_ERRORS 2
+#define ROW_FILTER_OP_REGION 3
+#define ROW_FILTER_OP_NOT 4
+#define ROW_FILTER_OP_AND 5
+#define ROW_FILTER_OP_OR 6
+
+#define ROW_FILTER_FIELD_ADDR 0
+#define ROW_FILTER_FIELD_VALUE 1
+#define ROW_FILTER_FIELD_DELAY 2
+#define ROW_FILTER_FIELD_ATTR 3
+#define ROW_FILTER_FIELD_OFFSET 4
+#define ROW_FILTER_FIELD_COUNT 5
+#define ROW_FILTER_FIELD_START 6
+
+#define ROW_FILTER_STACK_DEPTH 64
+#define ROW_FILTER_MAX_REGION_TERMS 64
+
+typedef struct{
+    const char *name_str;
+    uint32_t op;
+    uint32_t value;                         //Field or mask
+} row_filter_keyword_type;
+
+const row_filter_keyword_type row_filter_keyword_list[] = {
+    {"addr", ROW_FILTER_OP_RANGE, ROW_FILTER_FIELD_ADDR},
+    {"value", ROW_FILTER_OP_RANGE, ROW_FILTER_FIELD_VALUE},
+    {"delay", ROW_FILTER_OP_RANGE, ROW_FILTER_FIELD_DELAY},
+    {"attr", ROW_FILTER_OP_RANGE, ROW_FILTER_FIELD_ATTR},
+    {"offset", ROW_FILTER_OP_RANGE, ROW_FILTER_FIELD_OFFSET},
+    {"count", ROW_FILTER_OP_RANGE, ROW_FILTER_FIELD_COUNT},
+    {"start", ROW_FILTER_OP_RANGE, ROW_FILTER_FIELD_START},
+    {"write", ROW_FILTER_OP_FLAGS, ROW_FLAG_WRITE},
+    {"read", ROW_FILTER_OP_FLAGS, ROW_FLAG_READ},
+    {"invalid", ROW_FILTER_OP_FLAGS, (ROW_FLAG_WRITE_INVALID | ROW_FLAG_READ_INVALID)},
+    {"delayonly", ROW_FILTER_OP_FLAGS, ROW_FLAG_DELAY_ONLY},
+    {"terminate", ROW_FILTER_OP_FLAGS, ROW_FLAG_TERMINATE},
+    {"none", ROW_FILTER_OP_FLAGS, ROW_FLAG_NONE},
+    {"error", ROW_FILTER_OP_ERRORS, ROW_ERROR_MASK},
+    {"region", ROW_FILTER_OP_REGION, 0}
+};
+
+/* error=KIND. Same order as ROW_ERROR_* bits */
+const char *row_filter_error_list[ROW_ERROR_COUNT] = {
+    "nulladdr",
+    "bothflags",
+    "readparams",
+    "writeparams",
+    "attr8_10",
+    "attr24_26",
+    "writesum",
+    "readsum"
+};
+
+typedef struct{
+    const char *ptr;                        //Parsing position. Points to the error after failed compile
+    const soc_map_type *soc;
+    row_filter_type *filter;
+    uint32_t depth;                         //Bit stack depth at ptr
+    uint32_t region_terms;
+} row_filter_compiler_type;
+
+/* Returns 1 if row is shown. register_index is soc_map_lookup() result as index, registers_count if unmapped */
+static inline int row_filter_match(const row_filter_type *filter, const register_table_type *table, size_t row, const soc_register_type *soc_register, uint32_t register_index){
+    const row_filter_op_type *op = filter->ops;
+    const row_filter_op_type *end = op + filter->ops_count;
+    uint32_t attr = table->attr[row];
+    uint32_t flags = table->flags[row];
+    uint64_t stack = 0;
+    uint32_t field = 0;
+
+    for(; op < end; op++){
+        switch(op->op){
+            case ROW_FILTER_OP_RANGE:
+                switch(op->field){
+                    case ROW_FILTER_FIELD_ADDR: field = table->addr[row]; break;
+                    case ROW_FILTER_FIELD_VALUE: field = table->value[row]; break;
+                    case ROW_FILTER_FIELD_DELAY: field = table->delay[row]; break;
+                    case ROW_FILTER_FIELD_ATTR: field = attr; break;
+                    case ROW_FILTER_FIELD_OFFSET: field = table->addr[row] - soc_register->base_address; break;
+                    case ROW_FILTER_FIELD_COUNT: field = (flags & ROW_FLAG_WRITE) ? ATTR_WRITE_NO_BITS(attr) : ATTR_READ_NO_BITS(attr); break;
+                    case ROW_FILTER_FIELD_START: field = (flags & ROW_FLAG_WRITE) ? ATTR_WRITE_START_BIT(attr) : ATTR_READ_START_BIT(attr); break;
+                }
+                stack = (stack << 1) | ((field >= op->low) && (field <= op->high));
+                break;
+            case ROW_FILTER_OP_FLAGS:
+                stack = (stack << 1) | ((flags & op->low) != 0);
+                break;
+            case ROW_FILTER_OP_ERRORS:
+                stack = (stack << 1) | (((table->errors[row] & op->low) != 0) && !(table->errors[row] & ROW_ERROR_HIDDEN_SECTION));
+                break;
+            case ROW_FILTER_OP_REGION:
+                stack = (stack << 1) | ((filter->region_masks[register_index] >> op->field) & 1);
+                break;
+            case ROW_FILTER_OP_NOT:
+                stack ^= 1;
+                break;
+            case ROW_FILTER_OP_AND:
+                stack = (stack >> 1) & (~(uint64_t)1 | stack);
+                break;
+            case ROW_FILTER_OP_OR:
+                stack = (stack >> 1) | (stack & 1);
+                break;
+        }
+    }
+    return (int)(stack & 1);
+}
+
+static inline void row_filter_skip_blanks(row_filter_compiler_type *compiler){
+    while((*compiler->ptr == ' ') || (*compiler->ptr == '\t')){
+        compiler->ptr++;
+    }
+}
+
+static void row_filter_emit(row_filter_compiler_type *compiler, uint32_t op, uint32_t field, uint32_t low, uint32_t high){
+    row_filter_op_type *emitted = &compiler->filter->ops[compiler->filter->ops_count++];
+    emitted->op = op;
+    emitted->field = field;
+    emitted->low = low;
+    emitted->high = high;
+}
+
+/* Comparison operator. Returns length or 0 */
+static uint32_t row_filter_operator(const char *ptr, char operator_str[3]){
+    static const char *operators[] = {"==", "!=", "<=", ">=", "=", "<", ">"};
+    for(uint32_t i = 0; i < (sizeof(operators)/sizeof(operators[0])); i++){
+        size_t length = strlen(operators[i]);
+        if(strncmp(ptr, operators[i], length) == 0){
+            strcpy(operator_str, operators[i]);
+            return (uint32_t)length;
+        }
+    }
+    return 0;
+}
+
+/* region=NAME. Marks term bit of every matching register and emits region op */
+static int row_filter_region_term(row_filter_compiler_type *compiler){
+    const soc_map_type *soc = compiler->soc;
+    const char *name;
+    size_t length;
+    uint32_t prefix = 0;
+    char quote = 0;
+
+    if((*compiler->ptr == '"') || (*compiler->ptr == '\'')){
+        quote = *compiler->ptr++;
+    }
+    name = compiler->ptr;
+    while(*compiler->ptr && (quote ? (*compiler->ptr != quote) : !strchr(" \t()&|", *compiler->ptr))){
+        compiler->ptr++;
+    }
+    length = compiler->ptr - name;
+    if(quote){
+        if(*compiler->ptr != quote){
+            compiler->ptr = name - 1;
+            return -1;
+        }
+        compiler->ptr++;
+    }
+    if(length && (name[length-1] == '*')){
+        prefix = 1;
+        length--;
+    }
+    if((length == 0) || (compiler->region_terms == ROW_FILTER_MAX_REGION_TERMS)){
+        compiler->ptr = name;
+        return -1;
+    }
+    for(size_t i = 0; i <= soc->registers_count; i++){
+        const char *register_name = (i < soc->registers_count) ? soc->registers[i].register_name : unmapped_register.register_name;
+        if((strncmp(register_name, name, length) == 0) && (prefix || (register_name[length] == '\0'))){
+            compiler->filter->region_masks[i] |= ((uint64_t)1 << compiler->region_terms);
+        }
+    }
+    row_filter_emit(compiler, ROW_FILTER_OP_REGION, compiler->region_terms++, 0, 0);
+    return 0;
+}
+
+/* Number or range(with = and != only) of a comparison into [low, high]. Returns 0 or -1 */
+static int row_filter_number_term(row_filter_compiler_type *compiler, uint32_t field, const char *operator_str){
+    uint64_t low;
+    uint64_t high;
+    uint32_t negate = 0;
+    char *end;
+
+    if(!isdigit((uint8_t)*compiler->ptr)){
+        return -1;
+    }
+    low = strtoull(compiler->ptr, &end, 0);
+    high = low;
+    if((*end == '-') && ((operator_str[0] == '=') || (operator_str[0] == '!'))){
+        if(!isdigit((uint8_t)end[1])){
+            return -1;
+        }
+        high = strtoull(&end[1], &end, 0);
+    }
+    if((low > UINT32_MAX) || (high > UINT32_MAX) || (high < low)){
+        return -1;
+    }
+    compiler->ptr = end;
+
+    if(operator_str[0] == '!'){
+        negate = 1;
+    }
+    else if(strcmp(operator_str, "<") == 0){
+        if(low == 0){
+            negate = 1;                     //Never true
+            high = UINT32_MAX;
+        }
+        else{
+            high = low - 1;
+        }
+        low = 0;
+    }
+    else if(strcmp(operator_str, "<=") == 0){
+        low = 0;
+    }
+    else if(strcmp(operator_str, ">") == 0){
+        if(low == UINT32_MAX){
+            negate = 1;
+            low = 0;
+        }
+        else{
+            low++;
+        }
+        high = UINT32_MAX;
+    }
+    else if(strcmp(operator_str, ">=") == 0){
+        high = UINT32_MAX;
+    }
+    row_filter_emit(compiler, ROW_FILTER_OP_RANGE, field, (uint32_t)low, (uint32_t)high);
+    if(negate){
+        row_filter_emit(compiler, ROW_FILTER_OP_NOT, 0, 0, 0);
+    }
+    return 0;
+}
+
+/* Keyword with optional comparison. Returns 0 or -1 */
+static int row_filter_term(row_filter_compiler_type *compiler){
+    const row_filter_keyword_type *keyword = NULL;
+    const char *name = compiler->ptr;
+    char operator_str[3] = "";
+    size_t length;
+    uint32_t i;
+
+    while(isalnum((uint8_t)*compiler->ptr) || (*compiler->ptr == '_')){
+        compiler->ptr++;
+    }
+    length = compiler->ptr - name;
+    for(i = 0; i < (sizeof(row_filter_keyword_list)/sizeof(row_filter_keyword_type)); i++){
+        if((strlen(row_filter_keyword_list[i].name_str) == length) && (strncmp(row_filter_keyword_list[i].name_str, name, length) == 0)){
+            keyword = &row_filter_keyword_list[i];
+            break;
+        }
+    }
+    if(keyword == NULL){
+        compiler->ptr = name;
+        return -1;
+    }
+    if(compiler->depth == ROW_FILTER_STACK_DEPTH){
+        return -1;
+    }
+    compiler->depth++;
+    row_filter_skip_blanks(compiler);
+    compiler->ptr += row_filter_operator(compiler->ptr, operator_str);
+    row_filter_skip_blanks(compiler);
+
+    if(keyword->op == ROW_FILTER_OP_RANGE){
+        return operator_str[0] ? row_filter_number_term(compiler, keyword->value, operator_str) : -1;
+    }
+    if((operator_str[0] != '\0') && (strcmp(operator_str, "=") != 0) && (strcmp(operator_str, "==") != 0) && (strcmp(operator_str, "!=") != 0)){
+        return -1;
+    }
+    if(keyword->op == ROW_FILTER_OP_REGION){
+        if((operator_str[0] == '\0') || (row_filter_region_term(compiler) != 0)){
+            return -1;
+        }
+    }
+    else if(operator_str[0] == '\0'){
+        row_filter_emit(compiler, keyword->op, 0, keyword->value, 0);
+        return 0;
+    }
+    else if(keyword->op == ROW_FILTER_OP_ERRORS){
+        name = compiler->ptr;
+        while(isalnum((uint8_t)*compiler->ptr) || (*compiler->ptr == '_')){
+            compiler->ptr++;
+        }
+        length = compiler->ptr - name;
+        for(i = 0; i < ROW_ERROR_COUNT; i++){
+            if((strlen(row_filter_error_list[i]) == length) && (strncmp(row_filter_error_list[i], name, length) == 0)){
+                break;
+            }
+        }
+        if(i == ROW_ERROR_COUNT){
+            compiler->ptr = name;
+            return -1;
+        }
+        row_filter_emit(compiler, ROW_FILTER_OP_ERRORS, 0, (1u << i), 0);
+    }
+    else{
+        return -1;                          //Flags take no value
+    }
+    if(operator_str[0] == '!'){
+        row_filter_emit(compiler, ROW_FILTER_OP_NOT, 0, 0, 0);
+    }
+    return 0;
+}
+
+static int row_filter_or(row_filter_compiler_type *compiler);
+
+/* !unary, (or) or term */
+static int row_filter_unary(row_filter_compiler_type *compiler){
+    row_filter_skip_blanks(compiler);
+    if(*compiler->ptr == '!'){
+        compiler->ptr++;
+        if(row_filter_unary(compiler) != 0){
+            return -1;
+        }
+        row_filter_emit(compiler, ROW_FILTER_OP_NOT, 0, 0, 0);
+        return 0;
+    }
+    if(*compiler->ptr == '('){
+        compiler->ptr++;
+        if(row_filter_or(compiler) != 0){
+            return -1;
+        }
+        row_filter_skip_blanks(compiler);
+        if(*compiler->ptr != ')'){
+            return -1;
+        }
+        compiler->ptr++;
+        return 0;
+    }
+    return row_filter_term(compiler);
+}
+
+/* Binary operator chain. Both "&&" and "&", "||" and "|" are accepted */
+static int row_filter_and(row_filter_compiler_type *compiler){
+    if(row_filter_unary(compiler) != 0){
+        return -1;
+    }
+    for(;;){
+        row_filter_skip_blanks(compiler);
+        if(*compiler->ptr != '&'){
+            return 0;
+        }
+        compiler->ptr += (compiler->ptr[1] == '&') ? 2 : 1;
+        if(row_filter_unary(compiler) != 0){
+            return -1;
+        }
+        row_filter_emit(compiler, ROW_FILTER_OP_AND, 0, 0, 0);
+        compiler->depth--;
+    }
+}
+
+static int row_filter_or(row_filter_compiler_type *compiler){
+    if(row_filter_and(compiler) != 0){
+        return -1;
+    }
+    for(;;){
+        row_filter_skip_blanks(compiler);
+        if(*compiler->ptr != '|'){
+            return 0;
+        }
+        compiler->ptr += (compiler->ptr[1] == '|') ? 2 : 1;
+        if(row_filter_and(compiler) != 0){
+            return -1;
+        }
+        row_filter_emit(compiler, ROW_FILTER_OP_OR, 0, 0, 0);
+        compiler->depth--;
+    }
+}
+
+void free_row_filter(row_filter_type *filter){
+    free(filter->ops);
+    free(filter->region_masks);
+    filter->ops = NULL;
+    filter->region_masks = NULL;
+    filter->ops_count = 0;
+}
+
+/* Compile expression against loaded SoC registers. Returns 0 or ERROR_* (not printed). error_ptr points to the failing part of expression */
+int compile_row_filter(row_filter_type *filter, const char *expression, const soc_map_type *soc, const char **error_ptr){
+    row_filter_compiler_type compiler;
+
+    filter->ops_count = 0;
+    filter->ops = malloc(sizeof(row_filter_op_type) * ((2 * strlen(expression)) + 2));     //Every character emits at most 2 ops
+    filter->region_masks = calloc((soc->registers_count + 1), sizeof(uint64_t));
+    if((filter->ops == NULL) || (filter->region_masks == NULL)){
+        free_row_filter(filter);
+        return ERROR_OUTPUT_MALLOC_FAILED;
+    }
+    compiler.ptr = expression;
+    compiler.soc = soc;
+    compiler.filter = filter;
+    compiler.depth = 0;
+    compiler.region_terms = 0;
+    if((row_filter_or(&compiler) != 0) || (row_filter_skip_blanks(&compiler), (*compiler.ptr != '\0'))){
+        *error_ptr = compiler.ptr;
+        free_row_filter(filter);
+        return ERROR_FILTER_PARAMETER;
+    }
+    return 0;
+}
+
+
+void free_soc(soc_map_type *soc){
+    free_row_filter(&soc->row_filter);
+    free_register_field_map(&soc->fields);
+    free(soc->field_entries);
+    free(soc->field_names);
+    soc->field_entries = NULL;
+    soc->field_names = NULL;
+    if(soc->registers_index_static){
+        soc->registers_index.segments = NULL;
+    }
+    if(soc->map_file_ptr){
+        munmap(soc->map_file_ptr, soc->map_file_length);
+        soc->map_file_ptr = NULL;
+    }
+    free_soc_register_index(&soc->registers_index);
+    free(soc->csv_registers);
+    free(soc->csv_names);
+    soc->csv_registers = NULL;
+    soc->csv_names = NULL;
+}
+
+/* Print ERROR_* of load_soc_registers() to stderr. error_line is the CSV line of ERROR_CSV_PARSING_ERROR */
+void print_soc_error(int32_t error_no, size_t error_line){
+    print_error_stderr(error_no);
+    if(error_no == ERROR_CSV_PARSING_ERROR){
+        fprintf(stderr, "%zu\n", error_line);
+    }
+}
+
+/* Load SoC from soc_list, optional register field map and row filter. csv_filename is used with "csv" SoC type. Returns 0 or ERROR_* (printed to stderr) */
+int load_soc(soc_map_type *soc, uint32_t soc_type_index, const char *csv_filename, const parse_options_type *options){
+    const char *error_ptr;
+    size_t error_line;
+    int32_t itemp;
+
+    itemp = load_soc_registers(soc, soc_type_index, csv_filename, options, &error_line);
+    if(itemp != 0){
+        print_soc_error(itemp, error_line);
+        return itemp;
+    }
+
+    if(options->field_map_filename){
+        itemp = import_register_field_map(options->field_map_filename, &soc->field_entries, &soc->field_names);
+        if(itemp < 0){
+            //Prints have been done by the function
+            free_soc(soc);
+            return itemp;
+        }
+        if(build_register_field_map(&soc->fields, soc->field_entries, itemp) != 0){
+            free_soc(soc);
+            print_error_stderr(ERROR_FIELD_MAP_MALLOC_FAILED);
+            return ERROR_FIELD_MAP_MALLOC_FAILED;
+        }
+    }
+
+    if(options->filter_expression){
+        itemp = compile_row_filter(&soc->row_filter, options->filter_expression, soc, &error_ptr);
+        if(itemp != 0){
+            free_soc(soc);
+            if(itemp == ERROR_FILTER_PARAMETER){
+                fprintf(stderr, "Filter: %s\n        %*s^\n", options->filter_expression, (int)(error_ptr - options->filter_expression), "");
+            }
+            print_error_stderr(itemp);
+            return itemp;
+        }
+    }
+    return 0;
+}
+
+/* Find SoC type by name. Returns soc_list index or -1 */
+int32_t find_soc_type(const char *soc_type_str){
+    for(uint32_t i = 0; i<(sizeof(soc_list)/sizeof(soc_type)); i++){
+        if(strcmp(soc_list[i].soc_type_parameter_str,soc_type_str)==0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/* ROW RENDERING */
+
+/*
+ * Render fields of register that bits [start_bit, start_bit+bits) touch. value is the written or polled value before shifting.
+ * Partially touched fields are shown with the touched field bits: FIELD[high:low]=value
+ */
+static void render_register_fields(output_buffer_type *output, const register_field_map_type *fields, int32_t register_index, uint32_t start_bit, uint32_t bits, uint32_t value){
+    const register_field_type *field;
+    uint64_t touched_value = ((uint64_t)value & ((1ull<<bits)-1)) << start_bit;
+    uint32_t low;
+    uint32_t high;
+    uint32_t first = 1;
+
+    for(uint32_t i = fields->first_field[register_index]; i < fields->first_field[register_index+1]; i++){
+        field = &fields->fields[i];
+        low = (field->start_bit > start_bit) ? field->start_bit : start_bit;
+        high = ((field->start_bit + field->bits) < (start_bit + bits)) ? (field->start_bit + field->bits) : (start_bit + bits);
+        if(low >= high){
+            continue;                       //Not touched
+        }
+        if(first){
+            output_str(output, "  ");
+            output_str(output, field->register_name);
+            output_char(output, ':');
+            first = 0;
+        }
+        output_char(output, ' ');
+        output_color(output, color_blue_str);
+        output_str(output, field->field_name);
+        output_color(output, color_default_str);
+        if((low != field->start_bit) || (high != (field->start_bit + field->bits))){
+            output_char(output, '[');
+            output_dec(output, (high - 1 - field->start_bit));
+            output_char(output, ':');
+            output_dec(output, (low - field->start_bit));
+            output_char(output, ']');
+        }
+        output_str(output, "=0x");
+        output_hex(output, ((touched_value >> low) & ((1ull<<(high - low))-1)));
+    }
+}
+
+/* Render row of a decoded table into output. soc_register is the register base the address belongs to. fields is the register field map(may be empty) */
+void render_row(output_buffer_type *output, const parse_options_type *options, const register_table_type *table, size_t row, const soc_register_type *soc_register, const register_field_map_type *fields){
+    uint32_t temp;
+    uint32_t temp2;
+    int32_t field_register;
+    
+    uint32_t addr = table->addr[row];
+    uint32_t value = table->value[row];
+    uint32_t delay = table->delay[row];
+    uint32_t attr = table->attr[row];
+    uint32_t flags = table->flags[row];
+    uint32_t errors = table->errors[row];
+    
+    
+    if(!options->no_address){
+        if(!options->addresses_only){
+            output_color(output, color_green_str);
+            output_str(output, addr_str);
+            output_color(output, color_default_str);
+        }
+        output_hex32(output, addr);
+    }
+    
+    if(!options->addresses_only){
+        output_char(output, ' ');
+        output_str_padded(output, soc_register->register_name, 15);
+        if(options->print_offset){
+            output_hex32(output, soc_register->base_address);
+            output_char(output, '+');
+            output_hex32(output, (addr - soc_register->base_address));
+        }
+        output_color(output, color_green_str);
+        output_str(output, value_str);
+        output_color(output, color_default_str);
+        output_hex32(output, value);
+        output_color(output, color_green_str);
+        output_str(output, delay_str);
+
+        if(delay){
+            output_color(output, color_yellow_str);
+        }
+        else{
+            output_color(output, color_default_str);  
+        }
+    
+        output_hex32(output, delay);
+        output_str(output, " DEC ");
+        output_dec_padded(output, delay, 10);
+        output_color(output, color_green_str);
+        output_str(output, attr_str);
+        output_color(output, color_default_str);
+        output_hex32(output, attr);
+        output_str(output, "  -->");
+    
+        /* Write Attribute Print */
+
+        if(flags & ROW_FLAG_WRITE){
+            output_color(output, color_blue_str);
+            if(flags & ROW_FLAG_WRITE_5){
+                output_str(output, write_5_str);
+            }
+            else{
+                output_str(output, write_4_str);
+            } 
+            output_color(output, color_green_str);
+            output_str(output, bit_count_str);
+            output_color(output, color_default_str);
+            output_dec_padded(output, ATTR_WRITE_NO_BITS(attr), 2);
+            output_color(output, color_green_str);
+            output_str(output, bit_start_str);
+            output_color(output, color_default_str);
+            output_dec_padded(output, ATTR_WRITE_START_BIT(attr), 2);
+        }
+        else if(flags & ROW_FLAG_WRITE_INVALID){
+            output_color(output, color_red_str);
+            output_str(output, inv_write_str); 
+        }
+
+        /* Read Attribute Print */
+
+        if(flags & ROW_FLAG_READ){
+            output_color(output, color_yellow_str);
+            if(flags & ROW_FLAG_READ_5){
+                output_str(output, read_5_str);
+            }
+            else{
+                output_str(output, read_4_str);
+            }
+            output_color(output, color_green_str);
+            output_str(output, bit_count_str);
+            output_color(output, color_default_str);
+            output_dec_padded(output, ATTR_READ_NO_BITS(attr), 2);
+            output_color(output, color_green_str);
+            output_str(output, bit_start_str);
+            output_color(output, color_default_str);
+            output_dec_padded(output, ATTR_READ_START_BIT(attr), 2);
+        }
+        else if(flags & ROW_FLAG_READ_INVALID){
+            output_color(output, color_red_str);
+            output_str(output, inv_read_str); 
+        }
+        else if(flags & ROW_FLAG_DELAY_ONLY){                   //No read or write flags!
+            output_color(output, color_yellow_str);
+            output_str(output, delay_only_str);                 //Print Delay only
+            output_color(output, color_default_str); 
+        }
+        else if(flags & ROW_FLAG_TERMINATE){                    //If we have full null table entry
+            output_str(output, terminate_str);                  //Print terminate
+        }
+        else if(flags & ROW_FLAG_NONE){
+            output_color(output, color_red_str);
+            output_str(output, none_str);                       //Print None(invalid)
+            output_color(output, color_default_str);
+        }
+
+        /* Register Fields Part */
+
+        if((flags & (ROW_FLAG_WRITE | ROW_FLAG_READ)) && ((field_register = get_register_fields(addr, fields)) >= 0)){
+            if(flags & ROW_FLAG_WRITE){
+                render_register_fields(output, fields, field_register, ATTR_WRITE_START_BIT(attr), (ATTR_WRITE_NO_BITS(attr) + 1), value);
+            }
+            else{
+                render_register_fields(output, fields, field_register, ATTR_READ_START_BIT(attr), (ATTR_READ_NO_BITS(attr) + 1), value);
+            }
+        }
+    
+        /* Extra Notes Part */
+        
+        if(errors && !(errors & ROW_ERROR_HIDDEN_SECTION)){
+            if(options->attribute_validity_output_format){
+                output_char(output, ' ');                   //Some alignment
+            }
+
+            output_color(output, color_red_str);
+            temp2 = 0;
+            for(temp = 0; temp < ROW_ERROR_COUNT; temp++){
+                if(errors & (1<<temp)){
+                    if((temp2<options->number_of_attribute_validity_errors_to_print)&&(options->attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
+                        output_str(output, row_error_str[temp]);
+                    }
+                    temp2++;
+                }
+            }
+
+            /* If count of omited errors is printed */
+            if(options->print_how_many_attribute_validity_errors_omited && (temp2 > options->number_of_attribute_validity_errors_to_print) && (options->attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
+                output_char(output, '(');
+                output_dec(output, (temp2-options->number_of_attribute_validity_errors_to_print));
+                output_str(output, " more)");
+            }
+
+            /* If only count of errors is to be returned */
+            if((temp2) && (options->attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_DETECTED_ERRORS_COUNT)){
+                output_char(output, '(');
+                output_dec(output, temp2);
+                output_str(output, " attribute errors)");
+            }
+            
+        
+            output_color(output, color_default_str);
+        }
+
+    }   //if(!addresses_only)
+    
+    
+    output_char(output, '\n');
+}
+
+
+/* MACHINE READABLE ROWS */
+
+/*
+ * -format=ndjson writes one JSON object per row, -format=csv one CSV line per row after a column header line.
+ * Both carry every decoded field: byte offset of the row in input, raw words, region name, base and offset, write and read flags,
+ * bit counts and start bits as shown in text output(COUNT(0-31)/START(0-31)), row type flags and the error kinds(row_format_error_list).
+ * Numbers are unsigned decimal, booleans true/false in NDJSON and 1/0 in CSV. Rows are formatted straight into the output buffer with
+ * the output_*() functions, nothing is allocated per row. Colors and -addronly/-noaddress/-printoffset don't apply.
+ * Addresses outside every region(and every address with "none" SoC) have null region fields in NDJSON and empty ones in CSV.
+ */
+
+/* Error kinds of ROW_ERROR_* bits. Section bits(ROW_ERROR_EMPTY_SECTION, ROW_ERROR_HIDDEN_SECTION) are text layout, not errors */
+const char *row_format_error_list[ROW_ERROR_COUNT] = {
+    "nulladdr",
+    "bothflags",
+    "readparams",
+    "writeparams",
+    "attr8_10",
+    "attr24_26",
+    "writesum",
+    "readsum"
+};
+
+const char *row_csv_header_str = "offset,addr,value,delay,attr,region,region_base,region_offset,write,write5,write_count,write_start,"
+                                 "read,read5,read_count,read_start,write_invalid,read_invalid,delay_only,terminate,none,errors\n";
+
+/* String with JSON escapes. Names come from CSV files */
+static void output_json_str(output_buffer_type *output, const char *str){
+    output_char(output, '"');
+    for(; *str; str++){
+        if((*str == '"') || (*str == '\\')){
+            output_char(output, '\\');
+            output_char(output, *str);
+        }
+        else if((uint8_t)*str < 0x20){
+            output_str(output, "\\u00");
+            output_char(output, hex_digits[(uint8_t)*str >> 4]);
+            output_char(output, hex_digits[*str & 0xf]);
+        }
+        else{
+            output_char(output, *str);
+        }
+    }
+    output_char(output, '"');
+}
+
+/* Quoted CSV field. Quotes are doubled */
+static void output_csv_str(output_buffer_type *output, const char *str){
+    output_char(output, '"');
+    for(; *str; str++){
+        if(*str == '"'){
+            output_char(output, '"');
+        }
+        output_char(output, *str);
+    }
+    output_char(output, '"');
+}
+
+static inline void output_json_field(output_buffer_type *output, const char *key_str, uint64_t value){
+    output_str(output, key_str);
+    output_dec(output, value);
+}
+
+static inline void output_json_bool(output_buffer_type *output, const char *key_str, uint32_t value){
+    output_str(output, key_str);
+    output_str(output, (value ? "true" : "false"));
+}
+
+static inline void output_csv_field(output_buffer_type *output, uint64_t value){
+    output_dec(output, value);
+    output_char(output, ',');
+}
+
+/* Address belongs to a named region. Unmapped addresses and "none" SoC's catch-all have no region */
+static inline uint32_t row_format_has_region(const soc_register_type *soc_register){
+    return ((soc_register != &unmapped_register) && (soc_register->register_name[0] != '\0'));
+}
+
+/* Row as NDJSON object. offset is byte offset of the row in input */
+void render_row_ndjson(output_buffer_type *output, const register_table_type *table, size_t row, uint64_t offset, const soc_register_type *soc_register){
+    uint32_t addr = table->addr[row];
+    uint32_t attr = table->attr[row];
+    uint32_t flags = table->flags[row];
+    uint32_t errors = (table->errors[row] & ROW_ERROR_MASK);
+    uint32_t separator = 0;
+
+    output_json_field(output, "{\"offset\":", offset);
+    output_json_field(output, ",\"addr\":", addr);
+    output_json_field(output, ",\"value\":", table->value[row]);
+    output_json_field(output, ",\"delay\":", table->delay[row]);
+    output_json_field(output, ",\"attr\":", attr);
+    if(row_format_has_region(soc_register)){
+        output_str(output, ",\"region\":");
+        output_json_str(output, soc_register->register_name);
+        output_json_field(output, ",\"region_base\":", soc_register->base_address);
+        output_json_field(output, ",\"region_offset\":", (addr - soc_register->base_address));
+    }
+    else{
+        output_str(output, ",\"region\":null,\"region_base\":null,\"region_offset\":null");
+    }
+    output_json_bool(output, ",\"write\":", (flags & ROW_FLAG_WRITE));
+    output_json_bool(output, ",\"write5\":", (flags & ROW_FLAG_WRITE_5));
+    output_json_field(output, ",\"write_count\":", ATTR_WRITE_NO_BITS(attr));
+    output_json_field(output, ",\"write_start\":", ATTR_WRITE_START_BIT(attr));
+    output_json_bool(output, ",\"read\":", (flags & ROW_FLAG_READ));
+    output_json_bool(output, ",\"read5\":", (flags & ROW_FLAG_READ_5));
+    output_json_field(output, ",\"read_count\":", ATTR_READ_NO_BITS(attr));
+    output_json_field(output, ",\"read_start\":", ATTR_READ_START_BIT(attr));
+    output_json_bool(output, ",\"write_invalid\":", (flags & ROW_FLAG_WRITE_INVALID));
+    output_json_bool(output, ",\"read_invalid\":", (flags & ROW_FLAG_READ_INVALID));
+    output_json_bool(output, ",\"delay_only\":", (flags & ROW_FLAG_DELAY_ONLY));
+    output_json_bool(output, ",\"terminate\":", (flags & ROW_FLAG_TERMINATE));
+    output_json_bool(output, ",\"none\":", (flags & ROW_FLAG_NONE));
+    output_str(output, ",\"errors\":[");
+    for(uint32_t i = 0; i < ROW_ERROR_COUNT; i++){
+        if(errors & (1u << i)){
+            if(separator++){
+                output_char(output, ',');
+            }
+            output_char(output, '"');
+            output_str(output, row_format_error_list[i]);
+            output_char(output, '"');
+        }
+    }
+    output_str(output, "]}\n");
+}
+
+/* Row as CSV line in row_csv_header_str order. Errors are space separated in one field */
+void render_row_csv(output_buffer_type *output, const register_table_type *table, size_t row, uint64_t offset, const soc_register_type *soc_register){
+    uint32_t addr = table->addr[row];
+    uint32_t attr = table->attr[row];
+    uint32_t flags = table->flags[row];
+    uint32_t errors = (table->errors[row] & ROW_ERROR_MASK);
+    uint32_t separator = 0;
+
+    output_csv_field(output, offset);
+    output_csv_field(output, addr);
+    output_csv_field(output, table->value[row]);
+    output_csv_field(output, table->delay[row]);
+    output_csv_field(output, attr);
+    if(row_format_has_region(soc_register)){
+        output_csv_str(output, soc_register->register_name);
+        output_char(output, ',');
+        output_csv_field(output, soc_register->base_address);
+        output_csv_field(output, (addr - soc_register->base_address));
+    }
+    else{
+        output_str(output, ",,,");
+    }
+    output_csv_field(output, ((flags & ROW_FLAG_WRITE) != 0));
+    output_csv_field(output, ((flags & ROW_FLAG_WRITE_5) != 0));
+    output_csv_field(output, ATTR_WRITE_NO_BITS(attr));
+    output_csv_field(output, ATTR_WRITE_START_BIT(attr));
+    output_csv_field(output, ((flags & ROW_FLAG_READ) != 0));
+    output_csv_field(output, ((flags & ROW_FLAG_READ_5) != 0));
+    output_csv_field(output, ATTR_READ_NO_BITS(attr));
+    output_csv_field(output, ATTR_READ_START_BIT(attr));
+    output_csv_field(output, ((flags & ROW_FLAG_WRITE_INVALID) != 0));
+    output_csv_field(output, ((flags & ROW_FLAG_READ_INVALID) != 0));
+    output_csv_field(output, ((flags & ROW_FLAG_DELAY_ONLY) != 0));
+    output_csv_field(output, ((flags & ROW_FLAG_TERMINATE) != 0));
+    output_csv_field(output, ((flags & ROW_FLAG_NONE) != 0));
+    for(uint32_t i = 0; i < ROW_ERROR_COUNT; i++){
+        if(errors & (1u << i)){
+            if(separator++){
+                output_char(output, ' ');
+            }
+            output_str(output, row_format_error_list[i]);
+        }
+    }
+    output_char(output, '\n');
+}
+
+
+/* TABLE PARSING */
+
+/* Rows decoded and rendered at a time */
+#define PARSE_CHUNK_SIZE INPUT_WINDOW_SIZE
+
+/* Render rows of decoded chunk at offset of input. Returns 1 if rendering stops at terminating null entry(-stopatnull), otherwise 0 */
+static int parse_render_rows(output_buffer_type *output, const parse_options_type *options, const soc_map_type *soc, const register_table_type *table, uint64_t offset, uint32_t *register_index_cache){
+    const soc_register_type *soc_register;
+    for(size_t i = 0; i < table->count; i++){
+        soc_register = soc_map_lookup(soc, table->addr[i], register_index_cache);
+        if(!soc->row_filter.ops ||
+           row_filter_match(&soc->row_filter, table, i, soc_register, ((soc_register == &unmapped_register) ? (uint32_t)soc->registers_count : (uint32_t)(soc_register - soc->registers)))){
+            if(options->output_format == OUTPUT_FORMAT_NDJSON){
+                render_row_ndjson(output, table, i, (offset + (i * DATA_ROW_SIZE)), soc_register);
+            }
+            else if(options->output_format == OUTPUT_FORMAT_CSV){
+                render_row_csv(output, table, i, (offset + (i * DATA_ROW_SIZE)), soc_register);
+            }
+            else{
+                render_row(output, options, table, i, soc_register, &soc->fields);
+            }
+        }
+        if(options->stop_at_null && (table->flags[i] & ROW_FLAG_TERMINATE)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Rows of [offset, end) of stream input. Rows are decoded straight from the ring, a row wrapping around the ring is copied. Returns 0 or ERROR_* (not printed) */
+static int parse_table_stream(output_buffer_type *output, const parse_options_type *options, const soc_map_type *soc, input_file_type *input, register_table_type *table, uint64_t offset, uint64_t end){
+    uint32_t register_index_cache = 0;
+    uint8_t row[DATA_ROW_SIZE];
+    const uint8_t *data;
+    size_t length;
+    ssize_t temp;
+    int result;
+
+    result = input_stream_skip(input, offset);
+    while(!result && (offset < end)){
+        length = input_stream_peek(input, &data);
+        if(length > (end - offset)){
+            length = end - offset;
+        }
+        if(length > PARSE_CHUNK_SIZE){
+            length = PARSE_CHUNK_SIZE;
+        }
+        length -= (length % DATA_ROW_SIZE);
+        if(length == 0){
+            if((input->ring_tail - input->ring_head) >= DATA_ROW_SIZE){
+                input_stream_copy(input, row, DATA_ROW_SIZE);
+                data = row;
+                length = DATA_ROW_SIZE;
+            }
+            else{
+                output_flush(output);       //Rows so far are shown while waiting for input
+                temp = input_stream_fill(input);
+                if(temp < 0){
+                    result = ERROR_READ_FILE_ERROR;
+                }
+                else if(temp == 0){
+                    result = ERROR_RANGE_EXCEEDS_FILE;
+                }
+                continue;
+            }
+        }
+        decode_register_table(table, data, length);
+        input_stream_consume(input, length);
+        if(parse_render_rows(output, options, soc, table, offset, &register_index_cache)){
+            break;
+        }
+        offset += length;
+    }
+    return result;
+}
+
+/* Header of parsed range */
+static void render_parse_header(output_buffer_type *output, const parse_options_type *options, uint64_t offset, uint64_t end){
+    if(options->output_format == OUTPUT_FORMAT_CSV){
+        output_str(output, row_csv_header_str);
+    }
+    else if((options->output_format == OUTPUT_FORMAT_TEXT) && !options->addresses_only){
+        output_str(output, "Start from ");
+        output_dec(output, offset);
+        output_str(output, " 0x");
+        output_hex(output, offset);
+        output_str(output, " - End to ");
+        output_dec(output, end);
+        output_str(output, " 0x");
+        output_hex(output, end);
+        output_str(output, " - Range ");
+        output_dec(output, (end-offset));
+        output_str(output, " 0x");
+        output_hex(output, (end-offset));
+        output_str(output, " - Rows ");
+        output_dec(output, ((end-offset)/16));
+        output_str(output, " \n");
+    }
+}
+
+/* Render header and rows of [offset, end) of input. Returns 0 or ERROR_* (not printed) */
+int parse_table(output_buffer_type *output, const parse_options_type *options, const soc_map_type *soc, input_file_type *input, uint64_t offset, uint64_t end){
+    const uint8_t *data;
+    register_table_type table;
+    uint32_t register_index_cache = 0;      //Last hit cache for get_register_index()
+    uint64_t parse_end = end;               //Rows of file are parsed up to here
+    size_t length;
+    int result = 0;
+
+    /* Check that our range doesn't exceed file. Stream length is known only at its end */
+    if(!input->stream){
+        if(input->file_size<end){
+            /* With -stopatnull table can end before the file does. Rows up to end of file are parsed like with streams */
+            if(!options->stop_at_null || (input->file_size < (offset + DATA_ROW_SIZE))){
+                return ERROR_RANGE_EXCEEDS_FILE;
+            }
+            parse_end = offset + (((input->file_size - offset) / DATA_ROW_SIZE) * DATA_ROW_SIZE);
+        }
+        if(input_map_range(input, offset, parse_end) != 0){
+            return ERROR_READ_FILE_ERROR;
+        }
+    }
+    if(alloc_register_table(&table, (PARSE_CHUNK_SIZE / DATA_ROW_SIZE)) != 0){
+        return ERROR_OUTPUT_MALLOC_FAILED;
+    }
+
+    render_parse_header(output, options, offset, end);
+
+    if(input->stream){
+        result = parse_table_stream(output, options, soc, input, &table, offset, end);
+        free_register_table(&table);
+        return result;
+    }
+
+    /* Loop */
+    while(offset<parse_end){
+        /* Decode chunk */
+        length = ((parse_end - offset) < PARSE_CHUNK_SIZE) ? (parse_end - offset) : PARSE_CHUNK_SIZE;
+        data = input_get_range(input, offset, length);
+        if(data == NULL){
+            free_register_table(&table);
+            return ERROR_READ_FILE_ERROR;
+        }
+        decode_register_table(&table, data, length);
+
+        if(parse_render_rows(output, options, soc, &table, offset, &register_index_cache)){
+            free_register_table(&table);
+            return 0;
+        }
+        offset += length;
+    }
+    free_register_table(&table);
+    return ((parse_end < end) ? ERROR_RANGE_EXCEEDS_FILE : 0);  //No terminating null entry before end of file
+}
+
+
+/* Apply size suffix at end of number: k(KiB), M(MiB) or G(GiB). Offsets of eMMC/NAND dumps go beyond 4G. Returns 0 or -1 if value overflows */
+static int apply_size_suffix(uint64_t *value, const char *end){
+    uint32_t shift;
+
+    switch(*end){
+        case 'k': shift = 10; break;
+        case 'M': shift = 20; break;
+        case 'G': shift = 30; break;
+        default:  return 0;
+    }
+    if(*value > (UINT64_MAX >> shift)){     //Doesn't fit in 64 bits
+        return -1;
+    }
+    *value <<= shift;
+    return 0;
+}
+
+/* Parse BytesOffset and BytesCount parameters. Both are 64-bit. Returns 0 or ERROR_* (printed to stderr) */
+int parse_range_parameters(const char *offset_str, const char *count_str, uint64_t *bytes_offset, uint64_t *bytes_count){
+    uint64_t temp;
+    char *end;
+
+    /* Parse bytes offset */
+    if((*offset_str<48)||(*offset_str>57)){     //Must start with a number
+        print_error_stderr(ERROR_BYTES_OFFSET_PARAMETER);          //Return bytes offset error to stderr
+        return ERROR_BYTES_OFFSET_PARAMETER;
+    }
+    *bytes_offset = strtoull(offset_str, &end, 0);                  //Store decimal or hexadecimal value
+    if(apply_size_suffix(bytes_offset, end) != 0){
+        print_error_stderr(ERROR_BYTES_OFFSET_PARAMETER);
+        return ERROR_BYTES_OFFSET_PARAMETER;
+    }
+    
+    
+    /* Parse bytes count */
+    if((*count_str<48)||(*count_str>57)){       //Must start with a number
+        print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);           //Return bytes count error to stderr
+        return ERROR_BYTES_COUNT_PARAMETER;
+    }
+    if((count_str[0]=='0')&&count_str[1]=='x'){     //If hexadecimal
+        *bytes_count = strtoull(count_str, NULL, 0);               //Store hexadecimal value    //TODO error handling
+    }
+    else{                               //Else decimal
+        *bytes_count = strtoull(count_str, &end, 10);              //Store decimal value        //TODO error handling
+        if(apply_size_suffix(bytes_count, end) != 0){              //ie. 4k
+            print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);
+            return ERROR_BYTES_COUNT_PARAMETER;
+        }
+    }
+    if(*bytes_count==0){                //Bytes count must be non-zero
+        print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);   //Return bytes count error to stderr
+        return ERROR_BYTES_COUNT_PARAMETER;  
+    }
+    if(*bytes_count > (UINT64_MAX - *bytes_offset)){    //End must not wrap around
+        print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);
+        return ERROR_BYTES_COUNT_PARAMETER;
+    }
+    if(*bytes_count%16){                //Bytes count must be %128 = 0
+        print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);   //Return bytes count error to stderr
+        temp = (*bytes_count + 15) & ~(uint64_t)15;
+        if(*bytes_count > 16){
+            fprintf(stderr, "Try: %" PRIu64 " or %" PRIu64 "?\n", temp, (temp-16));
+        }
+        else{
+            fprintf(stderr, "Try: %" PRIu64 " ?\n", temp);
+        }
+        return ERROR_BYTES_COUNT_PARAMETER;
+    }
+    return 0;
+}
+
+
+/* TABLE SCAN */
+
+/*
+ * -scan walks whole image and reports init register table candidates using start.S signatures(see header):
+ * - Run of 0x12345678 vector table padding words before the table
+ * - Trailer after the table: pointer to start, pointer to end and 0xDEADBEEF padding to 16bytes alignment
+ * Signature words are searched with SSE2/AVX2 compares(chosen at runtime) 32/64 bytes at time.
+ * Only word aligned signatures are searched as start.S places them word aligned.
+ */
+
+#define SCAN_START_SIGNATURE 0x12345678
+#define SCAN_END_SIGNATURE 0xDEADBEEF
+#define SCAN_MAX_TABLE_SIZE (256*1024)      //Max table size searched forward from start signature when there is no trailer
+
+#define SCAN_EVIDENCE_START_SIGNATURE   (1<<0)
+#define SCAN_EVIDENCE_END_SIGNATURE     (1<<1)
+#define SCAN_EVIDENCE_POINTERS_MATCH    (1<<2)
+#define SCAN_EVIDENCE_NULL_TERMINATED   (1<<3)
+#define SCAN_EVIDENCE_HEURISTIC         (1<<4)  //Found by -detect
+#define SCAN_EVIDENCE_COUNT             5
+
+const char *scan_evidence_str[SCAN_EVIDENCE_COUNT] = {
+    "(START SIGNATURE)",
+    "(END SIGNATURE)",
+    "(POINTERS MATCH)",
+    "(NULL TERMINATED)",
+    "(HEURISTIC)"
+};
+
+/* Confidence points. Sum is 100 */
+#define SCAN_CONFIDENCE_START_SIGNATURE 25
+#define SCAN_CONFIDENCE_END_SIGNATURE   15
+#define SCAN_CONFIDENCE_POINTERS_MATCH  25
+#define SCAN_CONFIDENCE_NULL_TERMINATED 15
+#define SCAN_CONFIDENCE_VALID_ROWS      20  //Scaled by fraction of rows without attribute errors
+
+typedef struct{
+    uint64_t *offsets;                      //Offsets of signature words
+    size_t count;
+    size_t size;
+} scan_hit_list_type;
+
+typedef struct{
+    uint64_t offset;
+    uint64_t length;
+    uint32_t evidence;                      //SCAN_EVIDENCE_* bits
+    uint32_t confidence;                    //0-100
+} scan_candidate_type;
+
+typedef struct{
+    scan_candidate_type *candidates;
+    size_t count;
+    size_t size;
+} scan_candidate_list_type;
+
+
+static int scan_hit_add(scan_hit_list_type *list, uint64_t offset){
+    uint64_t *temp_ptr;
+    if(list->count == list->size){
+        list->size = list->size ? (list->size * 2) : 256;
+        temp_ptr = realloc(list->offsets, (sizeof(uint64_t) * list->size));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        list->offsets = temp_ptr;
+    }
+    list->offsets[list->count++] = offset;
+    return 0;
+}
+
+/* Scalar search of [start, length). Returns -1 if malloc fails */
+static int scan_signatures_scalar(const uint8_t *data, size_t start, size_t length, uint32_t signature, uint64_t base_offset, scan_hit_list_type *list){
+    for(size_t i = start; (i + 4) <= length; i += 4){
+        if(get_le32(&data[i]) == signature){
+            if(scan_hit_add(list, (base_offset + i)) != 0){
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* Add hits of 32bit compare mask. One bit per word */
+static inline int scan_add_mask_hits(uint32_t mask, uint64_t offset, scan_hit_list_type *list){
+    while(mask){
+        if(scan_hit_add(list, (offset + (4 * __builtin_ctz(mask)))) != 0){
+            return -1;
+        }
+        mask &= (mask - 1);
+    }
+    return 0;
+}
+
+__attribute__((target("sse2")))
+static int scan_signatures_sse2(const uint8_t *data, size_t length, uint32_t signature, uint64_t base_offset, scan_hit_list_type *list){
+    const __m128i pattern = _mm_set1_epi32(signature);      //Host is little endian
+    __m128i a;
+    __m128i b;
+    uint32_t mask;
+    size_t i;
+    for(i = 0; (i + 32) <= length; i += 32){
+        a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)&data[i]), pattern);
+        b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)&data[i+16]), pattern);
+        mask = _mm_movemask_ps(_mm_castsi128_ps(a)) | (_mm_movemask_ps(_mm_castsi128_ps(b)) << 4);
+        if(mask && (scan_add_mask_hits(mask, (base_offset + i), list) != 0)){
+            return -1;
+        }
+    }
+    return scan_signatures_scalar(data, i, length, signature, base_offset, list);
+}
+
+__attribute__((target("avx2")))
+static int scan_signatures_avx2(const uint8_t *data, size_t length, uint32_t signature, uint64_t base_offset, scan_hit_list_type *list){
+    const __m256i pattern = _mm256_set1_epi32(signature);
+    __m256i a;
+    __m256i b;
+    uint32_t mask;
+    size_t i;
+    for(i = 0; (i + 64) <= length; i += 64){
+        a = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)&data[i]), pattern);
+        b = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)&data[i+32]), pattern);
+        if(_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b))){
+            continue;                       //Fast path. No hits in 64 bytes
+        }
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(a)) | (_mm256_movemask_ps(_mm256_castsi256_ps(b)) << 8);
+        if(scan_add_mask_hits(mask, (base_offset + i), list) != 0){
+            return -1;
+        }
+    }
+    return scan_signatures_scalar(data, i, length, signature, base_offset, list);
+}
+#endif
+
+/* Find word aligned signature words in data. data must be word aligned relative to base_offset */
+int scan_signatures(const uint8_t *data, size_t length, uint32_t signature, uint64_t base_offset, scan_hit_list_type *list){
+#if (defined(__x86_64__) || defined(__i386__)) && !(defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__))
+    if(__builtin_cpu_supports("avx2")){
+        return scan_signatures_avx2(data, length, signature, base_offset, list);
+    }
+    if(__builtin_cpu_supports("sse2")){
+        return scan_signatures_sse2(data, length, signature, base_offset, list);
+    }
+#endif
+    return scan_signatures_scalar(data, 0, length, signature, base_offset, list);
+}
+
+
+static int scan_candidate_add(scan_candidate_list_type *list, uint64_t offset, uint64_t length, uint32_t evidence){
+    scan_candidate_type *temp_ptr;
+    for(size_t i = 0; i < list->count; i++){
+        if((list->candidates[i].offset == offset) && (list->candidates[i].length == length)){
+            list->candidates[i].evidence |= evidence;       //Same table found by other signature
+            return 0;
+        }
+    }
+    if(list->count == list->size){
+        list->size = list->size ? (list->size * 2) : 16;
+        temp_ptr = realloc(list->candidates, (sizeof(scan_candidate_type) * list->size));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        list->candidates = temp_ptr;
+    }
+    list->candidates[list->count].offset = offset;
+    list->candidates[list->count].length = length;
+    list->candidates[list->count].evidence = evidence;
+    list->candidates[list->count].confidence = 0;
+    list->count++;
+    return 0;
+}
+
+static int scan_candidate_compare(const void *a, const void *b){
+    const scan_candidate_type *ca = a;
+    const scan_candidate_type *cb = b;
+    if(ca->offset != cb->offset){
+        return (ca->offset < cb->offset) ? -1 : 1;
+    }
+    return (ca->length < cb->length) ? -1 : (ca->length > cb->length);
+}
+
+static inline int scan_row_is_null(const uint8_t *row){
+    return !(get_le32(&row[0]) | get_le32(&row[4]) | get_le32(&row[8]) | get_le32(&row[12]));
+}
+
+/* Score candidate by its evidence and attribute validity of rows before the first full null entry */
+static void scan_score_candidate(const uint8_t *data, scan_candidate_type *candidate){
+    const uint8_t *row;
+    uint64_t rows = 0;
+    uint64_t valid_rows = 0;
+
+    for(uint64_t i = 0; i < candidate->length; i += DATA_ROW_SIZE){
+        row = &data[candidate->offset + i];
+        if(scan_row_is_null(row)){
+            candidate->evidence |= SCAN_EVIDENCE_NULL_TERMINATED;
+            break;
+        }
+        rows++;
+        if(!(get_row_errors(get_le32(&row[0]), get_le32(&row[4]), get_le32(&row[8]), get_le32(&row[12])) & ROW_ERROR_MASK)){
+            valid_rows++;
+        }
+    }
+
+    candidate->confidence = 0;
+    if(candidate->evidence & SCAN_EVIDENCE_START_SIGNATURE){
+        candidate->confidence += SCAN_CONFIDENCE_START_SIGNATURE;
+    }
+    if(candidate->evidence & SCAN_EVIDENCE_END_SIGNATURE){
+        candidate->confidence += SCAN_CONFIDENCE_END_SIGNATURE;
+    }
+    if(candidate->evidence & SCAN_EVIDENCE_POINTERS_MATCH){
+        candidate->confidence += SCAN_CONFIDENCE_POINTERS_MATCH;
+    }
+    if(candidate->evidence & SCAN_EVIDENCE_NULL_TERMINATED){
+        candidate->confidence += SCAN_CONFIDENCE_NULL_TERMINATED;
+    }
+    if(rows){
+        candidate->confidence += (uint32_t)((SCAN_CONFIDENCE_VALID_ROWS * valid_rows) / rows);
+    }
+}
+
+/* Table ends at the first full null entry run following start. Returns table length or 0 if none found within SCAN_MAX_TABLE_SIZE */
+static uint64_t scan_forward_to_null_entries(const uint8_t *data, uint64_t length, uint64_t start){
+    uint64_t offset = start;
+    uint64_t limit = ((length - start) < SCAN_MAX_TABLE_SIZE) ? length : (start + SCAN_MAX_TABLE_SIZE);
+    while((offset + DATA_ROW_SIZE) <= limit){
+        if(scan_row_is_null(&data[offset])){
+            if(offset == start){
+                return 0;                   //Empty table
+            }
+            while(((offset + DATA_ROW_SIZE) <= limit) && scan_row_is_null(&data[offset])){
+                offset += DATA_ROW_SIZE;    //Include all terminating null entries
+            }
+            return (offset - start);
+        }
+        offset += DATA_ROW_SIZE;
+    }
+    return 0;
+}
+
+/* Find candidates in data(whole image). Returns -1 if malloc fails */
+int scan_image(const uint8_t *data, uint64_t length, scan_candidate_list_type *candidates){
+    scan_hit_list_type start_hits = {NULL, 0, 0};
+    scan_hit_list_type end_hits = {NULL, 0, 0};
+    uint64_t *table_starts = NULL;          //Table start after each start signature run
+    size_t table_starts_count = 0;
+    uint64_t offset;
+    uint64_t table_end;
+    uint64_t table_length;
+    uint32_t start_pointer;
+    uint32_t end_pointer;
+    size_t i;
+    size_t j;
+    int result = -1;
+
+    memset(candidates, 0, sizeof(scan_candidate_list_type));
+
+    if((scan_signatures(data, length, SCAN_START_SIGNATURE, 0, &start_hits) != 0) ||
+       (scan_signatures(data, length, SCAN_END_SIGNATURE, 0, &end_hits) != 0)){
+        goto scan_image_exit;
+    }
+
+    /* Start signature runs. Table starts at the next 16bytes boundary after the run */
+    table_starts = malloc(sizeof(uint64_t) * (start_hits.count + 1));
+    if(table_starts == NULL){
+        goto scan_image_exit;
+    }
+    for(i = 0; i < start_hits.count; i = j){
+        for(j = i + 1; (j < start_hits.count) && (start_hits.offsets[j] == (start_hits.offsets[j-1] + 4)); j++);
+        offset = start_hits.offsets[j-1] + 4;
+        offset = (offset + (DATA_ROW_SIZE - 1)) & ~((uint64_t)DATA_ROW_SIZE - 1);
+        if(offset < length){
+            table_starts[table_starts_count++] = offset;
+        }
+    }
+
+    /* Trailers. First 0xDEADBEEF of a run is preceded by start and end pointers */
+    for(i = 0; i < end_hits.count; i++){
+        if(i && (end_hits.offsets[i] == (end_hits.offsets[i-1] + 4))){
+            continue;                       //Not first of run
+        }
+        if(end_hits.offsets[i] < 8){
+            continue;
+        }
+        table_end = end_hits.offsets[i] - 8;
+        if(table_end % DATA_ROW_SIZE){
+            continue;                       //Table size is multiple of 16 and trailer is padded to 16
+        }
+        start_pointer = get_le32(&data[table_end]);
+        end_pointer = get_le32(&data[table_end + 4]);
+        table_length = (uint64_t)(end_pointer - start_pointer);
+        if((end_pointer > start_pointer) && !(table_length % DATA_ROW_SIZE) && (table_length <= table_end)){
+            offset = table_end - table_length;
+            if(scan_candidate_add(candidates, offset, table_length, (SCAN_EVIDENCE_END_SIGNATURE | SCAN_EVIDENCE_POINTERS_MATCH)) != 0){
+                goto scan_image_exit;
+            }
+            for(j = 0; j < table_starts_count; j++){
+                if(table_starts[j] == offset){
+                    candidates->candidates[candidates->count-1].evidence |= SCAN_EVIDENCE_START_SIGNATURE;
+                    table_starts[j] = UINT64_MAX;   //Consumed
+                }
+            }
+            continue;
+        }
+        /* Pointers don't make sense. Pair with closest preceding start signature */
+        for(j = table_starts_count; j > 0; j--){
+            if((table_starts[j-1] != UINT64_MAX) && (table_starts[j-1] < table_end) && ((table_end - table_starts[j-1]) <= SCAN_MAX_TABLE_SIZE)){
+                if(scan_candidate_add(candidates, table_starts[j-1], (table_end - table_starts[j-1]), (SCAN_EVIDENCE_START_SIGNATURE | SCAN_EVIDENCE_END_SIGNATURE)) != 0){
+                    goto scan_image_exit;
+                }
+                table_starts[j-1] = UINT64_MAX;
+                break;
+            }
+        }
+    }
+
+    /* Start signatures without trailer. Table ends after first null entries */
+    for(j = 0; j < table_starts_count; j++){
+        if(table_starts[j] == UINT64_MAX){
+            continue;
+        }
+        table_length = scan_forward_to_null_entries(data, length, table_starts[j]);
+        if(table_length && (scan_candidate_add(candidates, table_starts[j], table_length, SCAN_EVIDENCE_START_SIGNATURE) != 0)){
+            goto scan_image_exit;
+        }
+    }
+
+    for(i = 0; i < candidates->count; i++){
+        scan_score_candidate(data, &candidates->candidates[i]);
+    }
+    qsort(candidates->candidates, candidates->count, sizeof(scan_candidate_type), scan_candidate_compare);
+    result = 0;
+
+scan_image_exit:
+    free(start_hits.offsets);
+    free(end_hits.offsets);
+    free(table_starts);
+    return result;
+}
+
+
+void render_scan_candidate(output_buffer_type *output, const scan_candidate_type *candidate){
+    output_color(output, color_green_str);
+    output_str(output, "Offset ");
+    output_color(output, color_default_str);
+    output_dec(output, candidate->offset);
+    output_str(output, " 0x");
+    output_hex(output, candidate->offset);
+    output_color(output, color_green_str);
+    output_str(output, " - Bytes ");
+    output_color(output, color_default_str);
+    output_dec(output, candidate->length);
+    output_str(output, " 0x");
+    output_hex(output, candidate->length);
+    output_color(output, color_green_str);
+    output_str(output, " - Rows ");
+    output_color(output, color_default_str);
+    output_dec(output, (candidate->length / DATA_ROW_SIZE));
+    output_color(output, color_green_str);
+    output_str(output, " - Confidence ");
+    output_color(output, (candidate->confidence >= 50) ? color_blue_str : color_yellow_str);
+    output_dec(output, candidate->confidence);
+    output_str(output, "% ");
+    output_color(output, color_default_str);
+    for(uint32_t i = 0; i < SCAN_EVIDENCE_COUNT; i++){
+        if(candidate->evidence & (1<<i)){
+            output_str(output, scan_evidence_str[i]);
+        }
+    }
+    output_char(output, '\n');
+}
+
+
+/* HEURISTIC TABLE DETECTION */
+
+/*
+ * -detect finds tables from images without start.S signatures by their repetitive patterns(see header).
+ * Every 16bytes aligned window of DETECT_WINDOW_ROWS rows is scored:
+ * - Per row: valid entry shape(valid flags and no attribute errors), small delay and word aligned non-null address
+ * - Per window: address clustering(rows hitting an already seen 64kB block) and recurring attribute words
+ * Window scores are updated incrementally as the window advances one row, so whole image is scored in linear time.
+ * Consecutive windows scoring at least DETECT_THRESHOLD are merged into a candidate and trimmed to valid rows.
+ */
+
+#define DETECT_WINDOW_ROWS      32
+#define DETECT_THRESHOLD        60          //Percent of maximum window score
+#define DETECT_ROW_SCORE_MAX    4
+#define DETECT_WINDOW_SCORE_MAX ((DETECT_ROW_SCORE_MAX * DETECT_WINDOW_ROWS) + (2 * (DETECT_WINDOW_ROWS - 1)))
+#define DETECT_COUNTER_SLOTS    128         //Power of two > 2*DETECT_WINDOW_ROWS
+#define DETECT_BLOCK_SHIFT      16          //Address clustering granularity(64kB)
+
+/* Counted multiset of window keys. Linear probing with backward shift deletion */
+typedef struct{
+    uint32_t keys[DETECT_COUNTER_SLOTS];
+    uint32_t counts[DETECT_COUNTER_SLOTS];  //0 = empty slot
+    uint32_t distinct;
+} detect_counter_type;
+
+static inline uint32_t detect_counter_slot(uint32_t key){
+    return ((key * 0x9E3779B1u) >> 16) & (DETECT_COUNTER_SLOTS - 1);
+}
+
+static void detect_counter_add(detect_counter_type *counter, uint32_t key){
+    uint32_t i = detect_counter_slot(key);
+    while(counter->counts[i] && (counter->keys[i] != key)){
+        i = (i + 1) & (DETECT_COUNTER_SLOTS - 1);
+    }
+    if(!counter->counts[i]){
+        counter->keys[i] = key;
+        counter->distinct++;
+    }
+    counter->counts[i]++;
+}
+
+static void detect_counter_remove(detect_counter_type *counter, uint32_t key){
+    uint32_t i = detect_counter_slot(key);
+    uint32_t j;
+    uint32_t home;
+    while(counter->keys[i] != key){
+        i = (i + 1) & (DETECT_COUNTER_SLOTS - 1);
+    }
+    if(--counter->counts[i]){
+        return;
+    }
+    counter->distinct--;
+    /* Backward shift following entries of the probe sequence */
+    j = i;
+    while(1){
+        j = (j + 1) & (DETECT_COUNTER_SLOTS - 1);
+        if(!counter->counts[j]){
+            break;
+        }
+        home = detect_counter_slot(counter->keys[j]);
+        if(((j - home) & (DETECT_COUNTER_SLOTS - 1)) >= ((j - i) & (DETECT_COUNTER_SLOTS - 1))){
+            counter->keys[i] = counter->keys[j];
+            counter->counts[i] = counter->counts[j];
+            counter->counts[j] = 0;
+            i = j;
+        }
+    }
+}
+
+/* 0-DETECT_ROW_SCORE_MAX */
+static inline uint32_t detect_row_score(const uint8_t *row){
+    uint32_t addr = get_le32(&row[0]);
+    uint32_t value = get_le32(&row[4]);
+    uint32_t delay = get_le32(&row[8]);
+    uint32_t attr = get_le32(&row[12]);
+    uint32_t write_flag = (attr&0x7);
+    uint32_t read_flag = ((attr>>16)&0x7);
+    uint32_t score = 0;
+
+    if(((write_flag==VALID_WRITE_FLAG_4)||(write_flag==VALID_WRITE_FLAG_5)) ? (read_flag==VALID_NO_READ_FLAG) :
+       ((read_flag==VALID_READ_FLAG_4)||(read_flag==VALID_READ_FLAG_5)) ? (write_flag==VALID_NO_WRITE_FLAG) :
+       ((write_flag==VALID_NO_WRITE_FLAG)&&(read_flag==VALID_NO_READ_FLAG)&&delay)){          //Write, read or delay only
+        if(!(get_row_errors(addr, value, delay, attr) & ROW_ERROR_MASK)){
+            score += 2;
+        }
+    }
+    if(delay < 0x10000){
+        score++;
+    }
+    if(addr && !(addr&0x3)){
+        score++;
+    }
+    return score;
+}
+
+static int detect_emit_candidate(const uint8_t *data, uint64_t length, uint64_t start_row, uint64_t end_row, uint32_t score, scan_candidate_list_type *candidates){
+    uint64_t start = start_row * DATA_ROW_SIZE;
+    uint64_t end = end_row * DATA_ROW_SIZE;
+    uint32_t evidence = SCAN_EVIDENCE_HEURISTIC;
+    /* Trim rows that don't look like entries */
+    while((start < end) && (detect_row_score(&data[start]) < 3)){
+        start += DATA_ROW_SIZE;
+    }
+    while((end > start) && (detect_row_score(&data[end - DATA_ROW_SIZE]) < 3)){
+        end -= DATA_ROW_SIZE;
+    }
+    if(start >= end){
+        return 0;
+    }
+    /* Include terminating null entry */
+    if(((end + DATA_ROW_SIZE) <= length) && scan_row_is_null(&data[end])){
+        end += DATA_ROW_SIZE;
+        evidence |= SCAN_EVIDENCE_NULL_TERMINATED;
+    }
+    if(scan_candidate_add(candidates, start, (end - start), evidence) != 0){
+        return -1;
+    }
+    candidates->candidates[candidates->count-1].confidence = score;
+    return 0;
+}
+
+static int detect_candidate_compare(const void *a, const void *b){
+    const scan_candidate_type *ca = a;
+    const scan_candidate_type *cb = b;
+    if(ca->confidence != cb->confidence){
+        return (ca->confidence > cb->confidence) ? -1 : 1;      //Best first
+    }
+    return scan_candidate_compare(a, b);
+}
+
+/* Find candidates in data(whole image) ranked by score. Returns -1 if malloc fails */
+int detect_image(const uint8_t *data, uint64_t length, scan_candidate_list_type *candidates){
+    detect_counter_type *blocks;
+    detect_counter_type *attrs;
+    uint64_t rows = length / DATA_ROW_SIZE;
+    uint64_t window_row_score = 0;          //Sum of row scores in window
+    uint64_t window_non_null = 0;           //Non-null rows in window
+    uint64_t run_start = 0;
+    uint64_t run_end = 0;
+    uint64_t run_score_sum = 0;
+    uint64_t run_windows = 0;
+    uint32_t score;
+    const uint8_t *row;
+
+    memset(candidates, 0, sizeof(scan_candidate_list_type));
+    blocks = calloc(2, sizeof(detect_counter_type));
+    if(blocks == NULL){
+        return -1;
+    }
+    attrs = &blocks[1];
+
+    for(uint64_t i = 0; i <= rows; i++){
+        if(i < rows){
+            /* Row enters window */
+            row = &data[i * DATA_ROW_SIZE];
+            if(!scan_row_is_null(row)){
+                window_row_score += detect_row_score(row);
+                window_non_null++;
+                detect_counter_add(blocks, (get_le32(&row[0]) >> DETECT_BLOCK_SHIFT));
+                detect_counter_add(attrs, get_le32(&row[12]));
+            }
+            /* Row leaves window */
+            if(i >= DETECT_WINDOW_ROWS){
+                row = &data[(i - DETECT_WINDOW_ROWS) * DATA_ROW_SIZE];
+                if(!scan_row_is_null(row)){
+                    window_row_score -= detect_row_score(row);
+                    window_non_null--;
+                    detect_counter_remove(blocks, (get_le32(&row[0]) >> DETECT_BLOCK_SHIFT));
+                    detect_counter_remove(attrs, get_le32(&row[12]));
+                }
+            }
+            if((i + 1) < DETECT_WINDOW_ROWS){
+                continue;                   //Window not full yet
+            }
+            score = (uint32_t)((100 * (window_row_score + (window_non_null - blocks->distinct) + (window_non_null - attrs->distinct))) / DETECT_WINDOW_SCORE_MAX);
+        }
+        else{
+            score = 0;                      //Flush last run
+        }
+
+        if(score >= DETECT_THRESHOLD){
+            if(!run_windows){
+                run_start = i + 1 - DETECT_WINDOW_ROWS;
+            }
+            run_end = i + 1;
+            run_score_sum += score;
+            run_windows++;
+        }
+        else if(run_windows){
+            if(detect_emit_candidate(data, length, run_start, run_end, (uint32_t)(run_score_sum / run_windows), candidates) != 0){
+                free(blocks);
+                return -1;
+            }
+            run_windows = 0;
+            run_score_sum = 0;
+        }
+    }
+
+    free(blocks);
+    qsort(candidates->candidates, candidates->count, sizeof(scan_candidate_type), detect_candidate_compare);
+    return 0;
+}
+
+
+/* WINDOWED SEARCH */
+
+/*
+ * -scan, -detect and -batch scan search the image a window at a time so multi-gigabyte images(full eMMC/NAND dumps) are searched
+ * with a bounded working set. Window owns SEARCH_WINDOW_STEP bytes and also sees SEARCH_WINDOW_LEAD bytes before and SEARCH_WINDOW_TAIL
+ * bytes after it. A candidate is kept only by the window owning its start offset, so tables crossing a window boundary are found once.
+ * Tables(and -detect runs) longer than SEARCH_WINDOW_TAIL crossing a boundary are not found. Images up to STEP+TAIL are one window.
+ */
+
+#define SEARCH_WINDOW_STEP (64*1024*1024)   //Multiple of DATA_ROW_SIZE and page size
+#define SEARCH_WINDOW_LEAD (64*1024)        //Start signature runs before the window
+#define SEARCH_WINDOW_TAIL (4*1024*1024)    //Tables starting in the window and ending after it. > SCAN_MAX_TABLE_SIZE
+
+/* Search whole input with search_image(scan_image or detect_image). Candidates are sorted with compare. Returns 0 or ERROR_* (not printed, candidates are freed) */
+int search_input(input_file_type *input, int (*search_image)(const uint8_t*, uint64_t, scan_candidate_list_type*), int (*compare)(const void*, const void*), scan_candidate_list_type *candidates){
+    scan_candidate_list_type window_candidates;
+    scan_candidate_type *temp_ptr;
+    const uint8_t *data = NULL;
+    uint64_t base = 0;
+    uint64_t start;
+    uint64_t end;
+    uint32_t windows_count = 0;
+
+    memset(candidates, 0, sizeof(scan_candidate_list_type));
+    if(input->file_size && (input_map_range(input, 0, input->file_size) != 0)){
+        return ERROR_READ_FILE_ERROR;
+    }
+    do{
+        start = (base > SEARCH_WINDOW_LEAD) ? (base - SEARCH_WINDOW_LEAD) : 0;
+        end = ((input->file_size - base) > (SEARCH_WINDOW_STEP + SEARCH_WINDOW_TAIL)) ? (base + SEARCH_WINDOW_STEP + SEARCH_WINDOW_TAIL) : input->file_size;
+        if((end > start) && ((data = input_get_range(input, start, (size_t)(end - start))) == NULL)){
+            free(candidates->candidates);
+            return ERROR_READ_FILE_ERROR;
+        }
+        if(search_image(data, (end - start), &window_candidates) != 0){
+            free(candidates->candidates);
+            return ERROR_SCAN_MALLOC_FAILED;
+        }
+
+        /* Keep candidates owned by this window. Last window owns everything after its base */
+        for(size_t i = 0; i < window_candidates.count; i++){
+            window_candidates.candidates[i].offset += start;
+            if((window_candidates.candidates[i].offset < base) ||
+               ((end < input->file_size) && (window_candidates.candidates[i].offset >= (base + SEARCH_WINDOW_STEP)))){
+                continue;
+            }
+            if(candidates->count == candidates->size){
+                candidates->size = candidates->size ? (candidates->size * 2) : 16;
+                temp_ptr = realloc(candidates->candidates, (sizeof(scan_candidate_type) * candidates->size));
+                if(temp_ptr == NULL){
+                    free(window_candidates.candidates);
+                    free(candidates->candidates);
+                    return ERROR_SCAN_MALLOC_FAILED;
+                }
+                candidates->candidates = temp_ptr;
+            }
+            candidates->candidates[candidates->count++] = window_candidates.candidates[i];
+        }
+        free(window_candidates.candidates);
+        windows_count++;
+        base += SEARCH_WINDOW_STEP;
+    }while(end < input->file_size);
+
+    if(windows_count > 1){
+        qsort(candidates->candidates, candidates->count, sizeof(scan_candidate_type), compare);
+    }
+    return 0;
+}
+
+
+/* FINGERPRINT INDEX */
+
+/*
+ * Tables embedded in many firmware builds are recognized by a fingerprint of their content: 64bit hash of the rows(addr, value,
+ * delay and attr words) up to the first terminating null entry, and the number of those rows. With -index=IndexFile
+ * -batch prints "Known table" with the label and first seen source instead of parsing a table already in the index, and
+ * adds new tables(label from -label=Name or source file name). -scan marks known candidates. -fingerprint manages the index.
+ * - Index file is an open addressing hash table(power of two slots, linear probing) followed by label and source strings.
+ *   It is mmap()ed and searched in place without locks. Native endian, FINGERPRINT_FILE_VERSION.
+ * - Tables added during the run go to FINGERPRINT_SHARDS in-memory shards, each with own mutex and hash table, so batch workers
+ *   rarely contend. At the end mapped and added entries are written to a new index file(temporary file and rename).
+ * - With -jobs>1 the worker that adds a duplicate first is its "first seen" source. -jobs=1 is deterministic.
+ */
+
+#define FINGERPRINT_FILE_MAGIC "HIRTIDX"
+#define FINGERPRINT_FILE_VERSION 1
+#define FINGERPRINT_FILE_BYTE_ORDER 0x01020304
+#define FINGERPRINT_SHARDS 64               //Power of two. Selected by top bits of hash
+#define FINGERPRINT_SHARD_MIN_SLOTS 64      //Power of two
+
+typedef struct{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;                    //FINGERPRINT_FILE_BYTE_ORDER in host order
+    uint64_t entries_count;
+    uint64_t slots_count;                   //Power of two
+    uint64_t strings_size;
+} fingerprint_file_header_type;
+
+/* Followed by slots and strings */
+typedef struct{
+    uint64_t hash;
+    uint64_t source_offset;                 //Table offset in source file
+    uint32_t rows;                          //0 = empty slot
+    uint32_t label_offset;                  //Offset in strings
+    uint32_t source_path_offset;            //Offset in strings
+    uint32_t reserved;
+} fingerprint_file_slot_type;
+
+typedef struct{
+    uint64_t hash;
+    uint64_t source_offset;
+    uint32_t rows;
+    const char *label;
+    const char *source_path;
+} fingerprint_entry_type;
+
+typedef struct{
+    pthread_mutex_t mutex;
+    fingerprint_entry_type *entries;        //Strings are malloc()ed
+    uint32_t count;
+    uint32_t size;
+    uint32_t *slots;                        //Entry index + 1. 0 = empty
+    uint32_t slots_count;
+} fingerprint_shard_type;
+
+typedef struct fingerprint_index_struct{
+    const char *path;
+    uint8_t *file_ptr;                      //mmap() of index file. NULL if there is no file yet
+    size_t file_length;
+    const fingerprint_file_header_type *header;
+    const fingerprint_file_slot_type *file_slots;
+    const char *strings;
+    fingerprint_shard_type shards[FINGERPRINT_SHARDS];
+} fingerprint_index_type;
+
+
+/* Fingerprint of rows before the first terminating null entry of data. Words are hashed as loaded(little endian), so hash is host independent */
+uint64_t fingerprint_rows(const uint8_t *data, uint64_t length, uint32_t *rows){
+    uint64_t hash;
+    uint64_t word;
+    uint64_t offset;
+
+    for(offset = 0; ((offset + DATA_ROW_SIZE) <= length) && !scan_row_is_null(&data[offset]); offset += DATA_ROW_SIZE);
+    *rows = (uint32_t)(offset / DATA_ROW_SIZE);
+    hash = 0x9e3779b97f4a7c15ull ^ *rows;
+    for(uint64_t i = 0; i < offset; i += 8){
+        word = get_le32(&data[i]) | ((uint64_t)get_le32(&data[i + 4]) << 32);
+        hash = (hash ^ (word * 0xff51afd7ed558ccdull));
+        hash = ((hash << 31) | (hash >> 33)) * 0xc4ceb9fe1a85ec53ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/* Load index file of path. Missing file is an empty index. Returns 0 or ERROR_* (not printed) */
+int load_fingerprint_index(fingerprint_index_type *index, const char *path){
+    struct stat file_stat;
+    uint64_t occupied = 0;
+    void *map_ptr;
+    int fd;
+
+    memset(index, 0, sizeof(fingerprint_index_type));
+    index->path = path;
+    for(uint32_t i = 0; i < FINGERPRINT_SHARDS; i++){
+        pthread_mutex_init(&index->shards[i].mutex, NULL);
+    }
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0){
+        return (errno == ENOENT) ? 0 : ERROR_FINGERPRINT_INDEX_FILE;
+    }
+    if((fstat(fd, &file_stat) != 0) || (file_stat.st_size < (off_t)sizeof(fingerprint_file_header_type))){
+        close(fd);
+        return ERROR_FINGERPRINT_INDEX_FILE;
+    }
+    map_ptr = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map_ptr == MAP_FAILED){
+        return ERROR_FINGERPRINT_INDEX_FILE;
+    }
+    index->file_ptr = map_ptr;
+    index->file_length = file_stat.st_size;
+    index->header = map_ptr;
+    index->file_slots = (const fingerprint_file_slot_type*)(index->header + 1);
+    index->strings = (const char*)(index->file_slots + index->header->slots_count);
+
+    if((memcmp(index->header->magic, FINGERPRINT_FILE_MAGIC, sizeof(FINGERPRINT_FILE_MAGIC)) != 0) ||
+       (index->header->version != FINGERPRINT_FILE_VERSION) || (index->header->byte_order != FINGERPRINT_FILE_BYTE_ORDER) ||
+       !index->header->slots_count || (index->header->slots_count & (index->header->slots_count - 1)) ||
+       (index->header->entries_count > (index->header->slots_count / 2)) ||       //Probing always ends at an empty slot
+       (index->header->slots_count > (index->file_length / sizeof(fingerprint_file_slot_type))) ||
+       (index->file_length != (sizeof(fingerprint_file_header_type) + (sizeof(fingerprint_file_slot_type) * index->header->slots_count) + index->header->strings_size)) ||
+       (index->header->strings_size && index->strings[index->header->strings_size - 1])){
+        munmap(map_ptr, file_stat.st_size);
+        index->file_ptr = NULL;
+        return ERROR_FINGERPRINT_INDEX_FILE;
+    }
+
+    /* entries_count is only a header field. Occupied slots must fit it too, else probing never reaches an empty slot */
+    for(uint64_t i = 0; i < index->header->slots_count; i++){
+        occupied += (index->file_slots[i].rows != 0);
+    }
+    if(occupied > index->header->entries_count){
+        munmap(map_ptr, file_stat.st_size);
+        index->file_ptr = NULL;
+        return ERROR_FINGERPRINT_INDEX_FILE;
+    }
+    return 0;
+}
+
+/* Search mapped index file. No locks, file is read only. Returns 1 and entry if found, otherwise 0 */
+static int fingerprint_file_find(const fingerprint_index_type *index, uint64_t hash, uint32_t rows, fingerprint_entry_type *entry){
+    const fingerprint_file_slot_type *slot;
+    uint64_t mask;
+
+    if(index->file_ptr == NULL){
+        return 0;
+    }
+    mask = index->header->slots_count - 1;
+    for(uint64_t i = (hash & mask); ; i = ((i + 1) & mask)){
+        slot = &index->file_slots[i];
+        if(slot->rows == 0){
+            return 0;
+        }
+        if((slot->hash == hash) && (slot->rows == rows) &&
+           (slot->label_offset < index->header->strings_size) && (slot->source_path_offset < index->header->strings_size)){
+            entry->hash = hash;
+            entry->rows = rows;
+            entry->source_offset = slot->source_offset;
+            entry->label = &index->strings[slot->label_offset];
+            entry->source_path = &index->strings[slot->source_path_offset];
+            return 1;
+        }
+    }
+}
+
+/* Slot of hash in shard: entry index + 1 or empty slot. Shard must be locked */
+static uint32_t *fingerprint_shard_slot(fingerprint_shard_type *shard, uint64_t hash, uint32_t rows){
+    uint32_t mask = shard->slots_count - 1;
+    fingerprint_entry_type *entry;
+    for(uint32_t i = ((uint32_t)hash & mask); ; i = ((i + 1) & mask)){
+        if(shard->slots[i] == 0){
+            return &shard->slots[i];
+        }
+        entry = &shard->entries[shard->slots[i] - 1];
+        if((entry->hash == hash) && (entry->rows == rows)){
+            return &shard->slots[i];
+        }
+    }
+}
+
+/* Grow shard hash table when it gets half full. Returns 0 or -1 */
+static int fingerprint_shard_reserve(fingerprint_shard_type *shard){
+    fingerprint_entry_type *temp_ptr;
+    uint32_t *slots;
+    uint32_t slots_count;
+    uint32_t *slot;
+    uint32_t *old_slots = shard->slots;
+
+    if(shard->count == shard->size){
+        shard->size = shard->size ? (shard->size * 2) : 16;
+        temp_ptr = realloc(shard->entries, (sizeof(fingerprint_entry_type) * shard->size));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        shard->entries = temp_ptr;
+    }
+    if((2 * (shard->count + 1)) <= shard->slots_count){
+        return 0;
+    }
+    slots_count = shard->slots_count ? (shard->slots_count * 2) : FINGERPRINT_SHARD_MIN_SLOTS;
+    slots = calloc(slots_count, sizeof(uint32_t));
+    if(slots == NULL){
+        return -1;
+    }
+    shard->slots = slots;
+    shard->slots_count = slots_count;
+    for(uint32_t i = 0; i < shard->count; i++){
+        slot = fingerprint_shard_slot(shard, shard->entries[i].hash, shard->entries[i].rows);
+        *slot = i + 1;
+    }
+    free(old_slots);
+    return 0;
+}
+
+/*
+ * Find table in index or add it with source and label(NULL = source file name).
+ * Returns 1 and known entry if found, 0 if added, -1 if malloc fails. Thread safe.
+ */
+int fingerprint_index_add(fingerprint_index_type *index, uint64_t hash, uint32_t rows, const char *source_path, uint64_t source_offset, const char *label, fingerprint_entry_type *known){
+    fingerprint_shard_type *shard = &index->shards[hash >> 58];     //Top 6 bits. FINGERPRINT_SHARDS
+    fingerprint_entry_type *entry;
+    uint32_t *slot;
+    int result = 0;
+
+    if(fingerprint_file_find(index, hash, rows, known)){
+        return 1;
+    }
+    if(label == NULL){
+        label = strrchr(source_path, '/') ? (strrchr(source_path, '/') + 1) : source_path;
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+    if(fingerprint_shard_reserve(shard) != 0){
+        result = -1;
+    }
+    else{
+        slot = fingerprint_shard_slot(shard, hash, rows);
+        if(*slot){
+            *known = shard->entries[*slot - 1];
+            result = 1;
+        }
+        else{
+            entry = &shard->entries[shard->count];
+            entry->hash = hash;
+            entry->rows = rows;
+            entry->source_offset = source_offset;
+            entry->label = strdup(label);
+            entry->source_path = strdup(source_path);
+            if((entry->label == NULL) || (entry->source_path == NULL)){
+                free((char*)entry->label);
+                free((char*)entry->source_path);
+                result = -1;
+            }
+            else{
+                *slot = ++shard->count;
+            }
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return result;
+}
+
+/* Find table in index. Returns 1 and known entry if found, otherwise 0. Thread safe */
+int fingerprint_index_find(fingerprint_index_type *index, uint64_t hash, uint32_t rows, fingerprint_entry_type *known){
+    fingerprint_shard_type *shard = &index->shards[hash >> 58];
+    uint32_t *slot;
+    int result = 0;
+
+    if(fingerprint_file_find(index, hash, rows, known)){
+        return 1;
+    }
+    pthread_mutex_lock(&shard->mutex);
+    if(shard->slots_count){
+        slot = fingerprint_shard_slot(shard, hash, rows);
+        if(*slot){
+            *known = shard->entries[*slot - 1];
+            result = 1;
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return result;
+}
+
+/* Tables added during this run */
+uint32_t fingerprint_index_added(const fingerprint_index_type *index){
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < FINGERPRINT_SHARDS; i++){
+        count += index->shards[i].count;
+    }
+    return count;
+}
+
+/* Place entry to slots and its strings to memory output strings. Returns 0 or -1 */
+static int fingerprint_file_put(fingerprint_file_slot_type *slots, uint64_t slots_count, const fingerprint_entry_type *entry, output_buffer_type *strings){
+    uint64_t mask = slots_count - 1;
+    uint64_t i;
+
+    for(i = (entry->hash & mask); slots[i].rows; i = ((i + 1) & mask));
+    slots[i].hash = entry->hash;
+    slots[i].rows = entry->rows;
+    slots[i].source_offset = entry->source_offset;
+    slots[i].label_offset = strings->length;
+    output_data(strings, entry->label, (strlen(entry->label) + 1));
+    slots[i].source_path_offset = strings->length;
+    output_data(strings, entry->source_path, (strlen(entry->source_path) + 1));
+    return (strings->error || (strings->length > UINT32_MAX)) ? -1 : 0;
+}
+
+/* Write mapped and added entries to index file. Returns 0 or ERROR_* (not printed) */
+int save_fingerprint_index(fingerprint_index_type *index){
+    fingerprint_file_header_type header;
+    fingerprint_file_slot_type *slots;
+    fingerprint_entry_type entry;
+    output_buffer_type strings;
+    output_buffer_type output;
+    uint64_t entries_count = fingerprint_index_added(index);
+    uint64_t slots_count = FINGERPRINT_SHARD_MIN_SLOTS;
+    char *temp_path;
+    int result = 0;
+    int fd;
+
+    if(index->file_ptr){
+        entries_count += index->header->entries_count;
+    }
+    while(slots_count < (2 * entries_count)){
+        slots_count *= 2;
+    }
+    slots = calloc(slots_count, sizeof(fingerprint_file_slot_type));
+    temp_path = malloc(strlen(index->path) + 16);
+    if((slots == NULL) || (temp_path == NULL) || (output_open(&strings, OUTPUT_FD_MEMORY, 0) != 0)){
+        free(slots);
+        free(temp_path);
+        return ERROR_FINGERPRINT_MALLOC_FAILED;
+    }
+
+    /* Mapped entries, then added ones */
+    for(uint64_t i = 0; index->file_ptr && (i < index->header->slots_count) && !result; i++){
+        if(index->file_slots[i].rows && fingerprint_file_find(index, index->file_slots[i].hash, index->file_slots[i].rows, &entry)){
+            result = fingerprint_file_put(slots, slots_count, &entry, &strings);
+        }
+    }
+    for(uint32_t i = 0; (i < FINGERPRINT_SHARDS) && !result; i++){
+        for(uint32_t j = 0; (j < index->shards[i].count) && !result; j++){
+            result = fingerprint_file_put(slots, slots_count, &index->shards[i].entries[j], &strings);
+        }
+    }
+    if(result){
+        free(slots);
+        free(temp_path);
+        free(strings.buffer);
+        return ERROR_FINGERPRINT_MALLOC_FAILED;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FINGERPRINT_FILE_MAGIC, sizeof(FINGERPRINT_FILE_MAGIC));
+    header.version = FINGERPRINT_FILE_VERSION;
+    header.byte_order = FINGERPRINT_FILE_BYTE_ORDER;
+    header.entries_count = entries_count;
+    header.slots_count = slots_count;
+    header.strings_size = strings.length;
+
+    result = ERROR_FINGERPRINT_INDEX_FILE;
+    sprintf(temp_path, "%s.%d", index->path, (int)getpid());
+    fd = open(temp_path, (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+    if((fd >= 0) && (output_open(&output, fd, 0) == 0)){
+        output_data(&output, (const char*)&header, sizeof(header));
+        output_data(&output, (const char*)slots, (sizeof(fingerprint_file_slot_type) * slots_count));
+        output_data(&output, strings.buffer, strings.length);
+        output_close(&output);
+        if((close(fd) != 0) || output.error || (rename(temp_path, index->path) != 0)){
+            unlink(temp_path);
+        }
+        else{
+            result = 0;
+        }
+    }
+    else if(fd >= 0){
+        close(fd);
+        unlink(temp_path);
+    }
+    free(slots);
+    free(temp_path);
+    free(strings.buffer);
+    return result;
+}
+
+void free_fingerprint_index(fingerprint_index_type *index){
+    for(uint32_t i = 0; i < FINGERPRINT_SHARDS; i++){
+        for(uint32_t j = 0; j < index->shards[i].count; j++){
+            free((char*)index->shards[i].entries[j].label);
+            free((char*)index->shards[i].entries[j].source_path);
+        }
+        free(index->shards[i].entries);
+        free(index->shards[i].slots);
+        pthread_mutex_destroy(&index->shards[i].mutex);
+    }
+    if(index->file_ptr){
+        munmap(index->file_ptr, index->file_length);
+    }
+    memset(index, 0, sizeof(fingerprint_index_type));
+}
+
+/* "Known table LABEL - First seen SOURCE 0xOFFSET - Fingerprint HASH" */
+void render_known_table(output_buffer_type *output, const fingerprint_entry_type *known){
+    output_color(output, color_blue_str);
+    output_str(output, "Known table ");
+    output_color(output, color_default_str);
+    output_str(output, known->label);
+    output_color(output, color_green_str);
+    output_str(output, " - First seen ");
+    output_color(output, color_default_str);
+    output_str(output, known->source_path);
+    output_str(output, " 0x");
+    output_hex(output, known->source_offset);
+    output_color(output, color_green_str);
+    output_str(output, " - Fingerprint ");
+    output_color(output, color_default_str);
+    output_hex64(output, known->hash);
+    output_char(output, '\n');
+}
+
+/* Known table line of -scan candidate. Nothing if candidate isn't in index */
+void render_known_candidate(output_buffer_type *output, fingerprint_index_type *index, input_file_type *input, const scan_candidate_type *candidate){
+    fingerprint_entry_type known;
+    const uint8_t *data;
+    uint64_t hash;
+    uint32_t rows;
+
+    data = input_get_range(input, candidate->offset, (size_t)candidate->length);
+    if(data == NULL){
+        return;
+    }
+    hash = fingerprint_rows(data, candidate->length, &rows);
+    if(rows && fingerprint_index_find(index, hash, rows, &known)){
+        output_str(output, "  ");
+        render_known_table(output, &known);
+    }
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - "-scan" or "-detect"
+ argv[2]    - inputfile
+ argv[>=3]  - optional parameters
+ */
+
+int search_image_main(int argc, char **argv, int (*search_image)(const uint8_t*, uint64_t, scan_candidate_list_type*), int (*compare)(const void*, const void*), const char *title_str){
+    input_file_type input;
+    output_buffer_type output;
+    scan_candidate_list_type candidates;
+    parse_options_type options = default_parse_options;
+    fingerprint_index_type fingerprints;
+    uint32_t fingerprints_loaded = 0;
+    int result;
+
+    if(argc < 3){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+    if(process_optional_parameters(argc, argv, 3, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+    result = input_open_file(&input, argv[2]);
+    if(result != 0){
+        print_error_stderr(result);
+        return result;
+    }
+    result = search_input(&input, search_image, compare, &candidates);
+    if(result != 0){
+        input_close(&input);
+        print_error_stderr(result);
+        return result;
+    }
+    if(options.fingerprint_index_filename){
+        result = load_fingerprint_index(&fingerprints, options.fingerprint_index_filename);
+        if(result != 0){
+            free(candidates.candidates);
+            input_close(&input);
+            print_error_stderr(result);
+            return result;
+        }
+        fingerprints_loaded = 1;
+    }
+    if(output_open(&output, STDOUT_FILENO, options.color_enabled) != 0){
+        if(fingerprints_loaded){
+            free_fingerprint_index(&fingerprints);
+        }
+        free(candidates.candidates);
+        input_close(&input);
+        print_error_stderr(ERROR_OUTPUT_MALLOC_FAILED);
+        return ERROR_OUTPUT_MALLOC_FAILED;
+    }
+
+    output_str(&output, title_str);
+    output_str(&output, argv[2]);
+    output_str(&output, " - Size ");
+    output_dec(&output, input.file_size);
+    output_str(&output, " 0x");
+    output_hex(&output, input.file_size);
+    output_str(&output, " - Candidates ");
+    output_dec(&output, candidates.count);
+    output_str(&output, " \n");
+    for(size_t i = 0; i < candidates.count; i++){
+        render_scan_candidate(&output, &candidates.candidates[i]);
+        if(fingerprints_loaded){
+            render_known_candidate(&output, &fingerprints, &input, &candidates.candidates[i]);
+        }
+    }
+
+    output_close(&output);
+    if(fingerprints_loaded){
+        free_fingerprint_index(&fingerprints);
+    }
+    free(candidates.candidates);
+    input_close(&input);
+    return 0;
+}
+
+int scan_main(int argc, char **argv){
+    return search_image_main(argc, argv, scan_image, scan_candidate_compare, "Scan ");
+}
+
+int detect_main(int argc, char **argv){
+    return search_image_main(argc, argv, detect_image, detect_candidate_compare, "Detect ");
+}
+
+
+/* BATCH */
+
+/*
+ * -batch parses many images in one process. SoC is loaded once and shared(read only) by worker threads.
+ * - Input is a directory(regular files, sorted by name) or a list file with one path per line.
+ * - Each worker has own deque of files, filled round robin. Worker takes files from the front of its own deque
+ *   and steals from the back of other deques when own is empty, so files complete roughly in input order.
+ * - With -outdir=DIR every file is written to DIR/<file name>.txt by the worker.
+ *   Otherwise outputs are collected in memory and written to stdout in input order with "==> file <==" headers.
+ * - Errors are reported to stderr in input order.
+ */
+
+#define BATCH_MAX_JOBS 256
+
+typedef struct{
+    char *path;
+    output_buffer_type output;
+    int32_t result;                         //0 or ERROR_*
+    uint32_t done;
+} batch_file_type;
+
+typedef struct{
+    pthread_mutex_t mutex;
+    uint32_t *files;                        //Indexes to batch_file_type array
+    uint32_t head;                          //Owner takes from here
+    uint32_t tail;                          //Thieves take from here
+} batch_deque_type;
+
+typedef struct batch_struct{
+    batch_file_type *files;
+    uint32_t files_count;
+    batch_deque_type *deques;
+    uint32_t deques_count;
+    const parse_options_type *options;
+    const soc_map_type *soc;
+    int32_t (*process_file)(struct batch_struct *batch, batch_file_type *file, uint32_t worker_index);   //Renders file into file->output. Returns 0 or ERROR_*
+    void *context;                          //Mode specific state for process_file
+    uint32_t scan;                          //Parse every -scan candidate instead of fixed range
+    fingerprint_index_type *fingerprints;   //Known tables are not parsed. NULL without -index
+    uint64_t bytes_offset;
+    uint64_t bytes_count;
+    pthread_mutex_t done_mutex;
+    pthread_cond_t done_cond;
+} batch_type;
+
+typedef struct{
+    batch_type *batch;
+    uint32_t worker_index;
+    pthread_t thread;
+    uint32_t started;                       //Thread was created and must be joined
+} batch_worker_type;
+
+
+/* Returns next file index for worker or -1 when all deques are empty */
+static int64_t batch_next_file(batch_type *batch, uint32_t worker_index){
+    batch_deque_type *deque = &batch->deques[worker_index];
+    int64_t file_index = -1;
+
+    pthread_mutex_lock(&deque->mutex);
+    if(deque->head < deque->tail){
+        file_index = deque->files[deque->head++];
+    }
+    pthread_mutex_unlock(&deque->mutex);
+    
+    /* Steal */
+    for(uint32_t i = 1; (file_index < 0) && (i < batch->deques_count); i++){
+        deque = &batch->deques[(worker_index + i) % batch->deques_count];
+        pthread_mutex_lock(&deque->mutex);
+        if(deque->head < deque->tail){
+            file_index = deque->files[--deque->tail];
+        }
+        pthread_mutex_unlock(&deque->mutex);
+    }
+    return file_index;
+}
+
+/* Parse [offset, end) of file into its output. Table already in fingerprint index is printed as known table only. Returns 0 or ERROR_* */
+static int32_t batch_parse_range(batch_type *batch, batch_file_type *file, input_file_type *input, uint64_t offset, uint64_t end){
+    fingerprint_entry_type known;
+    const uint8_t *data;
+    uint64_t hash;
+    uint32_t rows;
+    int result;
+
+    if(batch->fingerprints && !input->stream && (end > offset) && (end <= input->file_size)){
+        if((input_map_range(input, offset, end) != 0) || ((data = input_get_range(input, offset, (size_t)(end - offset))) == NULL)){
+            return ERROR_READ_FILE_ERROR;
+        }
+        hash = fingerprint_rows(data, (end - offset), &rows);
+        if(rows){
+            result = fingerprint_index_add(batch->fingerprints, hash, rows, file->path, offset, batch->options->fingerprint_label, &known);
+            if(result < 0){
+                return ERROR_FINGERPRINT_MALLOC_FAILED;
+            }
+            if(result){
+                render_parse_header(&file->output, batch->options, offset, end);
+                render_known_table(&file->output, &known);
+                return 0;
+            }
+        }
+    }
+    return parse_table(&file->output, batch->options, batch->soc, input, offset, end);
+}
+
+/* Parse one file into its output. Returns 0 or ERROR_* */
+static int32_t batch_parse_file(batch_type *batch, batch_file_type *file, uint32_t worker_index){
+    input_file_type input;
+    scan_candidate_list_type candidates;
+    int32_t result = 0;
+
+    (void)worker_index;                     //No per worker state
+    if(input_open(&input, file->path) != 0){
+        return ERROR_OPEN_FILE;
+    }
+    if(!batch->scan){
+        result = batch_parse_range(batch, file, &input, batch->bytes_offset, (batch->bytes_offset + batch->bytes_count));
+        input_close(&input);
+        return result;
+    }
+
+    /* Scan whole image and parse every candidate */
+    if(input.stream){
+        input_close(&input);
+        return ERROR_STREAM_INPUT_NOT_SUPPORTED;
+    }
+    if(!input.file_size){
+        input_close(&input);
+        return 0;
+    }
+    result = search_input(&input, scan_image, scan_candidate_compare, &candidates);
+    if(result != 0){
+        input_close(&input);
+        return result;
+    }
+    for(size_t i = 0; (i < candidates.count) && !result; i++){
+        render_scan_candidate(&file->output, &candidates.candidates[i]);
+        result = batch_parse_range(batch, file, &input, candidates.candidates[i].offset, (candidates.candidates[i].offset + candidates.candidates[i].length));
+    }
+    free(candidates.candidates);
+    input_close(&input);
+    return result;
+}
+
+static void *batch_worker(void *arg){
+    batch_worker_type *worker = arg;
+    batch_type *batch = worker->batch;
+    batch_file_type *file;
+    int64_t file_index;
+    char *output_path;
+    const char *file_name;
+    int fd;
+
+    while((file_index = batch_next_file(batch, worker->worker_index)) >= 0){
+        file = &batch->files[file_index];
+        if(batch->options->output_directory){
+            /* Own output file */
+            file_name = strrchr(file->path, '/') ? (strrchr(file->path, '/') + 1) : file->path;
+            output_path = malloc(strlen(batch->options->output_directory) + strlen(file_name) + 6);
+            if(output_path == NULL){
+                file->result = ERROR_BATCH_MALLOC_FAILED;
+            }
+            else{
+                sprintf(output_path, "%s/%s.txt", batch->options->output_directory, file_name);
+                fd = open(output_path, (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+                free(output_path);
+                if(fd < 0){
+                    file->result = ERROR_OPEN_OUTPUT_FILE;
+                }
+                else if(output_open(&file->output, fd, batch->options->color_enabled) != 0){
+                    close(fd);
+                    file->result = ERROR_OUTPUT_MALLOC_FAILED;
+                }
+                else{
+                    file->result = batch->process_file(batch, file, worker->worker_index);
+                    output_close(&file->output);
+                    close(fd);
+                }
+            }
+        }
+        else{
+            /* Collected in memory for in order writing */
+            if(output_open(&file->output, OUTPUT_FD_MEMORY, batch->options->color_enabled) != 0){
+                file->result = ERROR_OUTPUT_MALLOC_FAILED;
+            }
+            else{
+                file->result = batch->process_file(batch, file, worker->worker_index);
+                if(file->output.error){
+                    file->result = ERROR_OUTPUT_MALLOC_FAILED;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&batch->done_mutex);
+        file->done = 1;
+        pthread_cond_broadcast(&batch->done_cond);
+        pthread_mutex_unlock(&batch->done_mutex);
+    }
+    return NULL;
+}
+
+
+static int batch_add_path(batch_file_type **files, uint32_t *files_count, uint32_t *files_size, const char *path, size_t path_length){
+    batch_file_type *temp_ptr;
+    if(*files_count == *files_size){
+        *files_size = *files_size ? (*files_size * 2) : 64;
+        temp_ptr = realloc(*files, (sizeof(batch_file_type) * *files_size));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        *files = temp_ptr;
+    }
+    memset(&(*files)[*files_count], 0, sizeof(batch_file_type));
+    (*files)[*files_count].path = strndup(path, path_length);
+    if((*files)[*files_count].path == NULL){
+        return -1;
+    }
+    (*files_count)++;
+    return 0;
+}
+
+static int batch_path_compare(const void *a, const void *b){
+    return strcmp(((const batch_file_type*)a)->path, ((const batch_file_type*)b)->path);
+}
+
+/* Collect files of a directory or a list file. Returns 0 or ERROR_* */
+int batch_collect_files(const char *input_list, batch_file_type **files, uint32_t *files_count){
+    uint32_t files_size = 0;
+    struct stat file_stat;
+    DIR *dir;
+    struct dirent *entry;
+    char *path;
+    FILE *fptr;
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t line_length;
+
+    *files = NULL;
+    *files_count = 0;
+    if(stat(input_list, &file_stat) != 0){
+        return ERROR_OPEN_FILE;
+    }
+
+    if(S_ISDIR(file_stat.st_mode)){
+        dir = opendir(input_list);
+        if(dir == NULL){
+            return ERROR_OPEN_FILE;
+        }
+        while((entry = readdir(dir)) != NULL){
+            path = malloc(strlen(input_list) + strlen(entry->d_name) + 2);
+            if(path == NULL){
+                closedir(dir);
+                return ERROR_BATCH_MALLOC_FAILED;
+            }
+            sprintf(path, "%s/%s", input_list, entry->d_name);
+            if((stat(path, &file_stat) == 0) && S_ISREG(file_stat.st_mode)){
+                if(batch_add_path(files, files_count, &files_size, path, strlen(path)) != 0){
+                    free(path);
+                    closedir(dir);
+                    return ERROR_BATCH_MALLOC_FAILED;
+                }
+            }
+            free(path);
+        }
+        closedir(dir);
+        qsort(*files, *files_count, sizeof(batch_file_type), batch_path_compare);     //readdir() order is arbitrary
+        return 0;
+    }
+
+    fptr = fopen(input_list, "r");
+    if(fptr == NULL){
+        return ERROR_OPEN_FILE;
+    }
+    while((line_length = getline(&line, &line_size, fptr)) >= 0){
+        while((line_length > 0) && ((line[line_length-1] == '\n') || (line[line_length-1] == '\r'))){
+            line_length--;
+        }
+        if(line_length == 0){
+            continue;
+        }
+        if(batch_add_path(files, files_count, &files_size, line, line_length) != 0){
+            free(line);
+            fclose(fptr);
+            return ERROR_BATCH_MALLOC_FAILED;
+        }
+    }
+    free(line);
+    fclose(fptr);
+    return 0;
+}
+
+
+/* Workers for files_count files */
+uint32_t batch_workers_count(const parse_options_type *options, uint32_t files_count){
+    uint32_t workers_count = options->jobs ? options->jobs : (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    if(workers_count > BATCH_MAX_JOBS){
+        workers_count = BATCH_MAX_JOBS;
+    }
+    if(workers_count > files_count){
+        workers_count = files_count;
+    }
+    if(workers_count == 0){
+        workers_count = 1;
+    }
+    return workers_count;
+}
+
+/* Run batch->process_file for every file on workers_count threads. Outputs(or per file output files) and errors are written in input order. Returns 0 or last ERROR_* */
+int32_t run_batch(batch_type *batch, uint32_t workers_count){
+    batch_worker_type *workers = NULL;
+    output_buffer_type output;
+    int32_t result = 0;
+    uint32_t started_count;
+    uint32_t i;
+
+    /* Workers and their deques */
+    batch->deques_count = workers_count;
+    batch->deques = calloc(workers_count, sizeof(batch_deque_type));
+    workers = calloc(workers_count, sizeof(batch_worker_type));
+    if((batch->deques == NULL) || (workers == NULL)){
+        result = ERROR_BATCH_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto run_batch_free;
+    }
+    for(i = 0; i < workers_count; i++){
+        pthread_mutex_init(&batch->deques[i].mutex, NULL);
+        batch->deques[i].files = malloc(sizeof(uint32_t) * ((batch->files_count / workers_count) + 1));
+        if(batch->deques[i].files == NULL){
+            result = ERROR_BATCH_MALLOC_FAILED;
+            print_error_stderr(result);
+            goto run_batch_free_deques;
+        }
+    }
+    for(i = 0; i < batch->files_count; i++){
+        batch->deques[i % workers_count].files[batch->deques[i % workers_count].tail++] = i;
+    }
+    pthread_mutex_init(&batch->done_mutex, NULL);
+    pthread_cond_init(&batch->done_cond, NULL);
+
+    started_count = 0;
+    for(i = 0; i < workers_count; i++){
+        workers[i].batch = batch;
+        workers[i].worker_index = i;
+        workers[i].started = (pthread_create(&workers[i].thread, NULL, batch_worker, &workers[i]) == 0);
+        started_count += workers[i].started;
+    }
+    if(!started_count){
+        batch_worker(&workers[0]);          //No threads. Steals every deque on calling thread
+    }
+
+    /* Write outputs and errors in input order as files complete */
+    if(output_open(&output, STDOUT_FILENO, batch->options->color_enabled) != 0){
+        output.buffer = NULL;               //Workers are running. Errors are still reported
+    }
+    for(i = 0; i < batch->files_count; i++){
+        pthread_mutex_lock(&batch->done_mutex);
+        while(!batch->files[i].done){
+            pthread_cond_wait(&batch->done_cond, &batch->done_mutex);
+        }
+        pthread_mutex_unlock(&batch->done_mutex);
+        
+        if(!batch->options->output_directory){
+            if(output.buffer){
+                output_str(&output, "==> ");
+                output_str(&output, batch->files[i].path);
+                output_str(&output, " <==\n");
+                output_data(&output, batch->files[i].output.buffer, batch->files[i].output.length);
+                output_flush(&output);      //Keep stdout and stderr in order
+            }
+            free(batch->files[i].output.buffer);
+            batch->files[i].output.buffer = NULL;
+        }
+        if(batch->files[i].result != 0){
+            fprintf(stderr, "%s: ", batch->files[i].path);
+            print_error_stderr(batch->files[i].result);
+            result = batch->files[i].result;
+        }
+    }
+    if(output.buffer){
+        output_close(&output);
+    }
+
+    for(i = 0; i < workers_count; i++){
+        if(workers[i].started){
+            pthread_join(workers[i].thread, NULL);
+        }
+    }
+    pthread_cond_destroy(&batch->done_cond);
+    pthread_mutex_destroy(&batch->done_mutex);
+
+run_batch_free_deques:
+    for(i = 0; i < workers_count; i++){
+        free(batch->deques[i].files);
+        pthread_mutex_destroy(&batch->deques[i].mutex);
+    }
+run_batch_free:
+    free(batch->deques);
+    free(workers);
+    return result;
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - "-batch"
+ argv[2]    - input directory or list file
+ argv[3]    - bytes offset or "scan"
+ argv[4]    - bytes count(omitted with "scan")
+ argv[4/5]  - soc type
+ argv[>=5]  - optional parameters(argv[>=6] if csv file is passed as parameter)
+ */
+
+int batch_main(int argc, char **argv){
+    batch_type batch;
+    parse_options_type options = default_parse_options;
+    soc_map_type soc;
+    fingerprint_index_type fingerprints;
+    int32_t soc_type_index;
+    int argi;
+    int32_t result;
+    int32_t itemp;
+    uint32_t i;
+
+    memset(&batch, 0, sizeof(batch));
+    if(argc < 5){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+    
+    /* Range or scan - argv[3](-argv[4]) */
+    if(strcmp(argv[3], "scan") == 0){
+        batch.scan = 1;
+        argi = 4;
+    }
+    else{
+        result = parse_range_parameters(argv[3], argv[4], &batch.bytes_offset, &batch.bytes_count);
+        if(result != 0){
+            return result;
+        }
+        argi = 5;
+    }
+    if(argi >= argc){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+
+    /* SoC type */
+    soc_type_index = find_soc_type(argv[argi]);
+    if(soc_type_index < 0){
+        print_error_stderr(ERROR_UNKNOWN_SOC_TYPE);
+        return ERROR_UNKNOWN_SOC_TYPE;
+    }
+    argi++;
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        if(argi >= argc){
+            print_error_stderr(ERROR_PARAMETER_COUNT);
+            return ERROR_PARAMETER_COUNT;
+        }
+        argi++;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+    if(options.output_format != OUTPUT_FORMAT_TEXT){
+        print_error_stderr(ERROR_OUTPUT_FORMAT_NOT_SUPPORTED);      //File headers and scan candidates are text
+        return ERROR_OUTPUT_FORMAT_NOT_SUPPORTED;
+    }
+    
+    result = batch_collect_files(argv[2], &batch.files, &batch.files_count);
+    if(result != 0){
+        print_error_stderr(result);
+        return result;
+    }
+    
+    result = load_soc(&soc, soc_type_index, ((soc_type_index == SOC_TYPE_INDEX_CSV) ? argv[argi-1] : NULL), &options);
+    if(result != 0){
+        goto batch_main_exit;
+    }
+
+    if(options.fingerprint_index_filename){
+        result = load_fingerprint_index(&fingerprints, options.fingerprint_index_filename);
+        if(result != 0){
+            print_error_stderr(result);
+            free_soc(&soc);
+            goto batch_main_exit;
+        }
+        batch.fingerprints = &fingerprints;
+    }
+
+    batch.options = &options;
+    batch.soc = &soc;
+    batch.process_file = batch_parse_file;
+    result = run_batch(&batch, batch_workers_count(&options, batch.files_count));
+    free_soc(&soc);
+
+    /* New tables for later runs */
+    if(batch.fingerprints){
+        if(fingerprint_index_added(&fingerprints)){
+            itemp = save_fingerprint_index(&fingerprints);
+            if(itemp != 0){
+                print_error_stderr(itemp);
+                result = itemp;
+            }
+        }
+        free_fingerprint_index(&fingerprints);
+    }
+
+batch_main_exit:
+    for(i = 0; i < batch.files_count; i++){
+        free(batch.files[i].path);
+    }
+    free(batch.files);
+    return result;
+}
+
+
+/* PARALLEL PARSE */
+
+/*
+ * Large range of one input is decoded and rendered on worker threads, writer(calling thread) emits chunks in range order.
+ * - Range is split into chunks of PARSE_PARALLEL_CHUNK_SIZE bytes. Workers take the next chunk, decode and render it into
+ *   memory output of its slot. Chunk c always uses slot c % slots_count.
+ * - Chunk is taken only when its slot has been written, so at most slots_count chunks are in flight(back-pressure)
+ *   and memory use doesn't depend on range size.
+ * - Rows are rendered independently, so output is byte identical to parse_table(). -stopatnull stops the writer after
+ *   the chunk holding the terminating null entry. Chunks rendered after it are dropped.
+ * - Every worker reads input through its own mapping window of the shared file descriptor.
+ */
+
+#define PARSE_PARALLEL_CHUNK_SIZE (256*1024)    //Multiple of DATA_ROW_SIZE
+#define PARSE_PARALLEL_MIN_CHUNKS 4             //Smaller ranges are parsed by parse_table()
+#define PARSE_PARALLEL_SLOTS_PER_WORKER 2
+
+#define PARSE_SLOT_FREE 0
+#define PARSE_SLOT_BUSY 1
+#define PARSE_SLOT_DONE 2
+
+typedef struct{
+    output_buffer_type output;              //Rendered rows of chunk. Memory output, reused
+    uint32_t state;                         //PARSE_SLOT_*
+    uint32_t stop;                          //Rendering stopped at terminating null entry
+    int32_t result;
+} parse_slot_type;
+
+typedef struct{
+    const parse_options_type *options;
+    const soc_map_type *soc;
+    const input_file_type *input;
+    uint64_t offset;
+    uint64_t end;
+    uint64_t chunks_count;
+    uint64_t next_chunk;                    //Next chunk to take
+    uint64_t written_chunks;                //Chunks emitted by writer
+    uint32_t abort;                         //Writer has stopped. Workers take no more chunks
+    parse_slot_type *slots;
+    uint32_t slots_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t slot_free_cond;
+    pthread_cond_t slot_done_cond;
+} parse_pipeline_type;
+
+
+static void *parse_pipeline_worker(void *arg){
+    parse_pipeline_type *pipeline = arg;
+    parse_slot_type *slot;
+    input_file_type input;
+    register_table_type table;
+    uint32_t register_index_cache = 0;
+    const uint8_t *data;
+    uint64_t chunk;
+    uint64_t offset;
+    size_t length;
+    int32_t setup_result = 0;
+    int32_t result;
+
+    input_share(&input, pipeline->input);
+    if(input_map_range(&input, pipeline->offset, pipeline->end) != 0){
+        setup_result = ERROR_READ_FILE_ERROR;
+    }
+    if(alloc_register_table(&table, (PARSE_PARALLEL_CHUNK_SIZE / DATA_ROW_SIZE)) != 0){
+        setup_result = ERROR_OUTPUT_MALLOC_FAILED;
+    }
+
+    for(;;){
+        pthread_mutex_lock(&pipeline->mutex);
+        while(!pipeline->abort && (pipeline->next_chunk < pipeline->chunks_count) &&
+              (pipeline->next_chunk >= (pipeline->written_chunks + pipeline->slots_count))){
+            pthread_cond_wait(&pipeline->slot_free_cond, &pipeline->mutex);
+        }
+        if(pipeline->abort || (pipeline->next_chunk >= pipeline->chunks_count)){
+            pthread_mutex_unlock(&pipeline->mutex);
+            break;
+        }
+        chunk = pipeline->next_chunk++;
+        slot = &pipeline->slots[chunk % pipeline->slots_count];
+        slot->state = PARSE_SLOT_BUSY;
+        pthread_mutex_unlock(&pipeline->mutex);
+
+        /* Decode and render chunk into its slot */
+        result = setup_result;
+        slot->output.length = 0;
+        slot->stop = 0;
+        if(!result){
+            offset = pipeline->offset + (chunk * PARSE_PARALLEL_CHUNK_SIZE);
+            length = ((pipeline->end - offset) < PARSE_PARALLEL_CHUNK_SIZE) ? (pipeline->end - offset) : PARSE_PARALLEL_CHUNK_SIZE;
+            data = input_get_range(&input, offset, length);
+            if(data == NULL){
+                result = ERROR_READ_FILE_ERROR;
+            }
+            else if(decode_register_table(&table, data, length) != 0){
+                result = ERROR_OUTPUT_MALLOC_FAILED;
+            }
+            else{
+                slot->stop = parse_render_rows(&slot->output, pipeline->options, pipeline->soc, &table, offset, &register_index_cache);
+                if(slot->output.error){
+                    result = ERROR_OUTPUT_MALLOC_FAILED;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&pipeline->mutex);
+        slot->result = result;
+        slot->state = PARSE_SLOT_DONE;
+        pthread_cond_broadcast(&pipeline->slot_done_cond);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+
+    free_register_table(&table);
+    input_close(&input);
+    return NULL;
+}
+
+/* Workers for parallel parse of [offset, end). 1 if the range should be parsed by parse_table()(also range exceeding file, see -stopatnull) */
+uint32_t parse_parallel_workers_count(const parse_options_type *options, const input_file_type *input, uint64_t offset, uint64_t end){
+    uint64_t chunks_count = ((end - offset) + (PARSE_PARALLEL_CHUNK_SIZE - 1)) / PARSE_PARALLEL_CHUNK_SIZE;
+    if(input->stream || (end <= offset) || (input->file_size < end) || (chunks_count < PARSE_PARALLEL_MIN_CHUNKS)){
+        return 1;
+    }
+    return batch_workers_count(options, (uint32_t)((chunks_count < BATCH_MAX_JOBS) ? chunks_count : BATCH_MAX_JOBS));
+}
+
+/* parse_table() on workers_count threads. Same output. Returns 0 or ERROR_* (not printed) */
+int parse_table_parallel(output_buffer_type *output, const parse_options_type *options, const soc_map_type *soc, input_file_type *input, uint64_t offset, uint64_t end, uint32_t workers_count){
+    parse_pipeline_type pipeline;
+    pthread_t *threads;
+    parse_slot_type *slot;
+    int32_t result = 0;
+    uint32_t started_count;
+    uint32_t i;
+
+    if(input->file_size<end){
+        return ERROR_RANGE_EXCEEDS_FILE;
+    }
+
+    memset(&pipeline, 0, sizeof(parse_pipeline_type));
+    pipeline.options = options;
+    pipeline.soc = soc;
+    pipeline.input = input;
+    pipeline.offset = offset;
+    pipeline.end = end;
+    pipeline.chunks_count = ((end - offset) + (PARSE_PARALLEL_CHUNK_SIZE - 1)) / PARSE_PARALLEL_CHUNK_SIZE;
+    pipeline.slots_count = workers_count * PARSE_PARALLEL_SLOTS_PER_WORKER;
+    pipeline.slots = calloc(pipeline.slots_count, sizeof(parse_slot_type));
+    threads = calloc(workers_count, sizeof(pthread_t));
+    if((pipeline.slots == NULL) || (threads == NULL)){
+        free(pipeline.slots);
+        free(threads);
+        return ERROR_OUTPUT_MALLOC_FAILED;
+    }
+    for(i = 0; i < pipeline.slots_count; i++){
+        if(output_open(&pipeline.slots[i].output, OUTPUT_FD_MEMORY, options->color_enabled) != 0){
+            result = ERROR_OUTPUT_MALLOC_FAILED;
+            goto parse_table_parallel_free;
+        }
+    }
+    pthread_mutex_init(&pipeline.mutex, NULL);
+    pthread_cond_init(&pipeline.slot_free_cond, NULL);
+    pthread_cond_init(&pipeline.slot_done_cond, NULL);
+
+    started_count = 0;
+    for(i = 0; i < workers_count; i++){
+        if(pthread_create(&threads[started_count], NULL, parse_pipeline_worker, &pipeline) == 0){
+            started_count++;
+        }
+    }
+    if(!started_count){
+        /* No threads. Range is parsed on calling thread */
+        pthread_cond_destroy(&pipeline.slot_done_cond);
+        pthread_cond_destroy(&pipeline.slot_free_cond);
+        pthread_mutex_destroy(&pipeline.mutex);
+        result = parse_table(output, options, soc, input, offset, end);
+        goto parse_table_parallel_free;
+    }
+    render_parse_header(output, options, offset, end);
+
+    /* Writer. Chunks in range order */
+    for(uint64_t chunk = 0; chunk < pipeline.chunks_count; chunk++){
+        slot = &pipeline.slots[chunk % pipeline.slots_count];
+        pthread_mutex_lock(&pipeline.mutex);
+        while(slot->state != PARSE_SLOT_DONE){
+            pthread_cond_wait(&pipeline.slot_done_cond, &pipeline.mutex);
+        }
+        pthread_mutex_unlock(&pipeline.mutex);
+
+        result = slot->result;
+        if(!result){
+            output_data(output, slot->output.buffer, slot->output.length);
+        }
+
+        pthread_mutex_lock(&pipeline.mutex);
+        slot->state = PARSE_SLOT_FREE;
+        pipeline.written_chunks++;
+        if(result || slot->stop || output->error){
+            pipeline.abort = 1;
+        }
+        pthread_cond_broadcast(&pipeline.slot_free_cond);
+        pthread_mutex_unlock(&pipeline.mutex);
+        if(pipeline.abort){
+            break;
+        }
+    }
+
+    for(i = 0; i < started_count; i++){
+        pthread_join(threads[i], NULL);
+    }
+    pthread_cond_destroy(&pipeline.slot_done_cond);
+    pthread_cond_destroy(&pipeline.slot_free_cond);
+    pthread_mutex_destroy(&pipeline.mutex);
+
+parse_table_parallel_free:
+    for(i = 0; i < pipeline.slots_count; i++){
+        free(pipeline.slots[i].output.buffer);
+    }
+    free(pipeline.slots);
+    free(threads);
+    return result;
+}
+
+
+/* TABLE SPECS */
+
+/* Table given as File(whole file is the table) or File:BytesOffset:BytesCount. Used by modes that take many tables */
+typedef struct{
+    char *path;
+    uint32_t whole_file;
+    uint64_t bytes_offset;
+    uint64_t bytes_count;
+} table_spec_type;
+
+/* Parse File or File:BytesOffset:BytesCount. Returns 0 or ERROR_* (printed to stderr) */
+int parse_table_spec(char *spec_str, table_spec_type *spec){
+    char *count_str = strrchr(spec_str, ':');
+    char *offset_str = NULL;
+    int result;
+
+    memset(spec, 0, sizeof(table_spec_type));
+    spec->path = spec_str;
+    spec->whole_file = 1;
+    if(count_str && (count_str != spec_str)){
+        *count_str = '\0';
+        offset_str = strrchr(spec_str, ':');
+        *count_str = ':';
+    }
+    if((offset_str == NULL) || (offset_str == spec_str) || (offset_str[1] < '0') || (offset_str[1] > '9')){
+        return 0;                           //No range. ':' is part of file name
+    }
+
+    *offset_str = '\0';
+    *count_str = '\0';
+    result = parse_range_parameters((offset_str + 1), (count_str + 1), &spec->bytes_offset, &spec->bytes_count);
+    if(result != 0){
+        return result;
+    }
+    spec->whole_file = 0;
+    return 0;
+}
+
+/* Table given before optional parameters. Stdin("-" or "-:Offset:Count") is a table, it's rejected when read */
+static inline int is_table_spec_parameter(const char *parameter_str){
+    return ((parameter_str[0] != '-') || (parameter_str[1] == '\0') || (parameter_str[1] == ':'));
+}
+
+/* Decode table of spec into table(reused). Returns 0 or ERROR_* (not printed) */
+int load_table_spec(register_table_type *table, const table_spec_type *spec){
+    input_file_type input;
+    const uint8_t *data;
+    uint64_t offset = spec->bytes_offset;
+    uint64_t end = spec->bytes_offset + spec->bytes_count;
+    int result = 0;
+
+    table->count = 0;
+    result = input_open_file(&input, spec->path);
+    if(result != 0){
+        return result;
+    }
+    if(spec->whole_file){
+        offset = 0;
+        end = input.file_size - (input.file_size % DATA_ROW_SIZE);
+    }
+    if(input.file_size < end){
+        result = ERROR_RANGE_EXCEEDS_FILE;
+    }
+    else if(end > offset){
+        if((input_map_range(&input, offset, end) != 0) || ((data = input_get_range(&input, offset, (size_t)(end - offset))) == NULL)){
+            result = ERROR_READ_FILE_ERROR;
+        }
+        else if(decode_register_table(table, data, (size_t)(end - offset)) != 0){
+            result = ERROR_TABLE_MALLOC_FAILED;
+        }
+    }
+    input_close(&input);
+    return result;
+}
+
+/* Returns index of first SoC type parameter at or after argv[first] or -1. Table parameters precede SoC type */
+int find_soc_type_parameter(int argc, char **argv, int first){
+    for(int argi = first; argi < argc; argi++){
+        if(find_soc_type(argv[argi]) >= 0){
+            return argi;
+        }
+    }
+    return -1;
+}
+
+
+/* TABLE DIFF */
+
+/*
+ * -diff aligns rows of a reference table and one or more candidate tables by (address, operation) sequence with Myers' O(ND) difference algorithm.
+ * - Linear space variant: middle snake bisection after trimming common prefix and suffix. Similar tables(board revisions) cost close to O(N).
+ * - Aligned rows with different value, delay or attribute are reported as changed with the differing fields.
+ * - Reference table is decoded and keyed once. Tables, keys and work buffers are reused between candidates.
+ * Table is File(whole file is the table) or File:BytesOffset:BytesCount
+ */
+
+#define DIFF_OPERATION_MASK (ROW_FLAG_WRITE | ROW_FLAG_WRITE_INVALID | ROW_FLAG_READ | ROW_FLAG_READ_INVALID | ROW_FLAG_DELAY_ONLY | ROW_FLAG_TERMINATE | ROW_FLAG_NONE)
+
+#define DIFF_EQUAL 0
+#define DIFF_REMOVED 1
+#define DIFF_INSERTED 2
+
+typedef struct{
+    register_table_type table;
+    uint64_t *keys;                         //(address<<32) | operation
+    size_t keys_size;
+} diff_table_type;
+
+typedef struct{
+    uint32_t type;
+    uint32_t a_row;
+    uint32_t b_row;
+} diff_edit_type;
+
+typedef struct{
+    const uint64_t *a;
+    const uint64_t *b;
+    int32_t *v1;                            //Forward furthest reaching x per diagonal
+    int32_t *v2;                            //Reverse
+    size_t v_size;
+    diff_edit_type *edits;
+    size_t edits_count;
+    size_t edits_size;
+} diff_type;
+
+/* Attribute fields compared for changed rows */
+typedef struct{
+    const char *field_str;
+    uint32_t shift;
+    uint32_t mask;
+} diff_attr_field_type;
+
+const diff_attr_field_type diff_attr_field_list[] = {
+    {"WRITE FLAG", 0, 0x7},
+    {"WRITE COUNT", 3, 0x1f},
+    {"BITS 8-10", 8, 0x7},
+    {"WRITE START", 11, 0x1f},
+    {"READ FLAG", 16, 0x7},
+    {"READ COUNT", 19, 0x1f},
+    {"BITS 24-26", 24, 0x7},
+    {"READ START", 27, 0x1f}
+};
+
+
+/* Decode table of spec and key its rows. Returns 0 or ERROR_* (not printed) */
+int load_diff_table(diff_table_type *diff_table, const table_spec_type *spec){
+    uint64_t *temp_ptr;
+    int result;
+
+    result = load_table_spec(&diff_table->table, spec);
+    if(result != 0){
+        return result;
+    }
+    if(diff_table->table.count > diff_table->keys_size){
+        temp_ptr = realloc(diff_table->keys, (sizeof(uint64_t) * diff_table->table.count));
+        if(temp_ptr == NULL){
+            return ERROR_DIFF_MALLOC_FAILED;
+        }
+        diff_table->keys = temp_ptr;
+        diff_table->keys_size = diff_table->table.count;
+    }
+    for(size_t i = 0; i < diff_table->table.count; i++){
+        diff_table->keys[i] = (((uint64_t)diff_table->table.addr[i])<<32) | (diff_table->table.flags[i] & DIFF_OPERATION_MASK);
+    }
+    return 0;
+}
+
+
+static inline void diff_add_edit(diff_type *diff, uint32_t type, int32_t a_row, int32_t b_row){
+    diff->edits[diff->edits_count].type = type;
+    diff->edits[diff->edits_count].a_row = a_row;
+    diff->edits[diff->edits_count].b_row = b_row;
+    diff->edits_count++;
+}
+
+static void diff_compare(diff_type *diff, int32_t a_low, int32_t a_high, int32_t b_low, int32_t b_high);
+
+/* Find middle snake of a[a_low, a_high) and b[b_low, b_high) and split the problem there. Both ranges are non-empty */
+static void diff_bisect(diff_type *diff, int32_t a_low, int32_t a_high, int32_t b_low, int32_t b_high){
+    const uint64_t *a = &diff->a[a_low];
+    const uint64_t *b = &diff->b[b_low];
+    int32_t n = a_high - a_low;
+    int32_t m = b_high - b_low;
+    int32_t max_d = (n + m + 1) / 2;
+    int32_t v_offset = max_d;
+    int32_t v_length = 2 * max_d;
+    int32_t delta = n - m;
+    int32_t front = (delta & 1);            //Odd delta: forward path collides with reverse path
+    int32_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+    int32_t k1_offset, k2_offset;
+    int32_t x1, y1, x2, y2;
+
+    for(int32_t i = 0; i < (v_length + 2); i++){
+        diff->v1[i] = -1;
+        diff->v2[i] = -1;
+    }
+    diff->v1[v_offset + 1] = 0;
+    diff->v2[v_offset + 1] = 0;
+
+    for(int32_t d = 0; d < max_d; d++){
+        /* Forward path */
+        for(int32_t k1 = (-d + k1_start); k1 <= (d - k1_end); k1 += 2){
+            k1_offset = v_offset + k1;
+            if((k1 == -d) || ((k1 != d) && (diff->v1[k1_offset - 1] < diff->v1[k1_offset + 1]))){
+                x1 = diff->v1[k1_offset + 1];
+            }
+            else{
+                x1 = diff->v1[k1_offset - 1] + 1;
+            }
+            y1 = x1 - k1;
+            while((x1 < n) && (y1 < m) && (a[x1] == b[y1])){
+                x1++;
+                y1++;
+            }
+            diff->v1[k1_offset] = x1;
+            if(x1 > n){
+                k1_end += 2;                //Ran off the right of the graph
+            }
+            else if(y1 > m){
+                k1_start += 2;              //Ran off the bottom of the graph
+            }
+            else if(front){
+                k2_offset = v_offset + delta - k1;
+                if((k2_offset >= 0) && (k2_offset < v_length) && (diff->v2[k2_offset] != -1)){
+                    if(x1 >= (n - diff->v2[k2_offset])){
+                        diff_compare(diff, a_low, (a_low + x1), b_low, (b_low + y1));
+                        diff_compare(diff, (a_low + x1), a_high, (b_low + y1), b_high);
+                        return;
+                    }
+                }
+            }
+        }
+
+        /* Reverse path */
+        for(int32_t k2 = (-d + k2_start); k2 <= (d - k2_end); k2 += 2){
+            k2_offset = v_offset + k2;
+            if((k2 == -d) || ((k2 != d) && (diff->v2[k2_offset - 1] < diff->v2[k2_offset + 1]))){
+                x2 = diff->v2[k2_offset + 1];
+            }
+            else{
+                x2 = diff->v2[k2_offset - 1] + 1;
+            }
+            y2 = x2 - k2;
+            while((x2 < n) && (y2 < m) && (a[n - x2 - 1] == b[m - y2 - 1])){
+                x2++;
+                y2++;
+            }
+            diff->v2[k2_offset] = x2;
+            if(x2 > n){
+                k2_end += 2;
+            }
+            else if(y2 > m){
+                k2_start += 2;
+            }
+            else if(!front){
+                k1_offset = v_offset + delta - k2;
+                if((k1_offset >= 0) && (k1_offset < v_length) && (diff->v1[k1_offset] != -1)){
+                    x1 = diff->v1[k1_offset];
+                    y1 = v_offset + x1 - k1_offset;
+                    if(x1 >= (n - x2)){
+                        diff_compare(diff, a_low, (a_low + x1), b_low, (b_low + y1));
+                        diff_compare(diff, (a_low + x1), a_high, (b_low + y1), b_high);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    /* No common rows */
+    for(int32_t i = a_low; i < a_high; i++){
+        diff_add_edit(diff, DIFF_REMOVED, i, -1);
+    }
+    for(int32_t i = b_low; i < b_high; i++){
+        diff_add_edit(diff, DIFF_INSERTED, -1, i);
+    }
+}
+
+static void diff_compare(diff_type *diff, int32_t a_low, int32_t a_high, int32_t b_low, int32_t b_high){
+    int32_t suffix = 0;
+
+    /* Common prefix */
+    while((a_low < a_high) && (b_low < b_high) && (diff->a[a_low] == diff->b[b_low])){
+        diff_add_edit(diff, DIFF_EQUAL, a_low++, b_low++);
+    }
+    /* Common suffix. Added after the middle part */
+    while((a_low < a_high) && (b_low < b_high) && (diff->a[a_high - 1] == diff->b[b_high - 1])){
+        a_high--;
+        b_high--;
+        suffix++;
+    }
+
+    if(a_low == a_high){
+        for(int32_t i = b_low; i < b_high; i++){
+            diff_add_edit(diff, DIFF_INSERTED, -1, i);
+        }
+    }
+    else if(b_low == b_high){
+        for(int32_t i = a_low; i < a_high; i++){
+            diff_add_edit(diff, DIFF_REMOVED, i, -1);
+        }
+    }
+    else{
+        diff_bisect(diff, a_low, a_high, b_low, b_high);
+    }
+
+    for(int32_t i = 0; i < suffix; i++){
+        diff_add_edit(diff, DIFF_EQUAL, (a_high + i), (b_high + i));
+    }
+}
+
+/* Align keys a[0, n) and b[0, m) into diff->edits. Returns 0 on success, -1 if malloc() fails */
+int diff_tables(diff_type *diff, const uint64_t *a, size_t n, const uint64_t *b, size_t m){
+    void *temp_ptr;
+
+    if((n + m + 3) > diff->v_size){
+        diff->v_size = n + m + 3;
+        free(diff->v1);
+        free(diff->v2);
+        diff->v1 = malloc(sizeof(int32_t) * diff->v_size);
+        diff->v2 = malloc(sizeof(int32_t) * diff->v_size);
+        if((diff->v1 == NULL) || (diff->v2 == NULL)){
+            diff->v_size = 0;
+            return -1;
+        }
+    }
+    if((n + m) > diff->edits_size){
+        temp_ptr = realloc(diff->edits, (sizeof(diff_edit_type) * (n + m)));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        diff->edits = temp_ptr;
+        diff->edits_size = n + m;
+    }
+    diff->a = a;
+    diff->b = b;
+    diff->edits_count = 0;
+    diff_compare(diff, 0, (int32_t)n, 0, (int32_t)m);
+    return 0;
+}
+
+
+static void render_diff_header(output_buffer_type *output, const char *marker_str, const table_spec_type *spec, size_t rows){
+    output_str(output, marker_str);
+    output_str(output, spec->path);
+    if(!spec->whole_file){
+        output_char(output, ':');
+        output_dec(output, spec->bytes_offset);
+        output_char(output, ':');
+        output_dec(output, spec->bytes_count);
+    }
+    output_str(output, " - Rows ");
+    output_dec(output, rows);
+    output_char(output, '\n');
+}
+
+static void render_diff_row_number(output_buffer_type *output, const char *marker_str, const char *color_str, uint32_t a_row, uint32_t b_row){
+    output_color(output, color_str);
+    output_str(output, marker_str);
+    output_color(output, color_default_str);
+    if(a_row != UINT32_MAX){
+        output_dec_padded(output, a_row, 6);
+    }
+    else{
+        output_str(output, "      ");
+    }
+    output_char(output, ' ');
+    if(b_row != UINT32_MAX){
+        output_dec_padded(output, b_row, 6);
+    }
+    else{
+        output_str(output, "      ");
+    }
+    output_char(output, ' ');
+}
+
+static void render_diff_changed_field(output_buffer_type *output, const char *field_str, uint32_t old_value, uint32_t new_value){
+    output_color(output, color_green_str);
+    output_str(output, field_str);
+    output_color(output, color_default_str);
+    output_hex32(output, old_value);
+    output_str(output, " -> ");
+    output_color(output, color_yellow_str);
+    output_hex32(output, new_value);
+    output_color(output, color_default_str);
+}
+
+/* Changed row: address, register base and differing fields only */
+void render_diff_changed_row(output_buffer_type *output, const register_table_type *a, uint32_t a_row, const register_table_type *b, uint32_t b_row, const soc_register_type *soc_register){
+    uint32_t old_field;
+    uint32_t new_field;
+
+    render_diff_row_number(output, "~ ", color_yellow_str, a_row, b_row);
+    output_color(output, color_green_str);
+    output_str(output, addr_str);
+    output_color(output, color_default_str);
+    output_hex32(output, a->addr[a_row]);
+    output_char(output, ' ');
+    output_str_padded(output, soc_register->register_name, 15);
+    if(a->value[a_row] != b->value[b_row]){
+        render_diff_changed_field(output, value_str, a->value[a_row], b->value[b_row]);
+        output_str(output, " (XOR ");
+        output_hex32(output, (a->value[a_row] ^ b->value[b_row]));
+        output_char(output, ')');
+    }
+    if(a->delay[a_row] != b->delay[b_row]){
+        render_diff_changed_field(output, delay_str, a->delay[a_row], b->delay[b_row]);
+    }
+    if(a->attr[a_row] != b->attr[b_row]){
+        render_diff_changed_field(output, attr_str, a->attr[a_row], b->attr[b_row]);
+        output_char(output, ' ');
+        for(uint32_t i = 0; i < (sizeof(diff_attr_field_list)/sizeof(diff_attr_field_type)); i++){
+            old_field = (a->attr[a_row] >> diff_attr_field_list[i].shift) & diff_attr_field_list[i].mask;
+            new_field = (b->attr[b_row] >> diff_attr_field_list[i].shift) & diff_attr_field_list[i].mask;
+            if(old_field != new_field){
+                output_char(output, '(');
+                output_str(output, diff_attr_field_list[i].field_str);
+                output_char(output, ' ');
+                output_dec(output, old_field);
+                output_str(output, "->");
+                output_dec(output, new_field);
+                output_char(output, ')');
+            }
+        }
+    }
+    output_char(output, '\n');
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - "-diff"
+ argv[2]    - reference table
+ argv[3..]  - candidate tables
+ argv[n]    - soc type
+ argv[>n]   - optional parameters(argv[>n+1] if csv file is passed as parameter)
+ */
+
+int diff_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    table_spec_type *specs;
+    diff_table_type reference;
+    diff_table_type candidate;
+    diff_type diff;
+    soc_map_type soc;
+    output_buffer_type output;
+    int32_t soc_type_index;
+    uint32_t register_index_cache = 0;
+    uint32_t changed, removed, inserted, equal;
+    const diff_edit_type *edit;
+    int argi;
+    int specs_count;
+    int32_t result = 0;
+    int32_t temp;
+
+    /* Tables until SoC type */
+    argi = find_soc_type_parameter(argc, argv, 4);
+    if(argi < 0){
+        print_error_stderr((argc < 5) ? ERROR_PARAMETER_COUNT : ERROR_UNKNOWN_SOC_TYPE);
+        return ((argc < 5) ? ERROR_PARAMETER_COUNT : ERROR_UNKNOWN_SOC_TYPE);
+    }
+    soc_type_index = find_soc_type(argv[argi]);
+    specs_count = argi - 2;
+    argi++;
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        if(argi >= argc){
+            print_error_stderr(ERROR_PARAMETER_COUNT);
+            return ERROR_PARAMETER_COUNT;
+        }
+        argi++;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+
+    specs = malloc(sizeof(table_spec_type) * specs_count);
+    if(specs == NULL){
+        print_error_stderr(ERROR_DIFF_MALLOC_FAILED);
+        return ERROR_DIFF_MALLOC_FAILED;
+    }
+    for(int i = 0; i < specs_count; i++){
+        result = parse_table_spec(argv[2 + i], &specs[i]);
+        if(result != 0){
+            free(specs);
+            return result;
+        }
+    }
+
+    result = load_soc(&soc, soc_type_index, ((soc_type_index == SOC_TYPE_INDEX_CSV) ? argv[argi-1] : NULL), &options);
+    if(result != 0){
+        free(specs);
+        return result;
+    }
+    memset(&reference, 0, sizeof(reference));
+    memset(&candidate, 0, sizeof(candidate));
+    memset(&diff, 0, sizeof(diff));
+    if(output_open(&output, STDOUT_FILENO, options.color_enabled) != 0){
+        result = ERROR_OUTPUT_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto diff_main_exit;
+    }
+
+    result = load_diff_table(&reference, &specs[0]);
+    if(result != 0){
+        fprintf(stderr, "%s: ", specs[0].path);
+        print_error_stderr(result);
+        goto diff_main_close;
+    }
+
+    for(int i = 1; i < specs_count; i++){
+        temp = load_diff_table(&candidate, &specs[i]);
+        if((temp == 0) && (diff_tables(&diff, reference.keys, reference.table.count, candidate.keys, candidate.table.count) != 0)){
+            temp = ERROR_DIFF_MALLOC_FAILED;
+        }
+        if(temp != 0){
+            output_flush(&output);          //Keep stdout and stderr in order
+            fprintf(stderr, "%s: ", specs[i].path);
+            print_error_stderr(temp);
+            result = temp;
+            continue;
+        }
+
+        render_diff_header(&output, "--- ", &specs[0], reference.table.count);
+        render_diff_header(&output, "+++ ", &specs[i], candidate.table.count);
+        changed = removed = inserted = equal = 0;
+        for(size_t j = 0; j < diff.edits_count; j++){
+            edit = &diff.edits[j];
+            if(edit->type == DIFF_REMOVED){
+                removed++;
+                if(!options.diff_summary_only){
+                    render_diff_row_number(&output, "- ", color_red_str, edit->a_row, UINT32_MAX);
+                    render_row(&output, &options, &reference.table, edit->a_row, soc_map_lookup(&soc, reference.table.addr[edit->a_row], &register_index_cache), &soc.fields);
+                }
+            }
+            else if(edit->type == DIFF_INSERTED){
+                inserted++;
+                if(!options.diff_summary_only){
+                    render_diff_row_number(&output, "+ ", color_green_str, UINT32_MAX, edit->b_row);
+                    render_row(&output, &options, &candidate.table, edit->b_row, soc_map_lookup(&soc, candidate.table.addr[edit->b_row], &register_index_cache), &soc.fields);
+                }
+            }
+            else if((reference.table.value[edit->a_row] != candidate.table.value[edit->b_row]) ||
+                    (reference.table.delay[edit->a_row] != candidate.table.delay[edit->b_row]) ||
+                    (reference.table.attr[edit->a_row] != candidate.table.attr[edit->b_row])){
+                changed++;
+                if(!options.diff_summary_only){
+                    render_diff_changed_row(&output, &reference.table, edit->a_row, &candidate.table, edit->b_row, soc_map_lookup(&soc, reference.table.addr[edit->a_row], &register_index_cache));
+                }
+            }
+            else{
+                equal++;
+            }
+        }
+        output_str(&output, "Equal ");
+        output_dec(&output, equal);
+        output_str(&output, " - Changed ");
+        output_dec(&output, changed);
+        output_str(&output, " - Removed ");
+        output_dec(&output, removed);
+        output_str(&output, " - Inserted ");
+        output_dec(&output, inserted);
+        output_char(&output, '\n');
+    }
+
+diff_main_close:
+    output_close(&output);
+diff_main_exit:
+    free_register_table(&reference.table);
+    free_register_table(&candidate.table);
+    free(reference.keys);
+    free(candidate.keys);
+    free(diff.v1);
+    free(diff.v2);
+    free(diff.edits);
+    free_soc(&soc);
+    free(specs);
+    return result;
+}
+
+
+/* SIMULATION */
+
+/*
+ * -simulate executes tables like init_registers() against a sparse register file(see hisi-initregtable.h) and reports
+ * the final value of every touched register and the polls that would spin forever.
+ * - Register file can be seeded from a dump(-seed=DumpFile): "ADDRESS VALUE" per line, other lines are skipped.
+ *   Registers missing from the dump read as 0.
+ * - Tables are simulated side by side on batch workers. Each worker reuses its own table, register file and result buffers.
+ */
+
+typedef struct{
+    uint32_t address;
+    uint32_t value;
+} simulation_seed_type;
+
+typedef struct{
+    register_table_type table;
+    register_file_type registers;
+    simulation_result_type result;
+    register_file_entry_type **touched;     //Touched registers sorted by address
+    size_t touched_size;
+} simulation_worker_type;
+
+typedef struct{
+    table_spec_type *specs;
+    simulation_seed_type *seeds;
+    size_t seeds_count;
+    simulation_worker_type *workers;
+} simulation_type;
+
+
+/* Returns 0 on success, -1 if malloc() fails */
+int add_simulation_seed(simulation_seed_type **seeds, size_t *seeds_count, size_t *seeds_size, uint32_t address, uint32_t value){
+    simulation_seed_type *temp_ptr;
+    if(*seeds_count == *seeds_size){
+        *seeds_size = *seeds_size ? (*seeds_size * 2) : 256;
+        temp_ptr = realloc(*seeds, (sizeof(simulation_seed_type) * *seeds_size));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        *seeds = temp_ptr;
+    }
+    (*seeds)[*seeds_count].address = address;
+    (*seeds)[*seeds_count].value = value;
+    (*seeds_count)++;
+    return 0;
+}
+
+/* Load "ADDRESS VALUE" lines. Returns 0 or ERROR_* (not printed) */
+int load_simulation_seeds(const char *filename, simulation_seed_type **seeds, size_t *seeds_count){
+    FILE *fptr;
+    char *line = NULL;
+    size_t line_size = 0;
+    size_t seeds_size = 0;
+    char *address_end;
+    char *value_end;
+    uint32_t address;
+    uint32_t value;
+
+    *seeds = NULL;
+    *seeds_count = 0;
+    fptr = fopen(filename, "r");
+    if(fptr == NULL){
+        return ERROR_OPEN_SEED_FILE;
+    }
+    while(getline(&line, &line_size, fptr) >= 0){
+        address = strtoul(line, &address_end, 0);
+        if(address_end == line){
+            continue;                       //Not a register line
+        }
+        value = strtoul(address_end, &value_end, 0);
+        if(value_end == address_end){
+            continue;
+        }
+        if(add_simulation_seed(seeds, seeds_count, &seeds_size, address, value) != 0){
+            free(line);
+            fclose(fptr);
+            return ERROR_SIMULATION_MALLOC_FAILED;
+        }
+    }
+    free(line);
+    fclose(fptr);
+    return 0;
+}
+
+/* Allocate(first use) or clear register file and apply seeds in order. Returns 0 on success, -1 if malloc() fails */
+int prepare_register_file(register_file_type *registers, size_t expected_registers, const simulation_seed_type *seeds, size_t seeds_count){
+    if(registers->entries == NULL){
+        if(alloc_register_file(registers, expected_registers) != 0){
+            return -1;
+        }
+    }
+    else{
+        clear_register_file(registers);
+    }
+    for(size_t i = 0; i < seeds_count; i++){
+        if(seed_register_file(registers, seeds[i].address, seeds[i].value) != 0){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int simulation_touched_compare(const void *a, const void *b){
+    uint32_t address_a = (*(register_file_entry_type* const*)a)->address;
+    uint32_t address_b = (*(register_file_entry_type* const*)b)->address;
+    return (address_a < address_b) ? -1 : (address_a > address_b);
+}
+
+void render_simulation(output_buffer_type *output, const soc_map_type *soc, const simulation_worker_type *worker, size_t touched_count){
+    const simulation_result_type *result = &worker->result;
+    const register_file_entry_type *entry;
+    const soc_register_type *soc_register;
+    uint32_t register_index_cache = 0;
+
+    output_str(output, "Rows ");
+    output_dec(output, worker->table.count);
+    output_str(output, " - Executed ");
+    output_dec(output, result->rows_executed);
+    if(result->terminate_row != SIZE_MAX){
+        output_str(output, " - Terminated at row ");
+        output_dec(output, result->terminate_row);
+    }
+    else{
+        output_str(output, " - No null entry");
+    }
+    output_str(output, " - Writes ");
+    output_dec(output, result->writes);
+    output_str(output, " - Polls ");
+    output_dec(output, result->polls);
+    output_str(output, " - Stuck polls ");
+    output_dec(output, result->stuck_polls_count);
+    output_str(output, " - Delay ");
+    output_dec(output, result->delay_total);
+    output_char(output, '\n');
+
+    for(size_t i = 0; i < result->stuck_polls_count; i++){
+        soc_register = soc_map_lookup(soc, result->stuck_polls[i].address, &register_index_cache);
+        output_color(output, color_red_str);
+        output_str(output, "STUCK POLL");
+        output_color(output, color_default_str);
+        output_str(output, " ROW ");
+        output_dec_padded(output, result->stuck_polls[i].row, 6);
+        output_char(output, ' ');
+        output_color(output, color_green_str);
+        output_str(output, addr_str);
+        output_color(output, color_default_str);
+        output_hex32(output, result->stuck_polls[i].address);
+        output_char(output, ' ');
+        output_str_padded(output, soc_register->register_name, 15);
+        output_color(output, color_green_str);
+        output_str(output, "   EXPECTS: ");
+        output_color(output, color_default_str);
+        output_hex32(output, result->stuck_polls[i].expected);
+        output_color(output, color_green_str);
+        output_str(output, "   READS: ");
+        output_color(output, color_red_str);
+        output_hex32(output, result->stuck_polls[i].actual);
+        output_color(output, color_default_str);
+        output_str(output, "  (SPINS FOREVER)\n");
+    }
+
+    for(size_t i = 0; i < touched_count; i++){
+        entry = worker->touched[i];
+        soc_register = soc_map_lookup(soc, entry->address, &register_index_cache);
+        output_color(output, color_green_str);
+        output_str(output, "REG: ");
+        output_color(output, color_default_str);
+        output_hex32(output, entry->address);
+        output_char(output, ' ');
+        output_str_padded(output, soc_register->register_name, 15);
+        output_color(output, color_green_str);
+        output_str(output, "   INITIAL: ");
+        output_color(output, color_default_str);
+        output_hex32(output, entry->initial_value);
+        output_str(output, (entry->state & REGISTER_FILE_SEEDED) ? " (DUMP)   " : " (RESET)  ");
+        output_color(output, color_green_str);
+        output_str(output, "FINAL: ");
+        output_color(output, (entry->value != entry->initial_value) ? color_yellow_str : color_default_str);
+        output_hex32(output, entry->value);
+        output_color(output, color_green_str);
+        output_str(output, "   WRITES: ");
+        output_color(output, color_default_str);
+        output_dec(output, entry->writes);
+        output_color(output, color_green_str);
+        output_str(output, "   POLLS: ");
+        output_color(output, color_default_str);
+        output_dec(output, entry->reads);
+        output_char(output, '\n');
+    }
+}
+
+/* Simulate one table into its output. Returns 0 or ERROR_* */
+static int32_t batch_simulate_file(batch_type *batch, batch_file_type *file, uint32_t worker_index){
+    simulation_type *simulation = batch->context;
+    simulation_worker_type *worker = &simulation->workers[worker_index];
+    register_file_entry_type **temp_ptr;
+    size_t touched_count = 0;
+    int32_t result;
+
+    result = load_table_spec(&worker->table, &simulation->specs[file - batch->files]);
+    if(result != 0){
+        return result;
+    }
+
+    /* Register file. Allocated once per worker, cleared and seeded per table */
+    if(prepare_register_file(&worker->registers, (worker->table.count + simulation->seeds_count), simulation->seeds, simulation->seeds_count) != 0){
+        return ERROR_SIMULATION_MALLOC_FAILED;
+    }
+
+    if(simulate_register_table(&worker->registers, &worker->table, &worker->result) != 0){
+        return ERROR_SIMULATION_MALLOC_FAILED;
+    }
+
+    /* Touched registers by address */
+    if(worker->registers.count > worker->touched_size){
+        temp_ptr = realloc(worker->touched, (sizeof(register_file_entry_type*) * worker->registers.count));
+        if(temp_ptr == NULL){
+            return ERROR_SIMULATION_MALLOC_FAILED;
+        }
+        worker->touched = temp_ptr;
+        worker->touched_size = worker->registers.count;
+    }
+    for(uint32_t i = 0; i < worker->registers.size; i++){
+        if(worker->registers.entries[i].state & (REGISTER_FILE_WRITTEN | REGISTER_FILE_READ)){
+            worker->touched[touched_count++] = &worker->registers.entries[i];
+        }
+    }
+    qsort(worker->touched, touched_count, sizeof(register_file_entry_type*), simulation_touched_compare);
+
+    render_simulation(&file->output, batch->soc, worker, touched_count);
+    return 0;
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - "-simulate"
+ argv[2..]  - tables
+ argv[n]    - soc type
+ argv[>n]   - optional parameters(argv[>n+1] if csv file is passed as parameter)
+ */
+
+int simulate_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    simulation_type simulation;
+    batch_type batch;
+    soc_map_type soc;
+    int32_t soc_type_index;
+    uint32_t workers_count;
+    int argi;
+    int32_t result = 0;
+
+    memset(&simulation, 0, sizeof(simulation));
+    memset(&batch, 0, sizeof(batch));
+
+    /* Tables until SoC type */
+    argi = find_soc_type_parameter(argc, argv, 3);
+    if(argi < 0){
+        print_error_stderr((argc < 4) ? ERROR_PARAMETER_COUNT : ERROR_UNKNOWN_SOC_TYPE);
+        return ((argc < 4) ? ERROR_PARAMETER_COUNT : ERROR_UNKNOWN_SOC_TYPE);
+    }
+    soc_type_index = find_soc_type(argv[argi]);
+    batch.files_count = argi - 2;
+    argi++;
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        if(argi >= argc){
+            print_error_stderr(ERROR_PARAMETER_COUNT);
+            return ERROR_PARAMETER_COUNT;
+        }
+        argi++;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+
+    workers_count = batch_workers_count(&options, batch.files_count);
+    batch.files = calloc(batch.files_count, sizeof(batch_file_type));
+    simulation.specs = calloc(batch.files_count, sizeof(table_spec_type));
+    simulation.workers = calloc(workers_count, sizeof(simulation_worker_type));
+    if((batch.files == NULL) || (simulation.specs == NULL) || (simulation.workers == NULL)){
+        result = ERROR_SIMULATION_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto simulate_main_exit;
+    }
+    for(uint32_t i = 0; i < batch.files_count; i++){
+        batch.files[i].path = strdup(argv[2 + i]);          //Shown as given. Spec parsing splits argv
+        if(batch.files[i].path == NULL){
+            result = ERROR_SIMULATION_MALLOC_FAILED;
+            print_error_stderr(result);
+            goto simulate_main_exit;
+        }
+        result = parse_table_spec(argv[2 + i], &simulation.specs[i]);
+        if(result != 0){
+            goto simulate_main_exit;
+        }
+    }
+
+    if(options.seed_filename){
+        result = load_simulation_seeds(options.seed_filename, &simulation.seeds, &simulation.seeds_count);
+        if(result != 0){
+            print_error_stderr(result);
+            goto simulate_main_exit;
+        }
+    }
+
+    result = load_soc(&soc, soc_type_index, ((soc_type_index == SOC_TYPE_INDEX_CSV) ? argv[argi-1] : NULL), &options);
+    if(result != 0){
+        goto simulate_main_exit;
+    }
+    batch.options = &options;
+    batch.soc = &soc;
+    batch.process_file = batch_simulate_file;
+    batch.context = &simulation;
+    result = run_batch(&batch, workers_count);
+    free_soc(&soc);
+
+simulate_main_exit:
+    if(simulation.workers){
+        for(uint32_t i = 0; i < workers_count; i++){
+            free_register_table(&simulation.workers[i].table);
+            free_register_file(&simulation.workers[i].registers);
+            free_simulation_result(&simulation.workers[i].result);
+            free(simulation.workers[i].touched);
+        }
+    }
+    if(batch.files){
+        for(uint32_t i = 0; i < batch.files_count; i++){
+            free(batch.files[i].path);
+        }
+    }
+    free(batch.files);
+    free(simulation.specs);
+    free(simulation.workers);
+    free(simulation.seeds);
+    return result;
+}
+
+
+/* TIMING */
+
+/*
+ * -timing estimates how long init_registers() runs each table(see TIMING in hisi-initregtable.h).
+ * Delay counts are turned into core cycles and time with the core clock of the clock model at that row.
+ * Report has per phase(same clock) and total budget and the rows that cost the most time(-top=N).
+ * - Built in clock model follows Hi3516A style SYS CTRL mode and CRG APLL registers. Other SoCs need -clock=ModelFile:
+ *     loop_cycles 3                          Core cycles per delay count
+ *     row_cycles 0                           Core cycles per executed entry besides delay
+ *     mode 0x20050000 0 3                    Mode field: ADDRESS START_BIT BITS
+ *     mode_clock 1 24000000 DOZE             Mode field value, core clock in Hz or "pll", name
+ *     reference_hz 24000000                  PLL reference clock
+ *     fbdiv 0x20030004 0 12                  PLL fields: fbdiv, refdiv, postdiv1, postdiv2 ADDRESS START_BIT BITS
+ *     pll_divider 1                          PLL to core divider
+ *     reset 0x20050000 0x1                   Register value at reset. -seed= dump overrides
+ *   '#' starts a comment.
+ * - Register file starts from reset values and -seed=DumpFile. Other registers read as 0.
+ */
+
+#define TIMING_DEFAULT_LOOP_CYCLES 3        //Delay loop is a three instruction countdown
+
+typedef struct{
+    clock_model_type model;
+    simulation_seed_type *seeds;            //Model reset values followed by -seed= dump
+    size_t seeds_count;
+    table_spec_type *specs;
+    struct timing_worker_struct *workers;
+    uint32_t top_rows;
+} timing_type;
+
+typedef struct timing_worker_struct{
+    register_table_type table;
+    register_file_type registers;
+    timing_result_type result;
+    size_t *top;                            //Most expensive rows. top_rows long
+} timing_worker_type;
+
+/* Hi3516A: SC_CTRL mode control bits 0-2(DOZE at reset), APLL in PERI_CRG_PLL0/1 with 24MHz crystal reference */
+const clock_model_type default_clock_model = {
+    TIMING_DEFAULT_LOOP_CYCLES,
+    0,
+    {0x20050000, 0, 3},
+    {0, 24000000, 24000000, 24000000, CLOCK_MODE_PLL, CLOCK_MODE_PLL, CLOCK_MODE_PLL, CLOCK_MODE_PLL},
+    {"SLEEP", "DOZE", "SLOW", "SLOW", "NORMAL", "NORMAL", "NORMAL", "NORMAL"},
+    24000000,
+    {0x20030004, 0, 12},
+    {0x20030004, 12, 6},
+    {0x20030000, 24, 3},
+    {0x20030000, 28, 3},
+    1
+};
+
+const simulation_seed_type default_clock_model_resets[] = {
+    {0x20050000, 0x1}                       //DOZE
+};
+
+
+/* Parse "ADDRESS START_BIT BITS" of str. Returns 0 or -1 */
+static int parse_clock_field(char *str, clock_field_type *field){
+    char *end;
+    field->address = strtoul(str, &end, 0);
+    if(end == str){
+        return -1;
+    }
+    str = end;
+    field->start_bit = strtoul(str, &end, 0);
+    if((end == str) || (field->start_bit > 31)){
+        return -1;
+    }
+    str = end;
+    field->bits = strtoul(str, &end, 0);
+    if((end == str) || (field->bits == 0) || ((field->start_bit + field->bits) > 32)){
+        return -1;
+    }
+    return 0;
+}
+
+/* Parse "VALUE HZ|pll NAME" of str. Returns 0 or -1 */
+static int parse_clock_mode(char *str, clock_model_type *model){
+    char *end;
+    uint32_t mode = strtoul(str, &end, 0);
+    size_t length;
+
+    if((end == str) || (mode >= CLOCK_MODEL_MODES)){
+        return -1;
+    }
+    str = end + strspn(end, " \t");
+    if(strncmp(str, "pll", 3) == 0){
+        model->mode_hz[mode] = CLOCK_MODE_PLL;
+        end = str + 3;
+    }
+    else{
+        model->mode_hz[mode] = strtoul(str, &end, 0);
+        if(end == str){
+            return -1;
+        }
+    }
+    str = end + strspn(end, " \t");
+    length = strcspn(str, " \t\r\n");
+    if(length >= CLOCK_MODE_NAME_LENGTH){
+        length = CLOCK_MODE_NAME_LENGTH - 1;
+    }
+    memcpy(model->mode_name[mode], str, length);
+    model->mode_name[mode][length] = '\0';
+    return 0;
+}
+
+/* Load clock model file. Reset values are added to seeds. Returns 0 or ERROR_* (printed to stderr) */
+int load_clock_model(const char *filename, clock_model_type *model, simulation_seed_type **seeds, size_t *seeds_count, size_t *seeds_size){
+    FILE *fptr;
+    char *line = NULL;
+    size_t line_size = 0;
+    size_t line_number = 0;
+    char *key;
+    char *value_str;
+    char *end;
+    size_t key_length;
+    uint32_t address;
+    uint32_t value;
+    int result = 0;
+
+    memset(model, 0, sizeof(clock_model_type));
+    model->loop_cycles = TIMING_DEFAULT_LOOP_CYCLES;
+    fptr = fopen(filename, "r");
+    if(fptr == NULL){
+        print_error_stderr(ERROR_OPEN_CLOCK_MODEL_FILE);
+        return ERROR_OPEN_CLOCK_MODEL_FILE;
+    }
+    while((result == 0) && (getline(&line, &line_size, fptr) >= 0)){
+        line_number++;
+        if(strchr(line, '#')){
+            *strchr(line, '#') = '\0';
+        }
+        key = line + strspn(line, " \t\r\n");
+        if(*key == '\0'){
+            continue;
+        }
+        key_length = strcspn(key, " \t\r\n");
+        value_str = key + key_length;
+
+#define CLOCK_MODEL_KEY(str) ((key_length == (sizeof(str) - 1)) && (strncmp(key, str, key_length) == 0))
+        if(CLOCK_MODEL_KEY("loop_cycles") || CLOCK_MODEL_KEY("row_cycles") || CLOCK_MODEL_KEY("reference_hz") || CLOCK_MODEL_KEY("pll_divider")){
+            value = strtoul(value_str, &end, 0);
+            if(end == value_str){
+                result = ERROR_CLOCK_MODEL_PARSING_ERROR;
+            }
+            else if(CLOCK_MODEL_KEY("loop_cycles")){
+                model->loop_cycles = value;
+            }
+            else if(CLOCK_MODEL_KEY("row_cycles")){
+                model->row_cycles = value;
+            }
+            else if(CLOCK_MODEL_KEY("reference_hz")){
+                model->reference_hz = value;
+            }
+            else{
+                model->pll_divider = value;
+            }
+        }
+        else if(CLOCK_MODEL_KEY("mode")){
+            result = parse_clock_field(value_str, &model->mode) ? ERROR_CLOCK_MODEL_PARSING_ERROR : 0;
+        }
+        else if(CLOCK_MODEL_KEY("mode_clock")){
+            result = parse_clock_mode(value_str, model) ? ERROR_CLOCK_MODEL_PARSING_ERROR : 0;
+        }
+        else if(CLOCK_MODEL_KEY("fbdiv")){
+            result = parse_clock_field(value_str, &model->fbdiv) ? ERROR_CLOCK_MODEL_PARSING_ERROR : 0;
+        }
+        else if(CLOCK_MODEL_KEY("refdiv")){
+            result = parse_clock_field(value_str, &model->refdiv) ? ERROR_CLOCK_MODEL_PARSING_ERROR : 0;
+        }
+        else if(CLOCK_MODEL_KEY("postdiv1")){
+            result = parse_clock_field(value_str, &model->postdiv1) ? ERROR_CLOCK_MODEL_PARSING_ERROR : 0;
+        }
+        else if(CLOCK_MODEL_KEY("postdiv2")){
+            result = parse_clock_field(value_str, &model->postdiv2) ? ERROR_CLOCK_MODEL_PARSING_ERROR : 0;
+        }
+        else if(CLOCK_MODEL_KEY("reset")){
+            address = strtoul(value_str, &end, 0);
+            if(end == value_str){
+                result = ERROR_CLOCK_MODEL_PARSING_ERROR;
+                continue;
+            }
+            value_str = end;
+            value = strtoul(value_str, &end, 0);
+            if(end == value_str){
+                result = ERROR_CLOCK_MODEL_PARSING_ERROR;
+            }
+            else if(add_simulation_seed(seeds, seeds_count, seeds_size, address, value) != 0){
+                result = ERROR_TIMING_MALLOC_FAILED;
+            }
+        }
+        else{
+            result = ERROR_CLOCK_MODEL_PARSING_ERROR;
+        }
+#undef CLOCK_MODEL_KEY
+    }
+    free(line);
+    fclose(fptr);
+
+    if((result == 0) && (model->mode.bits > 4)){                //Mode value indexes mode_hz
+        result = ERROR_CLOCK_MODEL_PARSING_ERROR;
+    }
+    if(result != 0){
+        print_error_stderr(result);
+        if(result == ERROR_CLOCK_MODEL_PARSING_ERROR){
+            fprintf(stderr, "%zu\n", line_number);
+        }
+    }
+    return result;
+}
+
+
+/* printf("%lu.%03lu", value/1000, value%1000) */
+static void output_thousandths(output_buffer_type *output, uint64_t value){
+    output_dec(output, (value / 1000));
+    output_char(output, '.');
+    output_dec_padded(output, (value % 1000), 3);
+}
+
+/* "(12.3%)" of part/total */
+static void output_percent(output_buffer_type *output, uint64_t part, uint64_t total){
+    uint64_t permille = total ? ((part * 1000) / total) : 0;
+    output_char(output, '(');
+    output_dec(output, (permille / 10));
+    output_char(output, '.');
+    output_dec(output, (permille % 10));
+    output_str(output, "%)");
+}
+
+static void output_clock(output_buffer_type *output, uint32_t clock_hz){
+    if(clock_hz){
+        output_thousandths(output, (clock_hz / 1000));
+        output_str(output, " MHz");
+    }
+    else{
+        output_str(output, "UNKNOWN");
+    }
+}
+
+void render_timing(output_buffer_type *output, const soc_map_type *soc, const clock_model_type *model, const timing_worker_type *worker, size_t top_count){
+    const timing_result_type *result = &worker->result;
+    const timing_phase_type *phase;
+    const soc_register_type *soc_register;
+    uint32_t register_index_cache = 0;
+    size_t row;
+
+    output_str(output, "Rows ");
+    output_dec(output, worker->table.count);
+    output_str(output, " - Executed ");
+    output_dec(output, result->rows_executed);
+    if(result->terminate_row != SIZE_MAX){
+        output_str(output, " - Terminated at row ");
+        output_dec(output, result->terminate_row);
+    }
+    else{
+        output_str(output, " - No null entry");
+    }
+    output_str(output, " - Delay ");
+    output_dec(output, result->delay_total);
+    output_str(output, " - Cycles ");
+    output_dec(output, result->cycles_total);
+    output_str(output, " - Time ");
+    output_thousandths(output, result->nanoseconds_total);
+    output_str(output, " us");
+    if(result->unknown_clock_cycles){
+        output_str(output, " - Cycles at unknown clock ");
+        output_dec(output, result->unknown_clock_cycles);
+    }
+    output_str(output, " (polls not included)\n");
+
+    for(size_t i = 0; i < result->phases_count; i++){
+        phase = &result->phases[i];
+        if(!phase->rows){
+            continue;                       //Clock changed again on the same row
+        }
+        output_color(output, color_blue_str);
+        output_str(output, "PHASE ");
+        output_dec_padded(output, i, 2);
+        output_color(output, color_default_str);
+        output_str(output, " ROWS ");
+        output_dec_padded(output, phase->first_row, 6);
+        output_char(output, '-');
+        output_dec_padded(output, (phase->first_row + phase->rows - 1), 6);
+        output_char(output, ' ');
+        output_str_padded(output, model->mode_name[phase->mode], CLOCK_MODE_NAME_LENGTH);
+        output_color(output, color_green_str);
+        output_str(output, "CLOCK: ");
+        output_color(output, color_default_str);
+        output_clock(output, phase->clock_hz);
+        output_color(output, color_green_str);
+        output_str(output, "   DELAY: ");
+        output_color(output, color_default_str);
+        output_dec(output, phase->delay);
+        output_color(output, color_green_str);
+        output_str(output, "   CYCLES: ");
+        output_color(output, color_default_str);
+        output_dec(output, phase->cycles);
+        output_color(output, color_green_str);
+        output_str(output, "   TIME: ");
+        output_color(output, (phase->clock_hz ? color_yellow_str : color_red_str));
+        if(phase->clock_hz){
+            output_thousandths(output, phase->nanoseconds);
+            output_str(output, " us ");
+            output_percent(output, phase->nanoseconds, result->nanoseconds_total);
+        }
+        else{
+            output_str(output, "UNKNOWN");
+        }
+        output_color(output, color_green_str);
+        output_str(output, "   POLLS: ");
+        output_color(output, color_default_str);
+        output_dec(output, phase->polls);
+        output_char(output, '\n');
+    }
+
+    for(size_t i = 0; i < top_count; i++){
+        row = worker->top[i];
+        soc_register = soc_map_lookup(soc, worker->table.addr[row], &register_index_cache);
+        output_color(output, color_yellow_str);
+        output_str(output, "TOP ");
+        output_dec_padded(output, (i + 1), 2);
+        output_color(output, color_default_str);
+        output_str(output, " ROW ");
+        output_dec_padded(output, row, 6);
+        output_char(output, ' ');
+        output_color(output, color_green_str);
+        output_str(output, addr_str);
+        output_color(output, color_default_str);
+        output_hex32(output, worker->table.addr[row]);
+        output_char(output, ' ');
+        output_str_padded(output, soc_register->register_name, 15);
+        output_color(output, color_green_str);
+        output_str(output, delay_str);
+        output_color(output, color_default_str);
+        output_hex32(output, worker->table.delay[row]);
+        output_str(output, " DEC ");
+        output_dec_padded(output, worker->table.delay[row], 10);
+        output_color(output, color_green_str);
+        output_str(output, "   CYCLES: ");
+        output_color(output, color_default_str);
+        output_dec(output, result->rows[row].cycles);
+        output_color(output, color_green_str);
+        output_str(output, "   TIME: ");
+        output_color(output, color_default_str);
+        if(result->rows[row].nanoseconds || !result->rows[row].cycles){
+            output_thousandths(output, result->rows[row].nanoseconds);
+            output_str(output, " us ");
+            output_percent(output, result->rows[row].nanoseconds, result->nanoseconds_total);
+        }
+        else{
+            output_str(output, "UNKNOWN");
+        }
+        output_char(output, '\n');
+    }
+}
+
+/* Row a costs more than row b. Rows at unknown clock rank by cycles after timed rows */
+static inline int timing_row_before(const timing_result_type *result, size_t a, size_t b){
+    if(result->rows[a].nanoseconds != result->rows[b].nanoseconds){
+        return (result->rows[a].nanoseconds > result->rows[b].nanoseconds);
+    }
+    if(result->rows[a].cycles != result->rows[b].cycles){
+        return (result->rows[a].cycles > result->rows[b].cycles);
+    }
+    return (a < b);
+}
+
+/* Estimate one table into its output. Returns 0 or ERROR_* */
+static int32_t batch_timing_file(batch_type *batch, batch_file_type *file, uint32_t worker_index){
+    timing_type *timing = batch->context;
+    timing_worker_type *worker = &timing->workers[worker_index];
+    timing_result_type *result = &worker->result;
+    size_t top_count = 0;
+    size_t position;
+    int32_t error;
+
+    error = load_table_spec(&worker->table, &timing->specs[file - batch->files]);
+    if(error != 0){
+        return error;
+    }
+    if(prepare_register_file(&worker->registers, (worker->table.count + timing->seeds_count), timing->seeds, timing->seeds_count) != 0){
+        return ERROR_TIMING_MALLOC_FAILED;
+    }
+    if(estimate_register_table_timing(&worker->registers, &timing->model, &worker->table, result) != 0){
+        return ERROR_TIMING_MALLOC_FAILED;
+    }
+
+    /* Insertion into short sorted list of most expensive rows */
+    for(size_t i = 0; i < result->rows_executed; i++){
+        if(!result->rows[i].cycles){
+            continue;
+        }
+        position = top_count;
+        while((position > 0) && timing_row_before(result, i, worker->top[position - 1])){
+            position--;
+        }
+        if(position >= timing->top_rows){
+            continue;
+        }
+        if(top_count < timing->top_rows){
+            top_count++;
+        }
+        memmove(&worker->top[position + 1], &worker->top[position], (sizeof(size_t) * (top_count - position - 1)));
+        worker->top[position] = i;
+    }
+
+    render_timing(&file->output, batch->soc, &timing->model, worker, top_count);
+    return 0;
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - "-timing"
+ argv[2..]  - tables
+ argv[n]    - soc type
+ argv[>n]   - optional parameters(argv[>n+1] if csv file is passed as parameter)
+ */
+
+int timing_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    timing_type timing;
+    batch_type batch;
+    soc_map_type soc;
+    simulation_seed_type *dump_seeds = NULL;
+    size_t dump_seeds_count = 0;
+    size_t seeds_size = 0;
+    int32_t soc_type_index;
+    uint32_t workers_count;
+    int argi;
+    int32_t result = 0;
+
+    memset(&timing, 0, sizeof(timing));
+    memset(&batch, 0, sizeof(batch));
+
+    /* Tables until SoC type */
+    argi = find_soc_type_parameter(argc, argv, 3);
+    if(argi < 0){
+        print_error_stderr((argc < 4) ? ERROR_PARAMETER_COUNT : ERROR_UNKNOWN_SOC_TYPE);
+        return ((argc < 4) ? ERROR_PARAMETER_COUNT : ERROR_UNKNOWN_SOC_TYPE);
+    }
+    soc_type_index = find_soc_type(argv[argi]);
+    batch.files_count = argi - 2;
+    argi++;
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        if(argi >= argc){
+            print_error_stderr(ERROR_PARAMETER_COUNT);
+            return ERROR_PARAMETER_COUNT;
+        }
+        argi++;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+    timing.top_rows = options.timing_top_rows;
+
+    workers_count = batch_workers_count(&options, batch.files_count);
+    batch.files = calloc(batch.files_count, sizeof(batch_file_type));
+    timing.specs = calloc(batch.files_count, sizeof(table_spec_type));
+    timing.workers = calloc(workers_count, sizeof(timing_worker_type));
+    if((batch.files == NULL) || (timing.specs == NULL) || (timing.workers == NULL)){
+        result = ERROR_TIMING_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto timing_main_exit;
+    }
+    for(uint32_t i = 0; i < workers_count; i++){
+        timing.workers[i].top = malloc(sizeof(size_t) * (timing.top_rows + 1));
+        if(timing.workers[i].top == NULL){
+            result = ERROR_TIMING_MALLOC_FAILED;
+            print_error_stderr(result);
+            goto timing_main_exit;
+        }
+    }
+    for(uint32_t i = 0; i < batch.files_count; i++){
+        batch.files[i].path = strdup(argv[2 + i]);          //Shown as given. Spec parsing splits argv
+        if(batch.files[i].path == NULL){
+            result = ERROR_TIMING_MALLOC_FAILED;
+            print_error_stderr(result);
+            goto timing_main_exit;
+        }
+        result = parse_table_spec(argv[2 + i], &timing.specs[i]);
+        if(result != 0){
+            goto timing_main_exit;
+        }
+    }
+
+    /* Clock model and its reset values, then register dump */
+    if(options.clock_model_filename){
+        result = load_clock_model(options.clock_model_filename, &timing.model, &timing.seeds, &timing.seeds_count, &seeds_size);
+        if(result != 0){
+            goto timing_main_exit;
+        }
+    }
+    else{
+        timing.model = default_clock_model;
+        for(size_t i = 0; i < (sizeof(default_clock_model_resets)/sizeof(simulation_seed_type)); i++){
+            if(add_simulation_seed(&timing.seeds, &timing.seeds_count, &seeds_size, default_clock_model_resets[i].address, default_clock_model_resets[i].value) != 0){
+                result = ERROR_TIMING_MALLOC_FAILED;
+                print_error_stderr(result);
+                goto timing_main_exit;
+            }
+        }
+    }
+    if(options.seed_filename){
+        result = load_simulation_seeds(options.seed_filename, &dump_seeds, &dump_seeds_count);
+        if(result != 0){
+            print_error_stderr(result);
+            goto timing_main_exit;
+        }
+        for(size_t i = 0; i < dump_seeds_count; i++){
+            if(add_simulation_seed(&timing.seeds, &timing.seeds_count, &seeds_size, dump_seeds[i].address, dump_seeds[i].value) != 0){
+                result = ERROR_TIMING_MALLOC_FAILED;
+                print_error_stderr(result);
+                goto timing_main_exit;
+            }
+        }
+    }
+
+    result = load_soc(&soc, soc_type_index, ((soc_type_index == SOC_TYPE_INDEX_CSV) ? argv[argi-1] : NULL), &options);
+    if(result != 0){
+        goto timing_main_exit;
+    }
+    batch.options = &options;
+    batch.soc = &soc;
+    batch.process_file = batch_timing_file;
+    batch.context = &timing;
+    result = run_batch(&batch, workers_count);
+    free_soc(&soc);
+
+timing_main_exit:
+    if(timing.workers){
+        for(uint32_t i = 0; i < workers_count; i++){
+            free_register_table(&timing.workers[i].table);
+            free_register_file(&timing.workers[i].registers);
+            free_timing_result(&timing.workers[i].result);
+            free(timing.workers[i].top);
+        }
+    }
+    if(batch.files){
+        for(uint32_t i = 0; i < batch.files_count; i++){
+            free(batch.files[i].path);
+        }
+    }
+    free(batch.files);
+    free(timing.specs);
+    free(timing.workers);
+    free(timing.seeds);
+    free(dump_seeds);
+    return result;
+}
+
+
+/* OPTIMIZATION */
+
+/*
+ * -optimize writes a shorter equivalent table(see OPTIMIZATION in hisi-initregtable.h) to OutputBinFile and reports
+ * every dropped row: dead writes, writes merged into the following write and delays folded into the previous row.
+ * Output table ends with the null entry of the input table(if it had one). -summary prints only the counts.
+ */
+
+static void render_optimization_row(output_buffer_type *output, const char *marker_str, const char *color_str, size_t row, uint32_t output_row){
+    output_color(output, color_str);
+    output_str(output, marker_str);
+    output_color(output, color_default_str);
+    output_dec_padded(output, row, 6);
+    if(output_row != UINT32_MAX){
+        output_str(output, " -> ");
+        output_dec_padded(output, output_row, 6);
+    }
+    else{
+        output_str(output, "          ");
+    }
+    output_char(output, ' ');
+}
+
+/* Write rows of table in binary format */
+void output_register_table(output_buffer_type *output, const register_table_type *table){
+    uint8_t *ptr;
+    for(size_t i = 0; i < table->count; i++){
+        ptr = (uint8_t*)output_reserve(output, DATA_ROW_SIZE);
+        put_le32(&ptr[0], table->addr[i]);
+        put_le32(&ptr[4], table->value[i]);
+        put_le32(&ptr[8], table->delay[i]);
+        put_le32(&ptr[12], table->attr[i]);
+        output->length += DATA_ROW_SIZE;
+    }
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - "-optimize"
+ argv[2]    - table
+ argv[3]    - output binary file
+ argv[4]    - soc type
+ argv[>=5]  - optional parameters(argv[>=6] if csv file is passed as parameter)
+ */
+
+int optimize_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    table_spec_type spec;
+    register_table_type table;
+    register_table_type optimized;
+    optimization_result_type optimization;
+    output_buffer_type output;
+    output_buffer_type table_output;
+    soc_map_type soc;
+    int32_t soc_type_index;
+    uint32_t register_index_cache = 0;
+    uint64_t delay_before = 0;
+    uint64_t delay_after = 0;
+    int argi = 5;
+    int fd;
+    int32_t result;
+
+    if(argc < 5){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+    soc_type_index = find_soc_type(argv[4]);
+    if(soc_type_index < 0){
+        print_error_stderr(ERROR_UNKNOWN_SOC_TYPE);
+        return ERROR_UNKNOWN_SOC_TYPE;
+    }
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        if(argi >= argc){
+            print_error_stderr(ERROR_PARAMETER_COUNT);
+            return ERROR_PARAMETER_COUNT;
+        }
+        argi++;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+    result = parse_table_spec(argv[2], &spec);
+    if(result != 0){
+        return result;
+    }
+
+    memset(&table, 0, sizeof(table));
+    memset(&optimized, 0, sizeof(optimized));
+    memset(&optimization, 0, sizeof(optimization));
+    result = load_table_spec(&table, &spec);
+    if(result != 0){
+        fprintf(stderr, "%s: ", spec.path);
+        print_error_stderr(result);
+        goto optimize_main_free;
+    }
+    if(optimize_register_table(&table, &optimized, &optimization) != 0){
+        result = ERROR_OPTIMIZE_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto optimize_main_free;
+    }
+
+    /* Optimized table */
+    fd = open(argv[3], (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+    if(fd < 0){
+        result = ERROR_OPEN_OUTPUT_FILE;
+        print_error_stderr(result);
+        goto optimize_main_free;
+    }
+    if(output_open(&table_output, fd, 0) != 0){
+        close(fd);
+        result = ERROR_OUTPUT_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto optimize_main_free;
+    }
+    output_register_table(&table_output, &optimized);
+    output_close(&table_output);
+    close(fd);
+    if(table_output.error){
+        result = ERROR_OPEN_OUTPUT_FILE;
+        print_error_stderr(result);
+        goto optimize_main_free;
+    }
+
+    /* Report */
+    result = load_soc(&soc, soc_type_index, ((soc_type_index == SOC_TYPE_INDEX_CSV) ? argv[5] : NULL), &options);
+    if(result != 0){
+        goto optimize_main_free;
+    }
+    if(output_open(&output, STDOUT_FILENO, options.color_enabled) != 0){
+        free_soc(&soc);
+        result = ERROR_OUTPUT_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto optimize_main_free;
+    }
+    for(size_t i = 0; i < table.count; i++){
+        if(optimization.actions[i] != OPTIMIZE_UNREACHABLE){
+            delay_before += table.delay[i];
+        }
+        if(options.diff_summary_only || (optimization.actions[i] == OPTIMIZE_KEPT)){
+            continue;
+        }
+        if(optimization.actions[i] == OPTIMIZE_DEAD_WRITE){
+            render_optimization_row(&output, "DEAD     ", color_red_str, i, UINT32_MAX);
+        }
+        else if(optimization.actions[i] == OPTIMIZE_MERGED_WRITE){
+            render_optimization_row(&output, "MERGED   ", color_yellow_str, i, optimization.output_row[i]);
+        }
+        else if(optimization.actions[i] == OPTIMIZE_FOLDED_DELAY){
+            render_optimization_row(&output, "FOLDED   ", color_blue_str, i, optimization.output_row[i]);
+        }
+        else{
+            render_optimization_row(&output, "UNREACH  ", color_red_str, i, UINT32_MAX);
+        }
+        render_row(&output, &options, &table, i, soc_map_lookup(&soc, table.addr[i], &register_index_cache), &soc.fields);
+    }
+    for(size_t i = 0; i < optimized.count; i++){
+        delay_after += optimized.delay[i];
+    }
+    output_str(&output, "Rows ");
+    output_dec(&output, table.count);
+    output_str(&output, " -> ");
+    output_dec(&output, optimized.count);
+    output_str(&output, " - Dead writes ");
+    output_dec(&output, optimization.dead_writes);
+    output_str(&output, " - Merged writes ");
+    output_dec(&output, optimization.merged_writes);
+    output_str(&output, " - Folded delays ");
+    output_dec(&output, optimization.folded_delays);
+    output_str(&output, " - Unreachable ");
+    output_dec(&output, optimization.unreachable_rows);
+    output_str(&output, " - Delay ");
+    output_dec(&output, delay_before);
+    output_str(&output, " -> ");
+    output_dec(&output, delay_after);
+    output_char(&output, '\n');
+    output_close(&output);
+    free_soc(&soc);
+
+optimize_main_free:
+    free_register_table(&table);
+    free_register_table(&optimized);
+    free_optimization_result(&optimization);
+    return result;
+}
+
+
+/* SOC AUTODETECT */
+
+/*
+ * -autodetect scores tables against every known SoC map and picks the best match.
+ * - Maps are the built in SoCs and with -maps=DIR every *.csv file in DIR(named by file name, overrides built in SoC of same name).
+ *   CSV maps are loaded in parallel through the map cache(see SOC MAP CACHE).
+ * - Addresses of write and read rows are sorted and deduplicated once per table. Every unique address is looked up once per map
+ *   and weighted by its row count. Sorted addresses keep the lookup cache of get_register_index() hot.
+ * - Every operation row falls into one class per map:
+ *   KNOWN    - block every init table touches(CRG, DDRC/DDR PHY, SYS CTRL, IO MUX/IO CTR, MISC, PMC)   2 points
+ *   MAPPED   - other named region                                                                       1 point
+ *   RESERVED - region named RESERVED                                                                   -1 point
+ *   UNMAPPED - outside every region                                                                    -2 points
+ *   Score = points / (2 * operation rows), at least 0. A table touching only known blocks scores 100%.
+ * - Confidence is HIGH when the best score is >= 60% and 15% ahead of the runner up, MEDIUM when >= 40% and 5% ahead, otherwise LOW.
+ */
+
+#define AUTODETECT_CLASS_KNOWN 0
+#define AUTODETECT_CLASS_MAPPED 1
+#define AUTODETECT_CLASS_RESERVED 2
+#define AUTODETECT_CLASS_UNMAPPED 3
+#define AUTODETECT_CLASS_COUNT 4
+
+#define AUTODETECT_HIGH_SCORE 600           //Thousandths
+#define AUTODETECT_HIGH_MARGIN 150
+#define AUTODETECT_MEDIUM_SCORE 400
+#define AUTODETECT_MEDIUM_MARGIN 50
+
+const int32_t autodetect_class_points[AUTODETECT_CLASS_COUNT] = {2, 1, -1, -2};
+const char *autodetect_class_str[AUTODETECT_CLASS_COUNT] = {"   KNOWN: ", "   MAPPED: ", "   RESERVED: ", "   UNMAPPED: "};
+
+/* Name prefixes of known blocks */
+const char *autodetect_known_blocks[] = {
+    "CRG",
+    "DDRC",
+    "DDR PHY",
+    "SYS CTRL",
+    "SYSCTRL",
+    "IO MUX",
+    "IOMUX",
+    "IO CTR",
+    "IO CONFIG",
+    "MISC",
+    "PMC"
+};
+
+typedef struct{
+    char *name;
+    const char *csv_filename;               //NULL for built in SoC
+    uint32_t soc_type_index;
+    soc_map_type soc;
+    uint8_t *register_class;                //AUTODETECT_CLASS_* per register
+    int32_t result;                         //0 or ERROR_* of loading
+    size_t error_line;                      //CSV line of ERROR_CSV_PARSING_ERROR
+} autodetect_map_type;
+
+typedef struct{
+    uint32_t map_index;
+    uint64_t class_rows[AUTODETECT_CLASS_COUNT];
+    uint32_t score;                         //Thousandths
+} autodetect_score_type;
+
+typedef struct{
+    register_table_type table;
+    uint32_t *addresses;                    //Sorted operation addresses
+    size_t addresses_size;
+    autodetect_score_type *scores;          //Per map
+} autodetect_worker_type;
+
+typedef struct{
+    table_spec_type *specs;
+    autodetect_map_type *maps;
+    uint32_t maps_count;
+    autodetect_worker_type *workers;
+} autodetect_type;
+
+typedef struct{
+    const parse_options_type *options;
+    autodetect_map_type *maps;
+    uint32_t maps_count;
+    uint32_t first;                         //Loads maps first, first+step, ...
+    uint32_t step;
+    pthread_t thread;
+    uint32_t started;                       //Thread was created and must be joined
+} autodetect_loader_type;
+
+
+/* Returns AUTODETECT_CLASS_* of register base name */
+static uint8_t autodetect_register_class(const char *name){
+    if(strstr(name, "RESERVED")){
+        return AUTODETECT_CLASS_RESERVED;
+    }
+    for(uint32_t i = 0; i < (sizeof(autodetect_known_blocks)/sizeof(autodetect_known_blocks[0])); i++){
+        if(strncmp(name, autodetect_known_blocks[i], strlen(autodetect_known_blocks[i])) == 0){
+            return AUTODETECT_CLASS_KNOWN;
+        }
+    }
+    return AUTODETECT_CLASS_MAPPED;
+}
+
+static void *autodetect_loader(void *arg){
+    autodetect_loader_type *loader = arg;
+    autodetect_map_type *map;
+
+    for(uint32_t i = loader->first; i < loader->maps_count; i += loader->step){
+        map = &loader->maps[i];
+        map->result = load_soc_registers(&map->soc, map->soc_type_index, map->csv_filename, loader->options, &map->error_line);
+        if(map->result != 0){
+            continue;
+        }
+        map->register_class = malloc(map->soc.registers_count + 1);
+        if(map->register_class == NULL){
+            free_soc(&map->soc);
+            map->result = ERROR_AUTODETECT_MALLOC_FAILED;
+            continue;
+        }
+        for(size_t j = 0; j < map->soc.registers_count; j++){
+            map->register_class[j] = autodetect_register_class(map->soc.registers[j].register_name);
+        }
+    }
+    return NULL;
+}
+
+/* Load maps on workers_count threads. Maps that fail to load keep their ERROR_* in result(printed to stderr with map file after loading) */
+static int autodetect_load_maps(const parse_options_type *options, autodetect_map_type *maps, uint32_t maps_count, uint32_t workers_count){
+    autodetect_loader_type *loaders = calloc(workers_count, sizeof(autodetect_loader_type));
+    if(loaders == NULL){
+        return ERROR_AUTODETECT_MALLOC_FAILED;
+    }
+    for(uint32_t i = 0; i < workers_count; i++){
+        loaders[i].options = options;
+        loaders[i].maps = maps;
+        loaders[i].maps_count = maps_count;
+        loaders[i].first = i;
+        loaders[i].step = workers_count;
+        loaders[i].started = (pthread_create(&loaders[i].thread, NULL, autodetect_loader, &loaders[i]) == 0);
+        if(!loaders[i].started){
+            autodetect_loader(&loaders[i]);  //Maps of this loader on calling thread
+        }
+    }
+    for(uint32_t i = 0; i < workers_count; i++){
+        if(loaders[i].started){
+            pthread_join(loaders[i].thread, NULL);
+        }
+    }
+    free(loaders);
+
+    for(uint32_t i = 0; i < maps_count; i++){
+        if(maps[i].result != 0){
+            fprintf(stderr, "%s: ", (maps[i].csv_filename ? maps[i].csv_filename : maps[i].name));
+            print_soc_error(maps[i].result, maps[i].error_line);
+        }
+    }
+    return 0;
+}
+
+/* SoC type name of CSV file(file name without directory and ".csv"). Returns malloc()ed name or NULL */
+static char *autodetect_csv_name(const char *path){
+    const char *name = strrchr(path, '/');
+    size_t length;
+
+    name = name ? (name + 1) : path;
+    length = strlen(name);
+    if((length > 4) && (strcmp(&name[length-4], ".csv") == 0)){
+        length -= 4;
+    }
+    return strndup(name, length);
+}
+
+/* Built in SoCs and CSV files of maps_directory. Returns 0 or ERROR_* (not printed) */
+static int autodetect_collect_maps(const char *maps_directory, batch_file_type **csv_files, uint32_t *csv_files_count, autodetect_map_type **maps_ptr, uint32_t *maps_count){
+    autodetect_map_type *maps;
+    uint32_t count = 0;
+    uint32_t j;
+    size_t length;
+    int result;
+
+    *maps_ptr = NULL;
+    *maps_count = 0;
+    *csv_files = NULL;
+    *csv_files_count = 0;
+    if(maps_directory){
+        result = batch_collect_files(maps_directory, csv_files, csv_files_count);
+        if(result != 0){
+            return result;
+        }
+    }
+    maps = calloc(((sizeof(soc_list)/sizeof(soc_type)) + *csv_files_count + 1), sizeof(autodetect_map_type));
+    if(maps == NULL){
+        return ERROR_AUTODETECT_MALLOC_FAILED;
+    }
+    *maps_ptr = maps;
+
+    for(uint32_t i = 0; i < *csv_files_count; i++){
+        length = strlen((*csv_files)[i].path);
+        if((length <= 4) || (strcmp(&(*csv_files)[i].path[length-4], ".csv") != 0)){
+            continue;
+        }
+        maps[count].name = autodetect_csv_name((*csv_files)[i].path);
+        if(maps[count].name == NULL){
+            return ERROR_AUTODETECT_MALLOC_FAILED;
+        }
+        maps[count].csv_filename = (*csv_files)[i].path;
+        maps[count].soc_type_index = SOC_TYPE_INDEX_CSV;
+        count++;
+        *maps_count = count;
+    }
+    for(uint32_t i = 0; i < (sizeof(soc_list)/sizeof(soc_type)); i++){
+        if((i == SOC_TYPE_INDEX_NONE) || (i == SOC_TYPE_INDEX_CSV)){
+            continue;
+        }
+        for(j = 0; j < count; j++){
+            if(maps[j].csv_filename && (strcmp(maps[j].name, soc_list[i].soc_type_parameter_str) == 0)){
+                break;                      //Overridden by CSV file
+            }
+        }
+        if(j < count){
+            continue;
+        }
+        maps[count].name = strdup(soc_list[i].soc_type_parameter_str);
+        if(maps[count].name == NULL){
+            return ERROR_AUTODETECT_MALLOC_FAILED;
+        }
+        maps[count].soc_type_index = i;
+        count++;
+        *maps_count = count;
+    }
+    return 0;
+}
+
+static int autodetect_address_compare(const void *a, const void *b){
+    uint32_t address_a = *(const uint32_t*)a;
+    uint32_t address_b = *(const uint32_t*)b;
+    return (address_a > address_b) - (address_a < address_b);
+}
+
+/* Best first. Equal scores keep map order */
+static int autodetect_score_compare(const void *a, const void *b){
+    const autodetect_score_type *score_a = a;
+    const autodetect_score_type *score_b = b;
+    if(score_a->score != score_b->score){
+        return (score_a->score < score_b->score) ? 1 : -1;
+    }
+    return (score_a->map_index > score_b->map_index) - (score_a->map_index < score_b->map_index);
+}
+
+/* Score table against one map. addresses are sorted */
+static void autodetect_score_map(const autodetect_map_type *map, const uint32_t *addresses, size_t addresses_count, autodetect_score_type *score){
+    uint32_t register_index_cache = 0;
+    int64_t points = 0;
+    int32_t register_index;
+    size_t rows;
+
+    memset(score->class_rows, 0, sizeof(score->class_rows));
+    score->score = 0;
+    if(map->result != 0){
+        return;
+    }
+    for(size_t i = 0; i < addresses_count; i += rows){
+        for(rows = 1; ((i + rows) < addresses_count) && (addresses[i + rows] == addresses[i]); rows++);
+        register_index = get_register_index(addresses[i], &map->soc.registers_index, &register_index_cache);
+        score->class_rows[(register_index >= 0) ? map->register_class[register_index] : AUTODETECT_CLASS_UNMAPPED] += rows;
+    }
+    for(uint32_t i = 0; i < AUTODETECT_CLASS_COUNT; i++){
+        points += autodetect_class_points[i] * (int64_t)score->class_rows[i];
+    }
+    if((points > 0) && addresses_count){
+        score->score = (points * 1000) / (2 * (int64_t)addresses_count);
+    }
+}
+
+void render_autodetect(output_buffer_type *output, const autodetect_type *autodetect, const autodetect_worker_type *worker, size_t operations_count, size_t top_count){
+    const autodetect_score_type *score;
+    const autodetect_map_type *map;
+    const char *confidence_str = "LOW";
+    const char *confidence_color_str = color_red_str;
+    uint32_t margin;
+
+    output_str(output, "Rows ");
+    output_dec(output, worker->table.count);
+    output_str(output, " - Operations ");
+    output_dec(output, operations_count);
+    output_str(output, " - Maps ");
+    output_dec(output, autodetect->maps_count);
+    output_char(output, '\n');
+
+    for(size_t i = 0; (i < autodetect->maps_count) && (i < top_count); i++){
+        score = &worker->scores[i];
+        map = &autodetect->maps[score->map_index];
+        output_color(output, color_blue_str);
+        output_str(output, "RANK ");
+        output_dec_padded(output, (i + 1), 2);
+        output_color(output, color_default_str);
+        output_char(output, ' ');
+        output_str_padded(output, map->name, 20);
+        if(map->result != 0){
+            output_color(output, color_red_str);
+            output_str(output, "(NOT LOADED)\n");
+            output_color(output, color_default_str);
+            continue;
+        }
+        output_color(output, color_green_str);
+        output_str(output, "SCORE: ");
+        output_color(output, color_default_str);
+        output_dec(output, (score->score / 10));
+        output_char(output, '.');
+        output_dec(output, (score->score % 10));
+        output_char(output, '%');
+        for(uint32_t j = 0; j < AUTODETECT_CLASS_COUNT; j++){
+            output_color(output, color_green_str);
+            output_str(output, autodetect_class_str[j]);
+            output_color(output, color_default_str);
+            output_dec(output, score->class_rows[j]);
+            output_char(output, ' ');
+            output_percent(output, score->class_rows[j], operations_count);
+        }
+        output_char(output, '\n');
+    }
+
+    /* Best match */
+    score = &worker->scores[0];
+    margin = score->score - ((autodetect->maps_count > 1) ? worker->scores[1].score : 0);
+    if((score->score >= AUTODETECT_HIGH_SCORE) && (margin >= AUTODETECT_HIGH_MARGIN)){
+        confidence_str = "HIGH";
+        confidence_color_str = color_green_str;
+    }
+    else if((score->score >= AUTODETECT_MEDIUM_SCORE) && (margin >= AUTODETECT_MEDIUM_MARGIN)){
+        confidence_str = "MEDIUM";
+        confidence_color_str = color_yellow_str;
+    }
+    output_str(output, "Best ");
+    output_str(output, autodetect->maps[score->map_index].name);
+    output_str(output, " - Score ");
+    output_dec(output, (score->score / 10));
+    output_char(output, '.');
+    output_dec(output, (score->score % 10));
+    output_str(output, "% - Margin ");
+    output_dec(output, (margin / 10));
+    output_char(output, '.');
+    output_dec(output, (margin % 10));
+    output_str(output, "% - Confidence ");
+    output_color(output, confidence_color_str);
+    output_str(output, confidence_str);
+    output_color(output, color_default_str);
+    output_char(output, '\n');
+}
+
+static int32_t batch_autodetect_file(batch_type *batch, batch_file_type *file, uint32_t worker_index){
+    autodetect_type *autodetect = batch->context;
+    autodetect_worker_type *worker = &autodetect->workers[worker_index];
+    uint32_t *temp_ptr;
+    size_t operations_count = 0;
+    int32_t result;
+
+    result = load_table_spec(&worker->table, &autodetect->specs[file - batch->files]);
+    if(result != 0){
+        return result;
+    }
+
+    /* Operation addresses, sorted once for all maps */
+    if(worker->table.count > worker->addresses_size){
+        temp_ptr = realloc(worker->addresses, (sizeof(uint32_t) * worker->table.count));
+        if(temp_ptr == NULL){
+            return ERROR_AUTODETECT_MALLOC_FAILED;
+        }
+        worker->addresses = temp_ptr;
+        worker->addresses_size = worker->table.count;
+    }
+    for(size_t i = 0; i < worker->table.count; i++){
+        if(worker->table.flags[i] & (ROW_FLAG_WRITE | ROW_FLAG_READ)){
+            worker->addresses[operations_count++] = worker->table.addr[i];
+        }
+    }
+    qsort(worker->addresses, operations_count, sizeof(uint32_t), autodetect_address_compare);
+
+    for(uint32_t i = 0; i < autodetect->maps_count; i++){
+        worker->scores[i].map_index = i;
+        autodetect_score_map(&autodetect->maps[i], worker->addresses, operations_count, &worker->scores[i]);
+    }
+    qsort(worker->scores, autodetect->maps_count, sizeof(autodetect_score_type), autodetect_score_compare);
+
+    render_autodetect(&file->output, autodetect, worker, operations_count, batch->options->timing_top_rows);
+    return 0;
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - "-autodetect"
+ argv[2..]  - tables
+ argv[n]    - optional parameters(first parameter starting with '-')
+ */
+
+int autodetect_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    autodetect_type autodetect;
+    batch_type batch;
+    batch_file_type *csv_files = NULL;
+    uint32_t csv_files_count = 0;
+    uint32_t workers_count = 0;
+    int argi;
+    int32_t result = 0;
+
+    memset(&autodetect, 0, sizeof(autodetect));
+    memset(&batch, 0, sizeof(batch));
+
+    /* Tables until optional parameters */
+    for(argi = 2; (argi < argc) && is_table_spec_parameter(argv[argi]); argi++);
+    batch.files_count = argi - 2;
+    if(batch.files_count == 0){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+
+    result = autodetect_collect_maps(options.maps_directory, &csv_files, &csv_files_count, &autodetect.maps, &autodetect.maps_count);
+    if((result == 0) && (autodetect.maps_count == 0)){
+        result = ERROR_NO_SOC_MAPS;
+    }
+    if(result != 0){
+        print_error_stderr(result);
+        goto autodetect_main_exit;
+    }
+    result = autodetect_load_maps(&options, autodetect.maps, autodetect.maps_count, batch_workers_count(&options, autodetect.maps_count));
+    if(result != 0){
+        print_error_stderr(result);
+        goto autodetect_main_exit;
+    }
+
+    workers_count = batch_workers_count(&options, batch.files_count);
+    batch.files = calloc(batch.files_count, sizeof(batch_file_type));
+    autodetect.specs = calloc(batch.files_count, sizeof(table_spec_type));
+    autodetect.workers = calloc(workers_count, sizeof(autodetect_worker_type));
+    if((batch.files == NULL) || (autodetect.specs == NULL) || (autodetect.workers == NULL)){
+        result = ERROR_AUTODETECT_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto autodetect_main_exit;
+    }
+    for(uint32_t i = 0; i < workers_count; i++){
+        autodetect.workers[i].scores = calloc(autodetect.maps_count, sizeof(autodetect_score_type));
+        if(autodetect.workers[i].scores == NULL){
+            result = ERROR_AUTODETECT_MALLOC_FAILED;
+            print_error_stderr(result);
+            goto autodetect_main_exit;
+        }
+    }
+    for(uint32_t i = 0; i < batch.files_count; i++){
+        batch.files[i].path = strdup(argv[2 + i]);          //Shown as given. Spec parsing splits argv
+        if(batch.files[i].path == NULL){
+            result = ERROR_AUTODETECT_MALLOC_FAILED;
+            print_error_stderr(result);
+            goto autodetect_main_exit;
+        }
+        result = parse_table_spec(argv[2 + i], &autodetect.specs[i]);
+        if(result != 0){
+            goto autodetect_main_exit;
+        }
+    }
+
+    batch.options = &options;
+    batch.process_file = batch_autodetect_file;
+    batch.context = &autodetect;
+    result = run_batch(&batch, workers_count);
+
+autodetect_main_exit:
+    if(autodetect.workers){
+        for(uint32_t i = 0; i < workers_count; i++){
+            free_register_table(&autodetect.workers[i].table);
+            free(autodetect.workers[i].addresses);
+            free(autodetect.workers[i].scores);
+        }
+    }
+    if(autodetect.maps){
+        for(uint32_t i = 0; i < autodetect.maps_count; i++){
+            if(autodetect.maps[i].result == 0){
+                free_soc(&autodetect.maps[i].soc);
+            }
+            free(autodetect.maps[i].register_class);
+            free(autodetect.maps[i].name);
+        }
+    }
+    if(batch.files){
+        for(uint32_t i = 0; i < batch.files_count; i++){
+            free(batch.files[i].path);
+        }
+    }
+    for(uint32_t i = 0; i < csv_files_count; i++){
+        free(csv_files[i].path);
+    }
+    free(csv_files);
+    free(batch.files);
+    free(autodetect.specs);
+    free(autodetect.workers);
+    free(autodetect.maps);
+    return result;
+}
+
+
+/* SIMILARITY CLUSTERS */
+
+/*
+ * -cluster groups tables with nearly the same setup(ie. same DDR/PLL sequence with a few different values) in near linear time.
+ * - Every row before the terminating null entry is shingled into two features: (region, offset, attr) and (region, offset, attr, value).
+ *   Region is the SoC map register name and offset is from its base. Attr carries the operation(write or read-poll) and its bit field.
+ *   Tables with the same sequence but different values still share half of their features.
+ * - MinHash signature of CLUSTER_MINHASH_COUNT hashes estimates Jaccard similarity of the feature sets.
+ * - LSH: signature is cut into CLUSTER_BANDS bands of CLUSTER_BAND_ROWS hashes. Tables with an equal band land in the same bucket and
+ *   are candidate pairs. Pair with similarity s is found with probability 1-(1-s^4)^16: 50% -> 64%, 70% -> 98%, 80% -> 99.9%.
+ * - In a bucket(sorted by band hash) table is compared to the next CLUSTER_BUCKET_NEIGHBORS tables only, so big buckets of equal
+ *   tables stay linear. Pairs with estimated similarity >= -threshold=N percent(default 80) join the same cluster(union-find).
+ * - Nearest neighbor is the most similar candidate pair of a table. Tables never bucketed together are not compared.
+ * - Signatures are computed on worker threads(-jobs=N). Input is a directory or a list file with one Table per line.
+ */
+
+#define CLUSTER_MINHASH_COUNT 64
+#define CLUSTER_BANDS 16
+#define CLUSTER_BAND_ROWS (CLUSTER_MINHASH_COUNT / CLUSTER_BANDS)
+#define CLUSTER_BUCKET_NEIGHBORS 8
+
+typedef struct{
+    uint64_t minhash[CLUSTER_MINHASH_COUNT];
+    uint32_t rows;                          //Rows before terminating null entry. 0 = not clustered
+    uint32_t nearest;                       //Most similar table. UINT32_MAX = none
+    uint32_t nearest_matches;               //Equal minhashes with nearest
+    uint32_t parent;                        //Union-find. Root is the lowest table index of the cluster
+    int32_t result;                         //ERROR_* of loading the table
+} cluster_table_type;
+
+typedef struct{
+    uint64_t key;                           //Band hash
+    uint32_t table;
+} cluster_bucket_entry_type;
+
+typedef struct{
+    uint32_t size;                          //Tables in cluster
+    uint32_t root;
+    uint32_t table;
+} cluster_order_type;
+
+typedef struct{
+    const soc_map_type *soc;
+    table_spec_type *specs;
+    cluster_table_type *tables;
+    uint32_t tables_count;
+} cluster_type;
+
+typedef struct{
+    cluster_type *cluster;
+    uint32_t first;
+    uint32_t end;
+    register_table_type table;
+    pthread_t thread;
+    uint32_t started;                       //Thread was created and must be joined
+} cluster_worker_type;
+
+
+static inline uint64_t cluster_mix64(uint64_t x){
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline void cluster_add_feature(cluster_table_type *entry, uint64_t feature){
+    uint64_t hash;
+    for(uint32_t k = 0; k < CLUSTER_MINHASH_COUNT; k++){
+        hash = cluster_mix64(feature ^ (0x9e3779b97f4a7c15ull * (k + 1)));
+        if(hash < entry->minhash[k]){
+            entry->minhash[k] = hash;
+        }
+    }
+}
+
+/* MinHash signature of decoded table */
+static void cluster_sign_table(const soc_map_type *soc, const register_table_type *table, cluster_table_type *entry){
+    const soc_register_type *soc_register;
+    uint32_t register_index_cache = 0;
+    uint64_t region;
+    uint64_t feature;
+
+    for(uint32_t k = 0; k < CLUSTER_MINHASH_COUNT; k++){
+        entry->minhash[k] = UINT64_MAX;
+    }
+    entry->rows = 0;
+    for(size_t i = 0; (i < table->count) && !(table->flags[i] & ROW_FLAG_TERMINATE); i++){
+        soc_register = soc_map_lookup(soc, table->addr[i], &register_index_cache);
+        region = hash_bytes64((const uint8_t*)soc_register->register_name, strlen(soc_register->register_name));
+        feature = cluster_mix64(cluster_mix64(region ^ (table->addr[i] - soc_register->base_address)) ^ table->attr[i]);
+        cluster_add_feature(entry, feature);
+        cluster_add_feature(entry, cluster_mix64(feature ^ table->value[i] ^ 0x5bd1e9955bd1e995ull));
+        entry->rows++;
+    }
+}
+
+static void *cluster_worker(void *arg){
+    cluster_worker_type *worker = arg;
+    cluster_type *cluster = worker->cluster;
+    for(uint32_t i = worker->first; i < worker->end; i++){
+        if(cluster->tables[i].result != 0){
+            continue;                       //Bad table spec
+        }
+        cluster->tables[i].result = load_table_spec(&worker->table, &cluster->specs[i]);
+        if(cluster->tables[i].result == 0){
+            cluster_sign_table(cluster->soc, &worker->table, &cluster->tables[i]);
+        }
+    }
+    return NULL;
+}
+
+static uint32_t cluster_matches(const cluster_table_type *a, const cluster_table_type *b){
+    uint32_t matches = 0;
+    for(uint32_t k = 0; k < CLUSTER_MINHASH_COUNT; k++){
+        matches += (a->minhash[k] == b->minhash[k]);
+    }
+    return matches;
+}
+
+static uint32_t cluster_find(cluster_table_type *tables, uint32_t table){
+    while(tables[table].parent != table){
+        tables[table].parent = tables[tables[table].parent].parent;     //Path halving
+        table = tables[table].parent;
+    }
+    return table;
+}
+
+/* Nearest neighbor. Ties go to the lower table index so result doesn't depend on bucket order */
+static void cluster_update_nearest(cluster_table_type *tables, uint32_t table, uint32_t other, uint32_t matches){
+    cluster_table_type *entry = &tables[table];
+    if((entry->nearest == UINT32_MAX) || (matches > entry->nearest_matches) || ((matches == entry->nearest_matches) && (other < entry->nearest))){
+        entry->nearest = other;
+        entry->nearest_matches = matches;
+    }
+}
+
+static int cluster_bucket_compare(const void *a, const void *b){
+    const cluster_bucket_entry_type *ea = a;
+    const cluster_bucket_entry_type *eb = b;
+    if(ea->key != eb->key){
+        return (ea->key < eb->key) ? -1 : 1;
+    }
+    return (ea->table > eb->table) - (ea->table < eb->table);
+}
 
-int main(int argc, char **argv){
-    uint32_t temp = 0;
-    uint32_t temp2;
-    int32_t itemp = 0;
-    
-    uint32_t bytes_offset = 0;
-    uint32_t bytes_count_or_end = 0;
-    
-#define DATA_ROW_SIZE (4*4)
-    uint8_t data_row[DATA_ROW_SIZE];    //Read one "row" 4*4bytes = 16bytes at time
-    
-    uint32_t addr;
-    uint32_t value;
-    uint32_t delay;
+static int cluster_order_compare(const void *a, const void *b){
+    const cluster_order_type *oa = a;
+    const cluster_order_type *ob = b;
+    if(oa->size != ob->size){
+        return (oa->size > ob->size) ? -1 : 1;      //Biggest cluster first
+    }
+    if(oa->root != ob->root){
+        return (oa->root > ob->root) - (oa->root < ob->root);
+    }
+    return (oa->table > ob->table) - (oa->table < ob->table);
+}
+
+/* LSH buckets, candidate pairs and clusters. Returns 0 or -1 if malloc fails */
+int cluster_tables(cluster_table_type *tables, uint32_t tables_count, uint32_t threshold){
+    cluster_bucket_entry_type *entries = malloc(sizeof(cluster_bucket_entry_type) * (tables_count + 1));
+    uint32_t entries_count;
+    uint32_t matches;
+    uint32_t a;
+    uint32_t b;
+    uint64_t key;
+
+    if(entries == NULL){
+        return -1;
+    }
+    for(uint32_t i = 0; i < tables_count; i++){
+        tables[i].parent = i;
+        tables[i].nearest = UINT32_MAX;
+        tables[i].nearest_matches = 0;
+    }
+
+    for(uint32_t band = 0; band < CLUSTER_BANDS; band++){
+        entries_count = 0;
+        for(uint32_t i = 0; i < tables_count; i++){
+            if((tables[i].result != 0) || (tables[i].rows == 0)){
+                continue;
+            }
+            key = band;
+            for(uint32_t k = (band * CLUSTER_BAND_ROWS); k < ((band + 1) * CLUSTER_BAND_ROWS); k++){
+                key = cluster_mix64(key ^ tables[i].minhash[k]);
+            }
+            entries[entries_count].key = key;
+            entries[entries_count].table = i;
+            entries_count++;
+        }
+        qsort(entries, entries_count, sizeof(cluster_bucket_entry_type), cluster_bucket_compare);
+
+        for(uint32_t i = 0; i < entries_count; i++){
+            for(uint32_t j = i + 1; (j < entries_count) && (j <= (i + CLUSTER_BUCKET_NEIGHBORS)) && (entries[j].key == entries[i].key); j++){
+                matches = cluster_matches(&tables[entries[i].table], &tables[entries[j].table]);
+                cluster_update_nearest(tables, entries[i].table, entries[j].table, matches);
+                cluster_update_nearest(tables, entries[j].table, entries[i].table, matches);
+                if((matches * 100) >= (threshold * CLUSTER_MINHASH_COUNT)){
+                    a = cluster_find(tables, entries[i].table);
+                    b = cluster_find(tables, entries[j].table);
+                    if(a < b){
+                        tables[b].parent = a;
+                    }
+                    else if(b < a){
+                        tables[a].parent = b;
+                    }
+                }
+            }
+        }
+    }
+    free(entries);
+    return 0;
+}
+
+static void render_cluster_member(output_buffer_type *output, const batch_file_type *files, const cluster_table_type *tables, uint32_t table){
+    output_str(output, "  ");
+    output_str(output, files[table].path);
+    output_color(output, color_green_str);
+    output_str(output, " - Rows ");
+    output_color(output, color_default_str);
+    output_dec(output, tables[table].rows);
+    output_color(output, color_green_str);
+    output_str(output, " - Nearest: ");
+    output_color(output, color_default_str);
+    if(tables[table].nearest == UINT32_MAX){
+        output_str(output, "none\n");
+        return;
+    }
+    output_str(output, files[tables[table].nearest].path);
+    output_str(output, " (");
+    output_dec(output, ((tables[table].nearest_matches * 100) / CLUSTER_MINHASH_COUNT));
+    output_str(output, "%)\n");
+}
+
+/*
+ argv[0]    - command
+ argv[1]    - "-cluster"
+ argv[2]    - input directory or list file of tables
+ argv[3]    - soc type
+ argv[4]    - csv file(if soc type is csv)
+ argv[>=4]  - optional parameters
+ */
+
+int cluster_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    cluster_type cluster;
+    cluster_worker_type *workers = NULL;
+    cluster_order_type *order = NULL;
+    batch_file_type *files = NULL;
+    char **spec_strings = NULL;
+    uint32_t files_count = 0;
+    uint32_t workers_count = 0;
+    uint32_t clusters_count = 0;
+    uint32_t clustered_count = 0;
+    uint32_t *sizes = NULL;
+    output_buffer_type output;
+    soc_map_type soc;
+    int32_t soc_type_index;
+    int32_t result = 0;
+    int argi = 4;
+    uint32_t i;
+
+    memset(&cluster, 0, sizeof(cluster));
+    if(argc < 4){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+    soc_type_index = find_soc_type(argv[3]);
+    if(soc_type_index < 0){
+        print_error_stderr(ERROR_UNKNOWN_SOC_TYPE);
+        return ERROR_UNKNOWN_SOC_TYPE;
+    }
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        if(argc < 5){
+            print_error_stderr(ERROR_PARAMETER_COUNT);
+            return ERROR_PARAMETER_COUNT;
+        }
+        argi++;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+
+    result = batch_collect_files(argv[2], &files, &files_count);
+    if(result != 0){
+        print_error_stderr(result);
+        return result;
+    }
+    result = load_soc(&soc, soc_type_index, ((soc_type_index == SOC_TYPE_INDEX_CSV) ? argv[4] : NULL), &options);
+    if(result != 0){
+        goto cluster_main_exit;
+    }
+
+    workers_count = batch_workers_count(&options, files_count);
+    cluster.soc = &soc;
+    cluster.tables_count = files_count;
+    cluster.tables = calloc((files_count + 1), sizeof(cluster_table_type));
+    cluster.specs = calloc((files_count + 1), sizeof(table_spec_type));
+    spec_strings = calloc((files_count + 1), sizeof(char*));
+    workers = calloc(workers_count, sizeof(cluster_worker_type));
+    order = malloc(sizeof(cluster_order_type) * (files_count + 1));
+    sizes = calloc((files_count + 1), sizeof(uint32_t));
+    if((cluster.tables == NULL) || (cluster.specs == NULL) || (spec_strings == NULL) || (workers == NULL) || (order == NULL) || (sizes == NULL)){
+        result = ERROR_CLUSTER_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto cluster_main_free;
+    }
+
+    /* Table specs. Paths are shown as given, spec parsing splits a copy */
+    for(i = 0; i < files_count; i++){
+        spec_strings[i] = strdup(files[i].path);
+        if(spec_strings[i] == NULL){
+            result = ERROR_CLUSTER_MALLOC_FAILED;
+            print_error_stderr(result);
+            goto cluster_main_free;
+        }
+        cluster.tables[i].result = parse_table_spec(spec_strings[i], &cluster.specs[i]);
+    }
+
+    /* Signatures. Static partition, tables are about the same size */
+    for(i = 0; i < workers_count; i++){
+        workers[i].cluster = &cluster;
+        workers[i].first = (uint32_t)(((uint64_t)files_count * i) / workers_count);
+        workers[i].end = (uint32_t)(((uint64_t)files_count * (i + 1)) / workers_count);
+        workers[i].started = (pthread_create(&workers[i].thread, NULL, cluster_worker, &workers[i]) == 0);
+        if(!workers[i].started){
+            cluster_worker(&workers[i]);    //Tables of this worker on calling thread
+        }
+    }
+    for(i = 0; i < workers_count; i++){
+        if(workers[i].started){
+            pthread_join(workers[i].thread, NULL);
+        }
+        free_register_table(&workers[i].table);
+    }
+    for(i = 0; i < files_count; i++){
+        if((cluster.tables[i].result != 0) && (cluster.tables[i].result != ERROR_BYTES_OFFSET_PARAMETER) && (cluster.tables[i].result != ERROR_BYTES_COUNT_PARAMETER)){
+            fprintf(stderr, "%s: ", files[i].path);             //Spec errors are printed by parse_table_spec()
+            print_error_stderr(cluster.tables[i].result);
+        }
+        if(cluster.tables[i].result != 0){
+            result = cluster.tables[i].result;              //Table is listed unclustered
+        }
+    }
+
+    if(cluster_tables(cluster.tables, files_count, options.cluster_threshold) != 0){
+        result = ERROR_CLUSTER_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto cluster_main_free;
+    }
+
+    /* Clusters biggest first, members in input order. Single tables are listed last as unclustered */
+    for(i = 0; i < files_count; i++){
+        sizes[cluster_find(cluster.tables, i)]++;
+    }
+    for(i = 0; i < files_count; i++){
+        order[i].root = cluster_find(cluster.tables, i);
+        order[i].size = (sizes[order[i].root] > 1) ? sizes[order[i].root] : 0;
+        order[i].table = i;
+        if(order[i].size){
+            clustered_count++;
+            clusters_count += (order[i].root == i);
+        }
+    }
+    qsort(order, files_count, sizeof(cluster_order_type), cluster_order_compare);
+
+    if(output_open(&output, STDOUT_FILENO, options.color_enabled) != 0){
+        result = ERROR_OUTPUT_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto cluster_main_free;
+    }
+    output_str(&output, "Tables ");
+    output_dec(&output, files_count);
+    output_str(&output, " - Clusters ");
+    output_dec(&output, clusters_count);
+    output_str(&output, " - Clustered tables ");
+    output_dec(&output, clustered_count);
+    output_str(&output, " - Threshold ");
+    output_dec(&output, options.cluster_threshold);
+    output_str(&output, "%\n");
+    clusters_count = 0;
+    for(i = 0; i < files_count; i++){
+        if((i == 0) || (order[i].root != order[i-1].root) || (order[i].size != order[i-1].size)){
+            if(order[i].size){
+                output_color(&output, color_blue_str);
+                output_str(&output, "CLUSTER ");
+                output_dec(&output, ++clusters_count);
+                output_color(&output, color_default_str);
+                output_str(&output, " - Tables ");
+                output_dec(&output, order[i].size);
+                output_char(&output, '\n');
+            }
+            else if((i == 0) || order[i-1].size){
+                output_color(&output, color_yellow_str);
+                output_str(&output, "UNCLUSTERED");
+                output_color(&output, color_default_str);
+                output_str(&output, " - Tables ");
+                output_dec(&output, (files_count - clustered_count));
+                output_char(&output, '\n');
+            }
+        }
+        render_cluster_member(&output, files, cluster.tables, order[i].table);
+    }
+    output_close(&output);
+
+cluster_main_free:
+    if(spec_strings){
+        for(i = 0; i < files_count; i++){
+            free(spec_strings[i]);
+        }
+    }
+    free(spec_strings);
+    free(cluster.tables);
+    free(cluster.specs);
+    free(workers);
+    free(order);
+    free(sizes);
+    free_soc(&soc);
+
+cluster_main_exit:
+    for(i = 0; i < files_count; i++){
+        free(files[i].path);
+    }
+    free(files);
+    return result;
+}
+
+
+/* FINGERPRINT */
+
+/*
+ * -fingerprint prints fingerprint(see FINGERPRINT INDEX) of every table. With -index=IndexFile tables are looked up in the index
+ * and new ones are added with -label=Name(default source file name), so later -batch and -scan runs recognize them.
+ */
+
+/* Fingerprint of table spec. Returns 0 or ERROR_* (not printed) */
+static int fingerprint_table_spec(const table_spec_type *spec, uint64_t *offset, uint64_t *hash, uint32_t *rows){
+    input_file_type input;
+    const uint8_t *data;
+    uint64_t end = spec->bytes_offset + spec->bytes_count;
+    int result = 0;
+
+    *offset = spec->bytes_offset;
+    *rows = 0;
+    result = input_open_file(&input, spec->path);
+    if(result != 0){
+        return result;
+    }
+    if(spec->whole_file){
+        *offset = 0;
+        end = input.file_size - (input.file_size % DATA_ROW_SIZE);
+    }
+    if(input.file_size < end){
+        result = ERROR_RANGE_EXCEEDS_FILE;
+    }
+    else if(end > *offset){
+        if((input_map_range(&input, *offset, end) != 0) || ((data = input_get_range(&input, *offset, (size_t)(end - *offset))) == NULL)){
+            result = ERROR_READ_FILE_ERROR;
+        }
+        else{
+            *hash = fingerprint_rows(data, (end - *offset), rows);
+        }
+    }
+    input_close(&input);
+    return result;
+}
+
+/*
+ argv[0]    - command
+ argv[1]    - "-fingerprint"
+ argv[2..]  - tables
+ argv[>=3]  - optional parameters
+ */
+
+int fingerprint_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    fingerprint_index_type fingerprints;
+    fingerprint_entry_type known;
+    output_buffer_type output;
+    table_spec_type spec;
+    uint64_t offset;
+    uint64_t hash = 0;
+    uint32_t rows;
+    uint32_t tables_count;
+    int argi;
+    int32_t result = 0;
+    int32_t itemp;
+
+    /* Tables until optional parameters */
+    for(argi = 2; (argi < argc) && is_table_spec_parameter(argv[argi]); argi++);
+    tables_count = argi - 2;
+    if(tables_count == 0){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+    if(options.fingerprint_index_filename){
+        result = load_fingerprint_index(&fingerprints, options.fingerprint_index_filename);
+        if(result != 0){
+            print_error_stderr(result);
+            return result;
+        }
+    }
+    if(output_open(&output, STDOUT_FILENO, options.color_enabled) != 0){
+        if(options.fingerprint_index_filename){
+            free_fingerprint_index(&fingerprints);
+        }
+        print_error_stderr(ERROR_OUTPUT_MALLOC_FAILED);
+        return ERROR_OUTPUT_MALLOC_FAILED;
+    }
+
+    for(uint32_t i = 0; i < tables_count; i++){
+        output_str(&output, argv[2 + i]);                   //Shown as given. Spec parsing splits argv
+        itemp = parse_table_spec(argv[2 + i], &spec);
+        if(itemp == 0){
+            itemp = fingerprint_table_spec(&spec, &offset, &hash, &rows);
+        }
+        if(itemp != 0){
+            output_char(&output, '\n');
+            output_flush(&output);                          //Keep stdout and stderr in order
+            print_error_stderr(itemp);
+            result = itemp;
+            continue;
+        }
+
+        output_color(&output, color_green_str);
+        output_str(&output, " - Rows ");
+        output_color(&output, color_default_str);
+        output_dec(&output, rows);
+        output_str(&output, " - ");
+        if(rows == 0){
+            output_str(&output, "Empty table\n");           //Not fingerprinted
+            continue;
+        }
+        itemp = 0;
+        if(options.fingerprint_index_filename){
+            itemp = fingerprint_index_add(&fingerprints, hash, rows, spec.path, offset, options.fingerprint_label, &known);
+            if(itemp < 0){
+                output_char(&output, '\n');
+                output_flush(&output);
+                result = ERROR_FINGERPRINT_MALLOC_FAILED;
+                print_error_stderr(result);
+                break;
+            }
+        }
+        if(itemp){
+            render_known_table(&output, &known);
+            continue;
+        }
+        if(options.fingerprint_index_filename){
+            output_color(&output, color_yellow_str);
+            output_str(&output, "New table ");
+            output_color(&output, color_default_str);
+            output_str(&output, options.fingerprint_label ? options.fingerprint_label : (strrchr(spec.path, '/') ? (strrchr(spec.path, '/') + 1) : spec.path));
+            output_str(&output, " - ");
+        }
+        output_color(&output, color_green_str);
+        output_str(&output, "Fingerprint ");
+        output_color(&output, color_default_str);
+        output_hex64(&output, hash);
+        output_char(&output, '\n');
+    }
+    output_close(&output);
+
+    if(options.fingerprint_index_filename){
+        if(fingerprint_index_added(&fingerprints)){
+            itemp = save_fingerprint_index(&fingerprints);
+            if(itemp != 0){
+                print_error_stderr(itemp);
+                result = itemp;
+            }
+        }
+        free_fingerprint_index(&fingerprints);
+    }
+    return result;
+}
+
+
+/* ACCESS INDEX */
+
+/*
+ * -accessindex records every register access(write or read-poll row before the terminating null entry) of many images into an index file:
+ * for each key (SoC map region, offset in region) a postings list of (image, table, row, attr, value). -query answers address,
+ * address range and region(+offset) queries from the mmap()ed index without decoding any image again.
+ * - Keys are sorted by address(region base + offset), so address and range queries are binary searches and a region is a key range.
+ * - Postings of a key are sorted by table and row and delta encoded as LEB128 varints: table delta, row(delta within table), attr, value.
+ *   Table number is global and gives image and table offset through the table array.
+ * - Index file is native endian and tied to ACCESS_INDEX_FILE_VERSION. It is written to a temporary file and renamed.
+ * - Images are decoded on worker threads(-jobs=N). Input is a directory or list file like with -batch, tables by range or "scan".
+ */
+
+#define ACCESS_INDEX_FILE_MAGIC "HIRTACX"
+#define ACCESS_INDEX_FILE_VERSION 1
+#define ACCESS_INDEX_FILE_BYTE_ORDER 0x01020304
+
+typedef struct{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;                    //ACCESS_INDEX_FILE_BYTE_ORDER in host order
+    uint32_t images_count;
+    uint32_t tables_count;
+    uint32_t regions_count;
+    uint32_t keys_count;
+    uint64_t postings_size;
+    uint64_t strings_size;
+} access_index_header_type;
+
+/* Followed by image path offsets(uint32_t, padded to even count), tables, regions, keys, postings and strings */
+typedef struct{
+    uint32_t image;
+    uint32_t rows;                          //Rows before terminating null entry
+    uint64_t offset;                        //Table offset in image
+} access_index_table_type;
+
+typedef struct{
+    uint32_t base_address;
+    uint32_t end_address;
+    uint32_t name_offset;                   //Offset in strings
+    uint32_t reserved;
+} access_index_region_type;
+
+typedef struct{
+    uint32_t address;
+    uint32_t region;
+    uint64_t postings_offset;               //Offset in postings
+    uint32_t postings_count;
+    uint32_t reserved;
+} access_index_key_type;
+
+/* Access found while building */
+typedef struct{
+    uint32_t address;
+    uint32_t region;                        //SoC register index while decoding, region number when sorted. registers_count = unmapped
+    uint32_t table;                         //Table of image while decoding, global table number when sorted
+    uint32_t row;
     uint32_t attr;
-    
-    int32_t write_flag;
-    int32_t read_flag;
-    
-    uint32_t write_no_bits;
-    uint32_t write_start_bit;
-    
-    uint32_t read_no_bits;
-    uint32_t read_start_bit;
-    
-    uint32_t range_8_10;
-    uint32_t range_24_26;
-    
-    uint32_t selected_soc_type_index = 0;                   //Index in soc_list
-    uint32_t closest_register_index;                        //Index in soc_list[selected_soc_type_index].soc_type_registers[]
-    
-    if(argc < NUMBER_OF_FIXED_PARAMETERS_INCL_CMDNAME){     //argc check
-        print_error_stderr(ERROR_PARAMETER_COUNT);                 //Return usage to stderr
+    uint32_t value;
+} access_record_type;
+
+typedef struct{
+    access_record_type *records;
+    size_t records_count;
+    size_t records_size;
+    access_index_table_type *tables;
+    uint32_t tables_count;
+    uint32_t tables_size;
+    int32_t result;
+} access_image_type;
+
+typedef struct{
+    const soc_map_type *soc;
+    batch_file_type *files;
+    access_image_type *images;
+    uint32_t images_count;
+    uint32_t scan;
+    uint64_t bytes_offset;
+    uint64_t bytes_count;
+} access_build_type;
+
+typedef struct{
+    access_build_type *build;
+    uint32_t first;
+    uint32_t end;
+    register_table_type table;
+    pthread_t thread;
+    uint32_t started;                       //Thread was created and must be joined
+} access_worker_type;
+
+/* Loaded index file */
+typedef struct{
+    uint8_t *file_ptr;
+    size_t file_length;
+    const access_index_header_type *header;
+    const uint32_t *image_paths;
+    const access_index_table_type *tables;
+    const access_index_region_type *regions;
+    const access_index_key_type *keys;
+    const uint8_t *postings;
+    const char *strings;
+} access_index_type;
+
+
+static inline void output_varint(output_buffer_type *output, uint64_t value){
+    char *ptr = output_reserve(output, 10);
+    size_t length = 0;
+    while(value >= 0x80){
+        ptr[length++] = (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    ptr[length++] = (char)value;
+    output->length += length;
+}
+
+/* Returns pointer after varint or NULL if it runs past end */
+static inline const uint8_t *get_varint(const uint8_t *ptr, const uint8_t *end, uint64_t *value){
+    uint32_t shift = 0;
+    *value = 0;
+    while((ptr < end) && (shift < 64)){
+        *value |= (uint64_t)(*ptr & 0x7f) << shift;
+        if(!(*ptr++ & 0x80)){
+            return ptr;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+/* Register accesses of [offset, end) of input as next table of image. Returns 0 or ERROR_* (not printed) */
+static int32_t access_add_table(const soc_map_type *soc, access_image_type *image, register_table_type *table, input_file_type *input, uint64_t offset, uint64_t end){
+    const soc_register_type *soc_register;
+    access_index_table_type *temp_tables;
+    access_record_type *temp_records;
+    uint32_t register_index_cache = 0;
+    const uint8_t *data;
+    size_t i;
+
+    if(input->file_size < end){
+        return ERROR_RANGE_EXCEEDS_FILE;
+    }
+    if((input_map_range(input, offset, end) != 0) || ((data = input_get_range(input, offset, (size_t)(end - offset))) == NULL)){
+        return ERROR_READ_FILE_ERROR;
+    }
+    if(decode_register_table(table, data, (size_t)(end - offset)) != 0){
+        return ERROR_TABLE_MALLOC_FAILED;
+    }
+    if(image->tables_count == image->tables_size){
+        image->tables_size = image->tables_size ? (image->tables_size * 2) : 4;
+        temp_tables = realloc(image->tables, (sizeof(access_index_table_type) * image->tables_size));
+        if(temp_tables == NULL){
+            return ERROR_TABLE_MALLOC_FAILED;
+        }
+        image->tables = temp_tables;
+    }
+
+    for(i = 0; (i < table->count) && !(table->flags[i] & ROW_FLAG_TERMINATE); i++){
+        if(!(table->flags[i] & (ROW_FLAG_WRITE | ROW_FLAG_READ))){
+            continue;                       //Delay only or invalid row
+        }
+        if(image->records_count == image->records_size){
+            image->records_size = image->records_size ? (image->records_size * 2) : 256;
+            temp_records = realloc(image->records, (sizeof(access_record_type) * image->records_size));
+            if(temp_records == NULL){
+                return ERROR_TABLE_MALLOC_FAILED;
+            }
+            image->records = temp_records;
+        }
+        soc_register = soc_map_lookup(soc, table->addr[i], &register_index_cache);
+        image->records[image->records_count].address = table->addr[i];
+        image->records[image->records_count].region = (soc_register == &unmapped_register) ? (uint32_t)soc->registers_count : (uint32_t)(soc_register - soc->registers);
+        image->records[image->records_count].table = image->tables_count;
+        image->records[image->records_count].row = (uint32_t)i;
+        image->records[image->records_count].attr = table->attr[i];
+        image->records[image->records_count].value = table->value[i];
+        image->records_count++;
+    }
+    image->tables[image->tables_count].rows = (uint32_t)i;
+    image->tables[image->tables_count].offset = offset;
+    image->tables_count++;
+    return 0;
+}
+
+static void *access_worker(void *arg){
+    access_worker_type *worker = arg;
+    access_build_type *build = worker->build;
+    scan_candidate_list_type candidates;
+    access_image_type *image;
+    input_file_type input;
+
+    for(uint32_t i = worker->first; i < worker->end; i++){
+        image = &build->images[i];
+        image->result = input_open_file(&input, build->files[i].path);
+        if(image->result != 0){
+            continue;
+        }
+        if(!build->scan){
+            image->result = access_add_table(build->soc, image, &worker->table, &input, build->bytes_offset, (build->bytes_offset + build->bytes_count));
+        }
+        else if(input.file_size){
+            image->result = search_input(&input, scan_image, scan_candidate_compare, &candidates);
+            if(image->result == 0){         //Candidates are freed by search_input() on error
+                for(size_t j = 0; (image->result == 0) && (j < candidates.count); j++){
+                    image->result = access_add_table(build->soc, image, &worker->table, &input, candidates.candidates[j].offset, (candidates.candidates[j].offset + candidates.candidates[j].length));
+                }
+                free(candidates.candidates);
+            }
+        }
+        input_close(&input);
+    }
+    return NULL;
+}
+
+static int access_record_compare(const void *a, const void *b){
+    const access_record_type *ra = a;
+    const access_record_type *rb = b;
+    if(ra->address != rb->address){
+        return (ra->address < rb->address) ? -1 : 1;
+    }
+    if(ra->region != rb->region){
+        return (ra->region < rb->region) ? -1 : 1;
+    }
+    if(ra->table != rb->table){
+        return (ra->table < rb->table) ? -1 : 1;
+    }
+    return (ra->row > rb->row) - (ra->row < rb->row);
+}
+
+/* Merge accesses of images(in input order), sort and write index file. Returns 0 or ERROR_* (not printed) */
+static int32_t access_index_save(const access_build_type *build, const char *path){
+    access_index_header_type header;
+    access_index_table_type *tables = NULL;
+    access_index_region_type *regions = NULL;
+    access_index_key_type *keys = NULL;
+    access_record_type *records = NULL;
+    uint32_t *image_paths = NULL;
+    uint32_t *region_numbers = NULL;
+    output_buffer_type postings;
+    output_buffer_type strings;
+    output_buffer_type output;
+    size_t records_count = 0;
+    uint32_t tables_count = 0;
+    uint32_t regions_count = 0;
+    uint32_t keys_count = 0;
+    uint32_t image_paths_count = (build->images_count + 1) & ~1u;     //Keeps following arrays 8 byte aligned
+    uint32_t prev_table = 0;
+    uint32_t prev_row = 0;
+    size_t records_index = 0;
+    char *temp_path;
+    int32_t result = ERROR_TABLE_MALLOC_FAILED;
+    int fd;
+
+    postings.buffer = NULL;
+    strings.buffer = NULL;
+    for(uint32_t i = 0; i < build->images_count; i++){
+        records_count += build->images[i].records_count;
+        tables_count += build->images[i].tables_count;
+    }
+    temp_path = malloc(strlen(path) + 16);
+    image_paths = calloc((image_paths_count + 1), sizeof(uint32_t));
+    tables = malloc(sizeof(access_index_table_type) * (tables_count + 1));
+    records = malloc(sizeof(access_record_type) * (records_count + 1));
+    keys = malloc(sizeof(access_index_key_type) * (records_count + 1));
+    regions = malloc(sizeof(access_index_region_type) * (build->soc->registers_count + 1));
+    region_numbers = malloc(sizeof(uint32_t) * (build->soc->registers_count + 1));
+    if((temp_path == NULL) || (image_paths == NULL) || (tables == NULL) || (records == NULL) || (keys == NULL) || (regions == NULL) || (region_numbers == NULL) ||
+       (output_open(&postings, OUTPUT_FD_MEMORY, 0) != 0) || (output_open(&strings, OUTPUT_FD_MEMORY, 0) != 0)){
+        goto access_index_save_exit;
+    }
+
+    /* Global table numbers in input order */
+    tables_count = 0;
+    for(uint32_t i = 0; i < build->images_count; i++){
+        image_paths[i] = strings.length;
+        output_data(&strings, build->files[i].path, (strlen(build->files[i].path) + 1));
+        for(size_t j = 0; j < build->images[i].records_count; j++){
+            records[records_index] = build->images[i].records[j];
+            records[records_index].table += tables_count;
+            records_index++;
+        }
+        for(uint32_t j = 0; j < build->images[i].tables_count; j++){
+            tables[tables_count] = build->images[i].tables[j];
+            tables[tables_count].image = i;
+            tables_count++;
+        }
+    }
+
+    /* Regions that have accesses. Numbered in SoC map order(by base address), unmapped last */
+    memset(region_numbers, 0xff, (sizeof(uint32_t) * (build->soc->registers_count + 1)));
+    for(size_t i = 0; i < records_count; i++){
+        region_numbers[records[i].region] = 0;
+    }
+    for(size_t i = 0; i <= build->soc->registers_count; i++){
+        const soc_register_type *soc_register = (i < build->soc->registers_count) ? &build->soc->registers[i] : &unmapped_register;
+        if(region_numbers[i] == UINT32_MAX){
+            continue;
+        }
+        region_numbers[i] = regions_count;
+        regions[regions_count].base_address = soc_register->base_address;
+        regions[regions_count].end_address = soc_register->end_address;
+        regions[regions_count].name_offset = strings.length;
+        regions[regions_count].reserved = 0;
+        output_data(&strings, soc_register->register_name, (strlen(soc_register->register_name) + 1));
+        regions_count++;
+    }
+    for(size_t i = 0; i < records_count; i++){
+        records[i].region = region_numbers[records[i].region];
+    }
+    qsort(records, records_count, sizeof(access_record_type), access_record_compare);
+
+    /* Keys and delta encoded postings */
+    for(size_t i = 0; i < records_count; i++){
+        if((i == 0) || (records[i].address != records[i-1].address) || (records[i].region != records[i-1].region)){
+            keys[keys_count].address = records[i].address;
+            keys[keys_count].region = records[i].region;
+            keys[keys_count].postings_offset = postings.length;
+            keys[keys_count].postings_count = 0;
+            keys[keys_count].reserved = 0;
+            keys_count++;
+            prev_table = 0;
+            prev_row = 0;
+        }
+        if(records[i].table != prev_table){
+            prev_row = 0;
+        }
+        output_varint(&postings, (records[i].table - prev_table));
+        output_varint(&postings, (records[i].row - prev_row));
+        output_varint(&postings, records[i].attr);
+        output_varint(&postings, records[i].value);
+        prev_table = records[i].table;
+        prev_row = records[i].row;
+        keys[keys_count-1].postings_count++;
+    }
+    if(postings.error || strings.error){
+        goto access_index_save_exit;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ACCESS_INDEX_FILE_MAGIC, sizeof(ACCESS_INDEX_FILE_MAGIC));
+    header.version = ACCESS_INDEX_FILE_VERSION;
+    header.byte_order = ACCESS_INDEX_FILE_BYTE_ORDER;
+    header.images_count = build->images_count;
+    header.tables_count = tables_count;
+    header.regions_count = regions_count;
+    header.keys_count = keys_count;
+    header.postings_size = postings.length;
+    header.strings_size = strings.length;
+
+    result = ERROR_OPEN_OUTPUT_FILE;
+    sprintf(temp_path, "%s.%d", path, (int)getpid());
+    fd = open(temp_path, (O_WRONLY | O_CREAT | O_TRUNC), 0644);
+    if((fd >= 0) && (output_open(&output, fd, 0) == 0)){
+        output_data(&output, (const char*)&header, sizeof(header));
+        output_data(&output, (const char*)image_paths, (sizeof(uint32_t) * image_paths_count));
+        output_data(&output, (const char*)tables, (sizeof(access_index_table_type) * tables_count));
+        output_data(&output, (const char*)regions, (sizeof(access_index_region_type) * regions_count));
+        output_data(&output, (const char*)keys, (sizeof(access_index_key_type) * keys_count));
+        output_data(&output, postings.buffer, postings.length);
+        output_data(&output, strings.buffer, strings.length);
+        output_close(&output);
+        if((close(fd) != 0) || output.error || (rename(temp_path, path) != 0)){
+            unlink(temp_path);
+        }
+        else{
+            result = 0;
+        }
+    }
+    else if(fd >= 0){
+        close(fd);
+        unlink(temp_path);
+    }
+
+access_index_save_exit:
+    free(temp_path);
+    free(image_paths);
+    free(tables);
+    free(records);
+    free(keys);
+    free(regions);
+    free(region_numbers);
+    free(postings.buffer);
+    free(strings.buffer);
+    return result;
+}
+
+/*
+ argv[0]    - command
+ argv[1]    - "-accessindex"
+ argv[2]    - output index file
+ argv[3]    - input directory or list file
+ argv[4]    - bytes offset or "scan"
+ argv[5]    - bytes count(omitted with "scan")
+ argv[6]    - soc type(argv[5] with "scan")
+ argv[7]    - csv file(if soc type is csv)
+ argv[>=7]  - optional parameters
+ */
+
+int access_index_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    access_build_type build;
+    access_worker_type *workers = NULL;
+    uint32_t workers_count = 0;
+    soc_map_type soc;
+    int32_t soc_type_index;
+    int32_t result;
+    int argi;
+    uint32_t i;
+
+    memset(&build, 0, sizeof(build));
+    if(argc < 6){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+
+    /* Range or scan - argv[4](-argv[5]) */
+    if(strcmp(argv[4], "scan") == 0){
+        build.scan = 1;
+        argi = 5;
+    }
+    else{
+        result = parse_range_parameters(argv[4], argv[5], &build.bytes_offset, &build.bytes_count);
+        if(result != 0){
+            return result;
+        }
+        argi = 6;
+    }
+    if(argi >= argc){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
         return ERROR_PARAMETER_COUNT;
     }
-    
-    /* Parse bytes offset - argv[2] */
-    if((*argv[2]<48)||(*argv[2]>57)){   //argv[2] must start with a number
-        print_error_stderr(ERROR_BYTES_OFFSET_PARAMETER);          //Return bytes offset error to stderr
-        return ERROR_BYTES_OFFSET_PARAMETER;
+    soc_type_index = find_soc_type(argv[argi]);
+    if(soc_type_index < 0){
+        print_error_stderr(ERROR_UNKNOWN_SOC_TYPE);
+        return ERROR_UNKNOWN_SOC_TYPE;
+    }
+    argi++;
+    if(soc_type_index == SOC_TYPE_INDEX_CSV){
+        if(argi >= argc){
+            print_error_stderr(ERROR_PARAMETER_COUNT);
+            return ERROR_PARAMETER_COUNT;
+        }
+        argi++;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+
+    result = batch_collect_files(argv[3], &build.files, &build.images_count);
+    if(result != 0){
+        print_error_stderr(result);
+        return result;
+    }
+    result = load_soc(&soc, soc_type_index, ((soc_type_index == SOC_TYPE_INDEX_CSV) ? argv[argi-1] : NULL), &options);
+    if(result != 0){
+        goto access_index_main_exit;
+    }
+    build.soc = &soc;
+
+    workers_count = batch_workers_count(&options, build.images_count);
+    build.images = calloc((build.images_count + 1), sizeof(access_image_type));
+    workers = calloc(workers_count, sizeof(access_worker_type));
+    if((build.images == NULL) || (workers == NULL)){
+        result = ERROR_TABLE_MALLOC_FAILED;
+        print_error_stderr(result);
+        goto access_index_main_free;
+    }
+    for(i = 0; i < workers_count; i++){
+        workers[i].build = &build;
+        workers[i].first = (uint32_t)(((uint64_t)build.images_count * i) / workers_count);
+        workers[i].end = (uint32_t)(((uint64_t)build.images_count * (i + 1)) / workers_count);
+        workers[i].started = (pthread_create(&workers[i].thread, NULL, access_worker, &workers[i]) == 0);
+        if(!workers[i].started){
+            access_worker(&workers[i]);     //Images of this worker on calling thread
+        }
+    }
+    for(i = 0; i < workers_count; i++){
+        if(workers[i].started){
+            pthread_join(workers[i].thread, NULL);
+        }
+        free_register_table(&workers[i].table);
+    }
+
+    /* Images that failed are indexed with tables read so far */
+    for(i = 0; i < build.images_count; i++){
+        if(build.images[i].result != 0){
+            fprintf(stderr, "%s: ", build.files[i].path);
+            print_error_stderr(build.images[i].result);
+            result = build.images[i].result;
+        }
+    }
+    i = access_index_save(&build, argv[2]);
+    if(i != 0){
+        result = (int32_t)i;
+        print_error_stderr(result);
     }
-    bytes_offset = strtoul((argv[2]), NULL, 0);                     //Store decimal value       //TODO error handling
-    
-    
-    /* Parse bytes count - argv[3] */
-    if((*argv[3]<48)||(*argv[3]>57)){   //argv[3] must start with a number
-        print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);           //Return bytes count error to stderr
-        return ERROR_BYTES_COUNT_PARAMETER;
+
+access_index_main_free:
+    if(build.images){
+        for(i = 0; i < build.images_count; i++){
+            free(build.images[i].records);
+            free(build.images[i].tables);
+        }
     }
-    if((argv[3][0]=='0')&&argv[3][1]=='x'){     //If hexadecimal
-        bytes_count_or_end = strtoul(argv[3], NULL, 0);            //Store hexadecimal value    //TODO error handling
+    free(build.images);
+    free(workers);
+    free_soc(&soc);
+
+access_index_main_exit:
+    for(i = 0; i < build.images_count; i++){
+        free(build.files[i].path);
     }
-    else{                               //Else decimal
-        bytes_count_or_end = strtoul((argv[3]), NULL, 10);         //Store decimal value        //TODO error handling
-        for(temp = 0; argv[3][temp]!='\0';){ //Find string termination
-            temp++;
+    free(build.files);
+    return result;
+}
+
+
+/* Load index file. Returns 0 or ERROR_* (not printed) */
+int load_access_index(access_index_type *index, const char *path){
+    const access_index_header_type *header;
+    struct stat file_stat;
+    uint64_t length;
+    void *map_ptr;
+    int fd;
+
+    memset(index, 0, sizeof(access_index_type));
+    fd = open(path, O_RDONLY);
+    if(fd < 0){
+        return ERROR_OPEN_FILE;
+    }
+    if((fstat(fd, &file_stat) != 0) || (file_stat.st_size < (off_t)sizeof(access_index_header_type))){
+        close(fd);
+        return ERROR_ACCESS_INDEX_FILE;
+    }
+    map_ptr = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map_ptr == MAP_FAILED){
+        return ERROR_READ_FILE_ERROR;
+    }
+    header = map_ptr;
+    length = sizeof(access_index_header_type) + (sizeof(uint32_t) * (uint64_t)((header->images_count + 1) & ~1u)) +
+             (sizeof(access_index_table_type) * (uint64_t)header->tables_count) + (sizeof(access_index_region_type) * (uint64_t)header->regions_count) +
+             (sizeof(access_index_key_type) * (uint64_t)header->keys_count) + header->postings_size + header->strings_size;
+    if((memcmp(header->magic, ACCESS_INDEX_FILE_MAGIC, sizeof(ACCESS_INDEX_FILE_MAGIC)) != 0) || (header->version != ACCESS_INDEX_FILE_VERSION) ||
+       (header->byte_order != ACCESS_INDEX_FILE_BYTE_ORDER) || (header->postings_size > (uint64_t)file_stat.st_size) ||
+       (header->strings_size > (uint64_t)file_stat.st_size) || (length != (uint64_t)file_stat.st_size) ||
+       (header->strings_size && ((const char*)map_ptr)[file_stat.st_size - 1])){
+        munmap(map_ptr, file_stat.st_size);
+        return ERROR_ACCESS_INDEX_FILE;
+    }
+    index->file_ptr = map_ptr;
+    index->file_length = file_stat.st_size;
+    index->header = header;
+    index->image_paths = (const uint32_t*)(header + 1);
+    index->tables = (const access_index_table_type*)(index->image_paths + ((header->images_count + 1) & ~1u));
+    index->regions = (const access_index_region_type*)(index->tables + header->tables_count);
+    index->keys = (const access_index_key_type*)(index->regions + header->regions_count);
+    index->postings = (const uint8_t*)(index->keys + header->keys_count);
+    index->strings = (const char*)(index->postings + header->postings_size);
+    return 0;
+}
+
+void free_access_index(access_index_type *index){
+    if(index->file_ptr){
+        munmap(index->file_ptr, index->file_length);
+    }
+    memset(index, 0, sizeof(access_index_type));
+}
+
+/* Checked string of index. Corrupted offsets give "" */
+static const char *access_index_string(const access_index_type *index, uint32_t offset){
+    return (offset < index->header->strings_size) ? &index->strings[offset] : "";
+}
+
+/* First key with address >= address */
+static uint32_t access_index_lower_bound(const access_index_type *index, uint32_t address){
+    uint32_t low = 0;
+    uint32_t high = index->header->keys_count;
+    while(low < high){
+        uint32_t middle = low + ((high - low) / 2);
+        if(index->keys[middle].address < address){
+            low = middle + 1;
+        }
+        else{
+            high = middle;
         }
-        if(temp>0){
-            temp--;                     //Reverse index by 1 to get last char before '\0'
+    }
+    return low;
+}
+
+#define ACCESS_QUERY_ALL 0
+#define ACCESS_QUERY_WRITE 1
+#define ACCESS_QUERY_READ 2
+
+typedef struct{
+    uint32_t start_address;                 //Keys [start_address, end_address]
+    uint32_t end_address;
+    const char *region_name;                //Only keys of regions with this name. NULL = any region
+    uint32_t operation;                     //ACCESS_QUERY_*
+} access_query_type;
+
+/*
+ * Query: Address, Address-Address, Region or Region+Offset, optionally followed by :write or :read.
+ * Region name is cut at '+'. Returns 0 or ERROR_QUERY_PARAMETER (not printed). Splits query_str.
+ */
+int parse_access_query(char *query_str, access_query_type *query){
+    char *operation_str = strrchr(query_str, ':');
+    char *end;
+
+    memset(query, 0, sizeof(access_query_type));
+    query->end_address = UINT32_MAX;
+    if(operation_str && ((strcmp(operation_str, ":write") == 0) || (strcmp(operation_str, ":read") == 0))){
+        query->operation = (operation_str[1] == 'w') ? ACCESS_QUERY_WRITE : ACCESS_QUERY_READ;
+        *operation_str = '\0';
+    }
+    if((*query_str >= '0') && (*query_str <= '9')){
+        query->start_address = strtoul(query_str, &end, 0);
+        query->end_address = query->start_address;
+        if(*end == '-'){
+            query->end_address = strtoul((end + 1), &end, 0);
         }
-        if(argv[3][temp]=='k'){         //If we find 'k' as last character before string termination
-            bytes_count_or_end *= 1024; //Multiply bytes count with 1024
+        return ((*end != '\0') || (query->end_address < query->start_address)) ? ERROR_QUERY_PARAMETER : 0;
+    }
+    query->region_name = query_str;
+    end = strchr(query_str, '+');
+    if(end){
+        *end = '\0';
+        query->start_address = strtoul((end + 1), &end, 0);     //Offset. Region base is added per region
+        query->end_address = query->start_address;
+        if(*end != '\0'){
+            return ERROR_QUERY_PARAMETER;
         }
     }
-    if(bytes_count_or_end==0){          //Bytes count must be non-zero
-        print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);   //Return bytes count error to stderr
-        return ERROR_BYTES_COUNT_PARAMETER;  
+    return (*query->region_name != '\0') ? 0 : ERROR_QUERY_PARAMETER;
+}
+
+/* Postings of key matching operation. Rendered unless output is NULL. Returns count or -1 if postings are corrupted */
+static int64_t access_query_key(output_buffer_type *output, const access_index_type *index, const access_index_key_type *key, uint32_t operation){
+    const access_index_region_type *region = &index->regions[key->region];
+    const uint8_t *ptr = index->postings + key->postings_offset;
+    const uint8_t *end = index->postings + index->header->postings_size;
+    const access_index_table_type *table;
+    uint64_t table_number = 0;
+    uint64_t row = 0;
+    uint64_t delta;
+    uint64_t attr;
+    uint64_t value;
+    uint32_t flags;
+    int64_t count = 0;
+
+    if(key->postings_offset > index->header->postings_size){
+        return -1;
     }
-    if(bytes_count_or_end%16){          //Bytes count must be %128 = 0
-        print_error_stderr(ERROR_BYTES_COUNT_PARAMETER);   //Return bytes count error to stderr
-        for(temp = 0; temp < bytes_count_or_end;){
-            temp+=16;
+    for(uint32_t i = 0; i < key->postings_count; i++){
+        if(((ptr = get_varint(ptr, end, &delta)) == NULL) || ((table_number + delta) >= index->header->tables_count)){
+            return -1;
+        }
+        if(delta){
+            row = 0;
+        }
+        table_number += delta;
+        if(((ptr = get_varint(ptr, end, &delta)) == NULL) || ((ptr = get_varint(ptr, end, &attr)) == NULL) || ((ptr = get_varint(ptr, end, &value)) == NULL)){
+            return -1;
         }
-        if(bytes_count_or_end > 16){
-            fprintf(stderr, "Try: %lu or %lu?\n", temp, (temp-16));
+        row += delta;
+
+        flags = get_row_flags(key->address, (uint32_t)value, 0, (uint32_t)attr);
+        if(((operation == ACCESS_QUERY_WRITE) && !(flags & ROW_FLAG_WRITE)) || ((operation == ACCESS_QUERY_READ) && ((flags & ROW_FLAG_WRITE) || !(flags & ROW_FLAG_READ)))){
+            continue;                       //Write overrides read in init_registers()
+        }
+        count++;
+        if(output == NULL){
+            continue;
+        }
+
+        table = &index->tables[table_number];
+        output_str(output, "  ");
+        output_str(output, ((table->image < index->header->images_count) ? access_index_string(index, index->image_paths[table->image]) : ""));
+        output_color(output, color_green_str);
+        output_str(output, " - Table ");
+        output_color(output, color_default_str);
+        output_dec(output, table->offset);
+        output_str(output, " 0x");
+        output_hex(output, table->offset);
+        output_color(output, color_green_str);
+        output_str(output, " - Row ");
+        output_color(output, color_default_str);
+        output_dec(output, row);
+        output_str(output, " - ");
+        output_hex32(output, key->address);
+        output_char(output, ' ');
+        output_str(output, access_index_string(index, region->name_offset));
+        output_str(output, "+0x");
+        output_hex(output, (key->address - region->base_address));
+        output_color(output, color_green_str);
+        if(flags & ROW_FLAG_WRITE){
+            output_str(output, " - WRITE");
+            output_color(output, color_default_str);
+            output_str(output, bit_count_str);
+            output_dec_padded(output, ATTR_WRITE_NO_BITS(attr), 2);
+            output_str(output, bit_start_str);
+            output_dec_padded(output, ATTR_WRITE_START_BIT(attr), 2);
         }
         else{
-            fprintf(stderr, "Try: %lu ?\n", temp);
+            output_str(output, " - READ");
+            output_color(output, color_default_str);
+            output_str(output, bit_count_str);
+            output_dec_padded(output, ATTR_READ_NO_BITS(attr), 2);
+            output_str(output, bit_start_str);
+            output_dec_padded(output, ATTR_READ_START_BIT(attr), 2);
         }
-        return ERROR_BYTES_COUNT_PARAMETER;
+        output_color(output, color_green_str);
+        output_str(output, " - VALUE: ");
+        output_color(output, color_default_str);
+        output_hex32(output, (uint32_t)value);
+        output_char(output, '\n');
+    }
+    return count;
+}
+
+/* Postings of query. Counted first, then rendered unless summary only. Returns 0 or ERROR_* (not printed) */
+int run_access_query(output_buffer_type *output, const access_index_type *index, const char *query_str, const access_query_type *query, uint32_t summary_only){
+    const access_index_region_type *region;
+    uint64_t start_address;
+    uint64_t end_address;
+    uint64_t postings_count = 0;
+    uint32_t keys_count = 0;
+    int64_t count;
+
+    for(uint32_t pass = 0; pass < (summary_only ? 1 : 2); pass++){
+        for(uint32_t r = 0; r < (query->region_name ? index->header->regions_count : 1); r++){
+            start_address = query->start_address;
+            end_address = query->end_address;
+            if(query->region_name){
+                region = &index->regions[r];
+                if(strcmp(access_index_string(index, region->name_offset), query->region_name) != 0){
+                    continue;
+                }
+                if(query->end_address != UINT32_MAX){
+                    start_address += region->base_address;  //Region+Offset
+                    end_address += region->base_address;
+                }
+                else{
+                    start_address = region->base_address;
+                    end_address = region->end_address;
+                }
+                if(end_address > UINT32_MAX){
+                    continue;
+                }
+            }
+            for(uint32_t k = access_index_lower_bound(index, (uint32_t)start_address); (k < index->header->keys_count) && (index->keys[k].address <= end_address); k++){
+                if((index->keys[k].region >= index->header->regions_count) || (query->region_name && (index->keys[k].region != r))){
+                    continue;
+                }
+                count = access_query_key((pass ? output : NULL), index, &index->keys[k], query->operation);
+                if(count < 0){
+                    return ERROR_ACCESS_INDEX_FILE;
+                }
+                if(!pass && count){
+                    keys_count++;
+                    postings_count += count;
+                }
+            }
+        }
+        if(!pass){
+            output_color(output, color_blue_str);
+            output_str(output, "Query ");
+            output_color(output, color_default_str);
+            output_str(output, query_str);
+            output_color(output, color_green_str);
+            output_str(output, " - Addresses ");
+            output_color(output, color_default_str);
+            output_dec(output, keys_count);
+            output_color(output, color_green_str);
+            output_str(output, " - Accesses ");
+            output_color(output, color_default_str);
+            output_dec(output, postings_count);
+            output_char(output, '\n');
+        }
+    }
+    return 0;
+}
+
+/*
+ argv[0]    - command
+ argv[1]    - "-query"
+ argv[2]    - index file
+ argv[3..]  - queries
+ argv[>=4]  - optional parameters
+ */
+
+int query_main(int argc, char **argv){
+    parse_options_type options = default_parse_options;
+    access_index_type index;
+    access_query_type query;
+    output_buffer_type output;
+    char *query_str;
+    int argi;
+    int32_t result = 0;
+    int32_t itemp;
+
+    /* Queries until optional parameters */
+    for(argi = 3; (argi < argc) && (argv[argi][0] != '-'); argi++);
+    if(argi <= 3){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
+    }
+    if(process_optional_parameters(argc, argv, argi, &options)!=0){
+        print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
+        return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
+    }
+    result = load_access_index(&index, argv[2]);
+    if(result != 0){
+        print_error_stderr(result);
+        return result;
+    }
+    if(output_open(&output, STDOUT_FILENO, options.color_enabled) != 0){
+        free_access_index(&index);
+        print_error_stderr(ERROR_OUTPUT_MALLOC_FAILED);
+        return ERROR_OUTPUT_MALLOC_FAILED;
+    }
+
+    for(int i = 3; i < argi; i++){
+        query_str = strdup(argv[i]);                        //Parsing splits the string, argv is shown as given
+        itemp = (query_str == NULL) ? ERROR_OUTPUT_MALLOC_FAILED : parse_access_query(query_str, &query);
+        if(itemp == 0){
+            itemp = run_access_query(&output, &index, argv[i], &query, options.diff_summary_only);
+        }
+        free(query_str);
+        if(itemp != 0){
+            output_flush(&output);                          //Keep stdout and stderr in order
+            fprintf(stderr, "%s: ", argv[i]);
+            print_error_stderr(itemp);
+            result = itemp;
+        }
+    }
+    output_close(&output);
+    free_access_index(&index);
+    return result;
+}
+
+
+/* MODES */
+
+/* Modes are selected with first parameter. Without mode parameter InputBinFile is parsed */
+typedef struct{
+    int (*mode_main)(int argc, char **argv);
+    char *mode_parameter_str;
+    char *mode_usage_str;
+} mode_type;
+
+const mode_type mode_list[] = {
+    {
+        scan_main,
+        "-scan",
+        "-scan InputBinFile [OptionalParameters]"
+    },
+    {
+        detect_main,
+        "-detect",
+        "-detect InputBinFile [OptionalParameters]"
+    },
+    {
+        batch_main,
+        "-batch",
+        "-batch InputDir|InputListFile BytesOffset BytesCount|scan SocType [OptionalParameters]"
+    },
+    {
+        diff_main,
+        "-diff",
+        "-diff ReferenceTable CandidateTable [CandidateTable ...] SocType [OptionalParameters]   (Table: InputBinFile or InputBinFile:BytesOffset:BytesCount)"
+    },
+    {
+        simulate_main,
+        "-simulate",
+        "-simulate Table [Table ...] SocType [-seed=DumpFile] [OptionalParameters]"
+    },
+    {
+        timing_main,
+        "-timing",
+        "-timing Table [Table ...] SocType [-clock=ModelFile] [-seed=DumpFile] [-top=N] [OptionalParameters]"
+    },
+    {
+        optimize_main,
+        "-optimize",
+        "-optimize Table OutputBinFile SocType [-summary] [OptionalParameters]"
+    },
+    {
+        autodetect_main,
+        "-autodetect",
+        "-autodetect Table [Table ...] [-maps=CsvDir] [-top=N] [OptionalParameters]"
+    },
+    {
+        fingerprint_main,
+        "-fingerprint",
+        "-fingerprint Table [Table ...] [-index=IndexFile] [-label=Name] [OptionalParameters]"
+    },
+    {
+        cluster_main,
+        "-cluster",
+        "-cluster InputDir|InputTableListFile SocType [-threshold=Percent] [OptionalParameters]"
+    },
+    {
+        access_index_main,
+        "-accessindex",
+        "-accessindex OutputIndexFile InputDir|InputListFile BytesOffset BytesCount|scan SocType [OptionalParameters]"
+    },
+    {
+        query_main,
+        "-query",
+        "-query IndexFile Query [Query ...] [-summary] [OptionalParameters]   (Query: Address, Address-Address, Region or Region+Offset[:write|:read])"
+    }
+};
+
+void print_modes_stderr(){
+    for(uint32_t i = 0; i<(sizeof(mode_list)/sizeof(mode_type)); i++){
+        fprintf(stderr, "%s\n", mode_list[i].mode_usage_str);
     }
+}
+
+
+/*
+ argv[0]    - command
+ argv[1]    - inputfile("-" for stdin)
+ argv[2]    - bytes offset
+ argv[3]    - bytes count
+ argv[4]    - soc type
+ argv[>=5]  - optional parameters
+ */
+
+#define NUMBER_OF_FIXED_PARAMETERS_INCL_CMDNAME 5 
+
+int main(int argc, char **argv){
+    uint32_t temp = 0;
+    int32_t itemp = 0;
     
-    /* Parse Soc Type - argv[4] */
-    for(temp = 0; temp<(sizeof(soc_list)/sizeof(soc_type)); temp++){
-        if(strcmp(soc_list[temp].soc_type_parameter_str,argv[4])==0){
-            selected_soc_type_index = temp;
-            break;
+    uint64_t bytes_offset = 0;
+    uint64_t bytes_count_or_end = 0;
+    
+    input_file_type input;
+    output_buffer_type output;
+    parse_options_type options = default_parse_options;
+    
+    int32_t selected_soc_type_index = 0;                    //Index in soc_list
+    soc_map_type soc;
+    
+    /* Mode - argv[1]. Plain "-" is stdin */
+    if((argc > 1) && (argv[1][0] == '-') && (argv[1][1] != '\0')){
+        for(temp = 0; temp<(sizeof(mode_list)/sizeof(mode_type)); temp++){
+            if(strcmp(mode_list[temp].mode_parameter_str,argv[1])==0){
+                return mode_list[temp].mode_main(argc, argv);
+            }
         }
+        print_error_stderr(ERROR_UNKNOWN_MODE);
+        return ERROR_UNKNOWN_MODE;
+    }
+    
+    if(argc < NUMBER_OF_FIXED_PARAMETERS_INCL_CMDNAME){     //argc check
+        print_error_stderr(ERROR_PARAMETER_COUNT);                 //Return usage to stderr
+        return ERROR_PARAMETER_COUNT;
     }
-    if(temp>=(sizeof(soc_list)/sizeof(soc_type))){                      //If for loop reaches end of list without break;
+    
+    /* Parse bytes offset and bytes count - argv[2] and argv[3] */
+    itemp = parse_range_parameters(argv[2], argv[3], &bytes_offset, &bytes_count_or_end);
+    if(itemp != 0){
+        return itemp;
+    }
+    
+    /* Parse Soc Type - argv[4] */
+    selected_soc_type_index = find_soc_type(argv[4]);
+    if(selected_soc_type_index < 0){                        //Not in soc_list
         print_error_stderr(ERROR_UNKNOWN_SOC_TYPE);
         return(ERROR_UNKNOWN_SOC_TYPE);
     }
-    
-    /* If SoC Type is "csv" then load cvs file - argv[5] */
-    if(strcmp(soc_list[selected_soc_type_index].soc_type_parameter_str,"csv")==0){
-        itemp = import_csv_soc_registers(argv[5]);
-        if(itemp>0){
-            soc_list[selected_soc_type_index].soc_type_registers = csv_soc_registers_ptr;    //Store pointer
-            soc_list[selected_soc_type_index].soc_type_registers_count = itemp;                                 //Store length
-        }
-        else{
-            //Prints have been done by the function
-            return itemp;
-        }
+    if((selected_soc_type_index == SOC_TYPE_INDEX_CSV) && (argc <= NUMBER_OF_FIXED_PARAMETERS_INCL_CMDNAME)){
+        print_error_stderr(ERROR_PARAMETER_COUNT);
+        return ERROR_PARAMETER_COUNT;
     }
     
     /* Parse potential optional parameters - argv[>=5] or argv[>=6] if csv file is passed as parameter */
-    if(process_optional_parameters(argc, argv, (NUMBER_OF_FIXED_PARAMETERS_INCL_CMDNAME+!(strcmp(soc_list[selected_soc_type_index].soc_type_parameter_str,"csv"))))!=0){
-        free(csv_soc_registers_ptr);
+    if(process_optional_parameters(argc, argv, (NUMBER_OF_FIXED_PARAMETERS_INCL_CMDNAME+(selected_soc_type_index == SOC_TYPE_INDEX_CSV)), &options)!=0){
         print_error_stderr(ERROR_UNKNOWN_OPTIONAL_PARAMETER);
         return ERROR_UNKNOWN_OPTIONAL_PARAMETER;
     }
     
+    /* Load SoC. If SoC Type is "csv" then load cvs file - argv[5] */
+    itemp = load_soc(&soc, selected_soc_type_index, argv[5], &options);
+    if(itemp != 0){
+        //Prints have been done by the function
+        return itemp;
+    }
+    
     /* Calculate end of read. Concider bytes_count_or_end as the end of read */
     bytes_count_or_end += bytes_offset;
     
     /* Open File in binary read mode - argv[1] */
-    FILE *fptr = NULL;
-    fptr = fopen( argv[1] ,"rb");       //Open file
-
     /* Check that we have a file open */
-    if(fptr == NULL){
-        free(csv_soc_registers_ptr);
+    if(input_open(&input, argv[1]) != 0){
+        free_soc(&soc);
         print_error_stderr(ERROR_OPEN_FILE);       //Return open input file error to stderr
         return ERROR_OPEN_FILE;
     }
     
-    /* Check that our range doesn't exceed file */
-    fseek(fptr, 0, SEEK_END);                   //Seek the end of file
-    if(ftell(fptr)<bytes_count_or_end){
-        free(csv_soc_registers_ptr);
-        fclose(fptr);
-        print_error_stderr(ERROR_RANGE_EXCEEDS_FILE);  //Return range exceeds input file error to stderr
-        return ERROR_RANGE_EXCEEDS_FILE;
+    if(output_open(&output, STDOUT_FILENO, options.color_enabled) != 0){
+        free_soc(&soc);
+        input_close(&input);
+        print_error_stderr(ERROR_OUTPUT_MALLOC_FAILED);
+        return ERROR_OUTPUT_MALLOC_FAILED;
     }
     
-    fseek(fptr, (int32_t)bytes_offset, SEEK_SET);
-    
-    if(!addresses_only){
-        fprintf(stdout, "Start from %lu 0x%x - End to %lu 0x%x - Range %lu 0x%x - Rows %lu \n",
-            bytes_offset, bytes_offset,
-            bytes_count_or_end, bytes_count_or_end,
-            (bytes_count_or_end-bytes_offset), (bytes_count_or_end-bytes_offset),
-            ((bytes_count_or_end-bytes_offset)/16)
-        );
+    temp = parse_parallel_workers_count(&options, &input, bytes_offset, bytes_count_or_end);
+    if(temp > 1){
+        itemp = parse_table_parallel(&output, &options, &soc, &input, bytes_offset, bytes_count_or_end, temp);
+    }
+    else{
+        itemp = parse_table(&output, &options, &soc, &input, bytes_offset, bytes_count_or_end);
     }
     
-    /* Loop */
-    while(bytes_offset<bytes_count_or_end){
-        /* Read Row */
-        for(uint32_t i = 0; i<DATA_ROW_SIZE; i++){      //TODO Do EOF check
-            data_row[i] = fgetc(fptr);
-            bytes_offset++;
-        }
-        
-        addr = data_row[0]+(data_row[1]<<8)+(data_row[2]<<16)+(data_row[3]<<24);
-        value = data_row[4]+(data_row[5]<<8)+(data_row[6]<<16)+(data_row[7]<<24);
-        delay = data_row[8]+(data_row[9]<<8)+(data_row[10]<<16)+(data_row[11]<<24);
-        attr = data_row[12]+(data_row[13]<<8)+(data_row[14]<<16)+(data_row[15]<<24);
-        
-        write_flag = (attr&0x7);
-        read_flag = ((attr>>16)&0x7);
-    
-        write_no_bits = ((attr>>3)&0x1f);
-        write_start_bit = ((attr>>11)&0x1f);
-    
-        read_no_bits = ((attr>>19)&0x1f);
-        read_start_bit = ((attr>>27)&0x1f);
-        
-        range_8_10 =((attr>>8)&0x3);
-        range_24_26 =((attr>>24)&0x3);
-        
-        closest_register_index = get_register_index(addr, soc_list[selected_soc_type_index].soc_type_registers_count, soc_list[selected_soc_type_index].soc_type_registers);
-        
-        if(!no_address){
-            if(!addresses_only){
-                change_stdout_green();
-                fprintf(stdout, "%s", addr_str);
-                change_stdout_default();
-            }
-        
-        fprintf(stdout, "0x%08x", addr);
-        }
-        
-        if(!addresses_only){
-            fprintf(stdout, " %-15s", soc_list[selected_soc_type_index].soc_type_registers[closest_register_index].register_name);
-            if(print_offset){
-                fprintf(stdout, "0x%08x", soc_list[selected_soc_type_index].soc_type_registers[closest_register_index].base_address); 
-                fprintf(stdout, "+0x%08x", (addr - soc_list[selected_soc_type_index].soc_type_registers[closest_register_index].base_address));         
-            }
-            change_stdout_green();
-            fprintf(stdout, "%s", value_str);
-            change_stdout_default();
-            fprintf(stdout, "0x%08x", value);
-            change_stdout_green();
-            fprintf(stdout, "%s", delay_str);
-
-            if(delay){
-                change_stdout_yellow();
-            }
-            else{
-                change_stdout_default();  
-            }
-        
-            fprintf(stdout, "0x%08x", delay);
-            fprintf(stdout, " DEC %010lu", delay);
-            change_stdout_green();
-            fprintf(stdout, "%s", attr_str);
-            change_stdout_default();
-            fprintf(stdout, "0x%08x  -->", attr);
-        
-            /* Write Attribute Print */
-
-#define VALID_WRITE_FLAG_4 0x4  //Actual valid flag
-#define VALID_WRITE_FLAG_5 0x5  //What is used mostly
-#define VALID_NO_WRITE_FLAG 0x0
-            if(write_flag){
-                if((write_flag==VALID_WRITE_FLAG_4)||(write_flag==VALID_WRITE_FLAG_5)){
-                    change_stdout_blue();
-                    if(write_flag==VALID_WRITE_FLAG_4){
-                        fprintf(stdout, "%s", write_4_str);
-                    }
-                    else{
-                        fprintf(stdout, "%s", write_5_str);
-                    } 
-                    change_stdout_green();
-                    fprintf(stdout, "%s", bit_count_str);
-                    change_stdout_default();
-                    fprintf(stdout, "%02lu", write_no_bits);
-                    change_stdout_green();
-                    fprintf(stdout, "%s", bit_start_str);
-                    change_stdout_default();
-                    fprintf(stdout, "%02lu", write_start_bit);
-
-                    write_flag = VALID_WRITE_FLAG_4;        //Will be used bellow
-                }
-                else{
-                    change_stdout_red();
-                    fprintf(stdout, "%s", inv_write_str); 
-                }
-            
-            }
-
-            /* Read Attribute Print */
-
-#define VALID_READ_FLAG_4 0x4  //Actual valid flag
-#define VALID_READ_FLAG_5 0x5  //What is used mostly
-#define VALID_NO_READ_FLAG 0x0
-            if(read_flag){
-                if((read_flag==VALID_READ_FLAG_4)||(read_flag==VALID_READ_FLAG_5)){
-                    change_stdout_yellow();
-                    if(read_flag==VALID_READ_FLAG_4){
-                        fprintf(stdout, "%s", read_4_str);
-                    }
-                    else{
-                        fprintf(stdout, "%s", read_5_str);
-                    }
-                    change_stdout_green();
-                    fprintf(stdout, "%s", bit_count_str);
-                    change_stdout_default();
-                    fprintf(stdout, "%02lu", read_no_bits);
-                    change_stdout_green();
-                    fprintf(stdout, "%s", bit_start_str);
-                    change_stdout_default();
-                    fprintf(stdout, "%02lu", read_start_bit);
-
-                    read_flag = VALID_READ_FLAG_4;          //Will be used bellow
-                }
-                else{
-                    change_stdout_red();
-                    fprintf(stdout, "%s", inv_read_str); 
-                }
-
-            
-            }
-            else{
-                if(!write_flag){                                        //No read or write flags!
-                    if(delay){                                          //If delay
-                        change_stdout_yellow();
-                        fprintf(stdout, "%s", delay_only_str);          //Print Delay only
-                        change_stdout_default(); 
-                    }
-                    else if((addr==0)&&(value==0)&&(attr==0)){          //If we have full null table entry
-                        fprintf(stdout, "%s", terminate_str);           //Print terminate
-                    }
-                    else{
-                        change_stdout_red();
-                        fprintf(stdout, "%s", none_str);                //Print None(invalid)
-                        change_stdout_default();
-                    }
-                }
-            }
-        
-            /* Extra Notes Part */
-            
-            temp = (((write_flag==VALID_WRITE_FLAG_4)||(write_flag==VALID_NO_WRITE_FLAG))&&((read_flag==VALID_READ_FLAG_4)||(read_flag==VALID_NO_READ_FLAG))); //0x4 Flag has been set to valid flags above
-            temp2 = 0;
-            
-            if(
-            (addr==0 && ( value||delay||attr ))||
-            (write_flag==VALID_WRITE_FLAG_4 && read_flag==VALID_READ_FLAG_4)||
-            ((write_flag==VALID_WRITE_FLAG_4 && (read_no_bits || read_start_bit)) && temp)||
-            ((read_flag==VALID_READ_FLAG_4 && (write_no_bits || read_start_bit)) && temp)||
-            (range_8_10 && temp)||
-            (range_24_26 && temp)||
-            (((write_no_bits + write_start_bit) > 31) && temp)||
-            (((read_no_bits + read_start_bit) > 31) && temp)
-            ){
-                if(attribute_validity_output_format){
-                    fprintf(stdout, " ");                   //Some alignment
-                }
-
-                change_stdout_red();
-                if(addr==0 && ( value||delay||attr )){      //If non-null table entry has null addr
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", null_addr_str);
-                    }
-                    temp2++;
-                }
-                if(write_flag==VALID_WRITE_FLAG_4 && read_flag==VALID_READ_FLAG_4){ //Both read and write
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", both_read_and_write_str);
-                    }
-                    temp2++;
-                }
-                if((write_flag==VALID_WRITE_FLAG_4 && (read_no_bits || read_start_bit)) && temp){ //Rogue read parameters
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", read_parameters_without_read_flag_str);
-                    }
-                    temp2++;
-                }
-                else if((read_flag==VALID_READ_FLAG_4 && (write_no_bits || write_start_bit)) && temp){ //Rogue write parameters
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", write_parameters_without_write_flag_str);
-                    }
-                    temp2++;
-                }
-                if((range_8_10) && temp){ //Bitfield 8-10 is non-zero
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", non_zero_attr_byte_range_8_10_str);
-                    }
-                    temp2++;
-                }
-                if((range_24_26) && temp){ //Bitfield 24-26 is non-zero
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", non_zero_attr_byte_range_24_26_str);
-                    }
-                    temp2++;
-                }
-                if(((write_no_bits + write_start_bit) > 31) && temp){ //Sum exceeds 31
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", write_sum_of_count_and_start_exceeds_31_str);
-                    }
-                    temp2++;
-                }
-                if(((read_no_bits + read_start_bit) > 31) && temp){ //Sum exceeds 31
-                    if((temp2<number_of_attribute_validity_errors_to_print)&&(attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                        fprintf(stdout, "%s", read_sum_of_count_and_start_exceeds_31_str);
-                    }
-                    temp2++;
-                }
-
-                /* If count of omited errors is printed */
-                if(print_how_many_attribute_validity_errors_omited && (temp2 > number_of_attribute_validity_errors_to_print) && (attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_PRINT_ERRORS)){
-                    fprintf(stdout, "(%lu more)", (temp2-number_of_attribute_validity_errors_to_print));
-                }
-
-                /* If only count of errors is to be returned */
-                if((temp2) && (attribute_validity_output_format==ATTRIBUTE_VALIDITY_OUTPUT_FORMAT_DETECTED_ERRORS_COUNT)){
-                    fprintf(stdout, "(%lu attribute errors)", temp2);
-                }
-                
-            
-                change_stdout_default();
-            }
-
-        }   //if(!addresses_only)
-        
-        
-        fprintf(stdout, "\n");
-    } //while(bytes_offset<bytes_count_or_end)
-    
-    free(csv_soc_registers_ptr);
-    fclose(fptr);
-    return 0;
+    output_close(&output);
+    free_soc(&soc);
+    input_close(&input);
+    if(itemp != 0){
+        print_error_stderr(itemp);
+    }
+    return itemp;
         
 }
@@ -0,0 +1,1021 @@
+/*
+ *            DO WHAT THE FUCK YOU WANT TO PUBLIC LICENSE
+ *                    Version 2, December 2004
+ *  
+ * Copyright (C) 2004 Sam Hocevar <sam@hocevar.net>
+ * 
+ * Everyone is permitted to copy and distribute verbatim or modified
+ * copies of this license document, and changing it is allowed as long
+ * as the name is changed.
+ *  
+ *            DO WHAT THE FUCK YOU WANT TO PUBLIC LICENSE
+ *   TERMS AND CONDITIONS FOR COPYING, DISTRIBUTION AND MODIFICATION
+ * 
+ *  0. You just DO WHAT THE FUCK YOU WANT TO.
+ * 
+ *
+ *
+ *
+ * Hisi-initregtable library
+ * janne kaikkonen (c) 2020
+ *
+ * See hisi-initregtable.h
+ *
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hisi-initregtable.h"
+
+
+/* ROW ERRORS */
+
+const char *row_error_str[ROW_ERROR_COUNT] = {
+    "(NULL ADDR)",
+    "(BOTH READ AND WRITE FLAGS ARE PRESENT)",
+    "(READ PARAMETERS W/O READ FLAG)",
+    "(WRITE PARAMETERS W/O WRITE FLAG)",
+    "(NON-ZERO ATTR BYTE RANGE [8-10])",
+    "(NON-ZERO ATTR BYTE RANGE [24-26])",
+    "(WRITE SUM OF BIT COUNT AND START BIT >31)",
+    "(READ SUM OF BIT COUNT AND START BIT >31)"
+};
+
+
+/* REGISTER TABLE */
+
+#define REGISTER_TABLE_ALIGN 64
+#define REGISTER_TABLE_ROW_BYTES ((4*sizeof(uint32_t))+(2*sizeof(uint16_t)))
+
+int alloc_register_table(register_table_type *table, size_t rows){
+    void *block = NULL;
+
+    memset(table, 0, sizeof(register_table_type));
+    rows = (rows + 31) & ~(size_t)31;       //Keeps every array 64byte aligned
+    if(rows == 0){
+        return 0;
+    }
+    if(posix_memalign(&block, REGISTER_TABLE_ALIGN, (rows * REGISTER_TABLE_ROW_BYTES)) != 0){
+        return -1;
+    }
+    table->addr = block;
+    table->value = table->addr + rows;
+    table->delay = table->value + rows;
+    table->attr = table->delay + rows;
+    table->flags = (uint16_t*)(table->attr + rows);
+    table->errors = table->flags + rows;
+    table->size = rows;
+    return 0;
+}
+
+void free_register_table(register_table_type *table){
+    free(table->addr);                      //Start of the block
+    memset(table, 0, sizeof(register_table_type));
+}
+
+int decode_register_table(register_table_type *table, const uint8_t *data, size_t length){
+    size_t rows = length / DATA_ROW_SIZE;
+
+    if(rows > table->size){
+        free_register_table(table);
+        if(alloc_register_table(table, rows) != 0){
+            return -1;
+        }
+    }
+    for(size_t i = 0; i < rows; i++){
+        table->addr[i] = get_le32(&data[0]);
+        table->value[i] = get_le32(&data[4]);
+        table->delay[i] = get_le32(&data[8]);
+        table->attr[i] = get_le32(&data[12]);
+        data += DATA_ROW_SIZE;
+    }
+    table->count = rows;
+    decode_register_table_attributes(table, 0, rows);
+    return 0;
+}
+
+/*
+ * Attribute decode kernels. Vector kernels compute the same ROW_FLAG_* and ROW_ERROR_* bits as get_row_flags() and get_row_errors()
+ * for 4(SSE4.1) or 8(AVX2) rows at a time with compare masks instead of branches. Kernel is chosen at runtime. Remaining rows are decoded by scalar kernel.
+ */
+
+/* Scalar kernel of rows [first, end) */
+static void decode_attributes_scalar(register_table_type *table, size_t first, size_t end){
+    for(size_t i = first; i < end; i++){
+        table->flags[i] = get_row_flags(table->addr[i], table->value[i], table->delay[i], table->attr[i]);
+        table->errors[i] = get_row_errors(table->addr[i], table->value[i], table->delay[i], table->attr[i]);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define ATTR_READ_PARAMETERS_MASK   0xf8f80000      //Read no bits and read start bit
+#define ATTR_WRITE_PARAMETERS_MASK  0x0000f8f8      //Write no bits and write start bit
+#define ATTR_RANGE_8_10_MASK        0x00000300      //Same 2bit check as get_row_errors()
+#define ATTR_RANGE_24_26_MASK       0x03000000
+
+/* Returns first row not decoded */
+__attribute__((target("sse4.1")))
+static size_t decode_attributes_sse41(register_table_type *table, size_t first, size_t end){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i flag_mask = _mm_set1_epi32(0x7);
+    const __m128i bits_mask = _mm_set1_epi32(0x1f);
+    const __m128i flag_4 = _mm_set1_epi32(VALID_WRITE_FLAG_4);
+    const __m128i flag_5 = _mm_set1_epi32(VALID_WRITE_FLAG_5);
+    const __m128i sum_limit = _mm_set1_epi32(31);
+    __m128i addr, value, delay, attr;
+    __m128i write_flag, read_flag, write_no_bits, write_start_bit, read_no_bits, read_start_bit;
+    __m128i write_4, write_5, write_valid, write_none, read_4, read_5, read_valid, read_none;
+    __m128i no_flags, delay_zero, all_zero, valid_flags, rogue_read, rogue_write, section;
+    __m128i flags, errors;
+    size_t i;
+
+    for(i = first; (i + 4) <= end; i += 4){
+        addr = _mm_loadu_si128((const __m128i*)&table->addr[i]);
+        value = _mm_loadu_si128((const __m128i*)&table->value[i]);
+        delay = _mm_loadu_si128((const __m128i*)&table->delay[i]);
+        attr = _mm_loadu_si128((const __m128i*)&table->attr[i]);
+
+        write_flag = _mm_and_si128(attr, flag_mask);
+        read_flag = _mm_and_si128(_mm_srli_epi32(attr, 16), flag_mask);
+        write_no_bits = _mm_and_si128(_mm_srli_epi32(attr, 3), bits_mask);
+        write_start_bit = _mm_and_si128(_mm_srli_epi32(attr, 11), bits_mask);
+        read_no_bits = _mm_and_si128(_mm_srli_epi32(attr, 19), bits_mask);
+        read_start_bit = _mm_srli_epi32(attr, 27);
+
+        write_4 = _mm_cmpeq_epi32(write_flag, flag_4);
+        write_5 = _mm_cmpeq_epi32(write_flag, flag_5);
+        write_valid = _mm_or_si128(write_4, write_5);
+        write_none = _mm_cmpeq_epi32(write_flag, zero);
+        read_4 = _mm_cmpeq_epi32(read_flag, flag_4);
+        read_5 = _mm_cmpeq_epi32(read_flag, flag_5);
+        read_valid = _mm_or_si128(read_4, read_5);
+        read_none = _mm_cmpeq_epi32(read_flag, zero);
+        no_flags = _mm_and_si128(write_none, read_none);
+        delay_zero = _mm_cmpeq_epi32(delay, zero);
+        all_zero = _mm_cmpeq_epi32(_mm_or_si128(_mm_or_si128(addr, value), _mm_or_si128(delay, attr)), zero);
+
+        /* Flags */
+        flags = _mm_and_si128(write_valid, _mm_set1_epi32(ROW_FLAG_WRITE));
+        flags = _mm_or_si128(flags, _mm_and_si128(write_5, _mm_set1_epi32(ROW_FLAG_WRITE_5)));
+        flags = _mm_or_si128(flags, _mm_andnot_si128(_mm_or_si128(write_valid, write_none), _mm_set1_epi32(ROW_FLAG_WRITE_INVALID)));
+        flags = _mm_or_si128(flags, _mm_and_si128(read_valid, _mm_set1_epi32(ROW_FLAG_READ)));
+        flags = _mm_or_si128(flags, _mm_and_si128(read_5, _mm_set1_epi32(ROW_FLAG_READ_5)));
+        flags = _mm_or_si128(flags, _mm_andnot_si128(_mm_or_si128(read_valid, read_none), _mm_set1_epi32(ROW_FLAG_READ_INVALID)));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_andnot_si128(delay_zero, no_flags), _mm_set1_epi32(ROW_FLAG_DELAY_ONLY)));
+        flags = _mm_or_si128(flags, _mm_and_si128(all_zero, _mm_set1_epi32(ROW_FLAG_TERMINATE)));
+        flags = _mm_or_si128(flags, _mm_and_si128(_mm_andnot_si128(all_zero, _mm_and_si128(no_flags, delay_zero)), _mm_set1_epi32(ROW_FLAG_NONE)));
+
+        /* Errors */
+        valid_flags = _mm_and_si128(_mm_or_si128(write_valid, write_none), _mm_or_si128(read_valid, read_none));
+        rogue_read = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(attr, _mm_set1_epi32(ATTR_READ_PARAMETERS_MASK)), zero), _mm_and_si128(valid_flags, write_valid));
+        rogue_write = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(attr, _mm_set1_epi32(ATTR_WRITE_PARAMETERS_MASK)), zero), _mm_and_si128(valid_flags, read_valid));
+        rogue_write = _mm_andnot_si128(rogue_read, rogue_write);
+        errors = _mm_and_si128(_mm_andnot_si128(all_zero, _mm_cmpeq_epi32(addr, zero)), _mm_set1_epi32(ROW_ERROR_NULL_ADDR));
+        errors = _mm_or_si128(errors, _mm_and_si128(_mm_and_si128(write_valid, read_valid), _mm_set1_epi32(ROW_ERROR_BOTH_READ_AND_WRITE)));
+        errors = _mm_or_si128(errors, _mm_and_si128(rogue_read, _mm_set1_epi32(ROW_ERROR_READ_PARAMETERS_WO_READ_FLAG)));
+        errors = _mm_or_si128(errors, _mm_and_si128(rogue_write, _mm_set1_epi32(ROW_ERROR_WRITE_PARAMETERS_WO_WRITE_FLAG)));
+        errors = _mm_or_si128(errors, _mm_and_si128(_mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(attr, _mm_set1_epi32(ATTR_RANGE_8_10_MASK)), zero), valid_flags), _mm_set1_epi32(ROW_ERROR_NON_ZERO_RANGE_8_10)));
+        errors = _mm_or_si128(errors, _mm_and_si128(_mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(attr, _mm_set1_epi32(ATTR_RANGE_24_26_MASK)), zero), valid_flags), _mm_set1_epi32(ROW_ERROR_NON_ZERO_RANGE_24_26)));
+        errors = _mm_or_si128(errors, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(write_no_bits, write_start_bit), sum_limit), valid_flags), _mm_set1_epi32(ROW_ERROR_WRITE_SUM_EXCEEDS_31)));
+        errors = _mm_or_si128(errors, _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(read_no_bits, read_start_bit), sum_limit), valid_flags), _mm_set1_epi32(ROW_ERROR_READ_SUM_EXCEEDS_31)));
+
+        /* Printer's error section quirks. See ROW_ERROR_EMPTY_SECTION */
+        section = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_or_si128(write_no_bits, read_start_bit), zero), _mm_and_si128(valid_flags, read_valid));
+        errors = _mm_or_si128(errors, _mm_andnot_si128(section, _mm_and_si128(_mm_cmpeq_epi32(errors, _mm_set1_epi32(ROW_ERROR_WRITE_PARAMETERS_WO_WRITE_FLAG)), _mm_set1_epi32(ROW_ERROR_HIDDEN_SECTION))));
+        errors = _mm_or_si128(errors, _mm_and_si128(_mm_and_si128(section, _mm_cmpeq_epi32(errors, zero)), _mm_set1_epi32(ROW_ERROR_EMPTY_SECTION)));
+
+        /* Narrow to 16bits: flags in low half, errors in high half */
+        flags = _mm_packus_epi32(flags, errors);
+        _mm_storel_epi64((__m128i*)&table->flags[i], flags);
+        _mm_storel_epi64((__m128i*)&table->errors[i], _mm_srli_si128(flags, 8));
+    }
+    return i;
+}
+
+/* Returns first row not decoded */
+__attribute__((target("avx2")))
+static size_t decode_attributes_avx2(register_table_type *table, size_t first, size_t end){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i flag_mask = _mm256_set1_epi32(0x7);
+    const __m256i bits_mask = _mm256_set1_epi32(0x1f);
+    const __m256i flag_4 = _mm256_set1_epi32(VALID_WRITE_FLAG_4);
+    const __m256i flag_5 = _mm256_set1_epi32(VALID_WRITE_FLAG_5);
+    const __m256i sum_limit = _mm256_set1_epi32(31);
+    __m256i addr, value, delay, attr;
+    __m256i write_flag, read_flag, write_no_bits, write_start_bit, read_no_bits, read_start_bit;
+    __m256i write_4, write_5, write_valid, write_none, read_4, read_5, read_valid, read_none;
+    __m256i no_flags, delay_zero, all_zero, valid_flags, rogue_read, rogue_write, section;
+    __m256i flags, errors;
+    size_t i;
+
+    for(i = first; (i + 8) <= end; i += 8){
+        addr = _mm256_loadu_si256((const __m256i*)&table->addr[i]);
+        value = _mm256_loadu_si256((const __m256i*)&table->value[i]);
+        delay = _mm256_loadu_si256((const __m256i*)&table->delay[i]);
+        attr = _mm256_loadu_si256((const __m256i*)&table->attr[i]);
+
+        write_flag = _mm256_and_si256(attr, flag_mask);
+        read_flag = _mm256_and_si256(_mm256_srli_epi32(attr, 16), flag_mask);
+        write_no_bits = _mm256_and_si256(_mm256_srli_epi32(attr, 3), bits_mask);
+        write_start_bit = _mm256_and_si256(_mm256_srli_epi32(attr, 11), bits_mask);
+        read_no_bits = _mm256_and_si256(_mm256_srli_epi32(attr, 19), bits_mask);
+        read_start_bit = _mm256_srli_epi32(attr, 27);
+
+        write_4 = _mm256_cmpeq_epi32(write_flag, flag_4);
+        write_5 = _mm256_cmpeq_epi32(write_flag, flag_5);
+        write_valid = _mm256_or_si256(write_4, write_5);
+        write_none = _mm256_cmpeq_epi32(write_flag, zero);
+        read_4 = _mm256_cmpeq_epi32(read_flag, flag_4);
+        read_5 = _mm256_cmpeq_epi32(read_flag, flag_5);
+        read_valid = _mm256_or_si256(read_4, read_5);
+        read_none = _mm256_cmpeq_epi32(read_flag, zero);
+        no_flags = _mm256_and_si256(write_none, read_none);
+        delay_zero = _mm256_cmpeq_epi32(delay, zero);
+        all_zero = _mm256_cmpeq_epi32(_mm256_or_si256(_mm256_or_si256(addr, value), _mm256_or_si256(delay, attr)), zero);
+
+        /* Flags */
+        flags = _mm256_and_si256(write_valid, _mm256_set1_epi32(ROW_FLAG_WRITE));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(write_5, _mm256_set1_epi32(ROW_FLAG_WRITE_5)));
+        flags = _mm256_or_si256(flags, _mm256_andnot_si256(_mm256_or_si256(write_valid, write_none), _mm256_set1_epi32(ROW_FLAG_WRITE_INVALID)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(read_valid, _mm256_set1_epi32(ROW_FLAG_READ)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(read_5, _mm256_set1_epi32(ROW_FLAG_READ_5)));
+        flags = _mm256_or_si256(flags, _mm256_andnot_si256(_mm256_or_si256(read_valid, read_none), _mm256_set1_epi32(ROW_FLAG_READ_INVALID)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_andnot_si256(delay_zero, no_flags), _mm256_set1_epi32(ROW_FLAG_DELAY_ONLY)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(all_zero, _mm256_set1_epi32(ROW_FLAG_TERMINATE)));
+        flags = _mm256_or_si256(flags, _mm256_and_si256(_mm256_andnot_si256(all_zero, _mm256_and_si256(no_flags, delay_zero)), _mm256_set1_epi32(ROW_FLAG_NONE)));
+
+        /* Errors */
+        valid_flags = _mm256_and_si256(_mm256_or_si256(write_valid, write_none), _mm256_or_si256(read_valid, read_none));
+        rogue_read = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(attr, _mm256_set1_epi32(ATTR_READ_PARAMETERS_MASK)), zero), _mm256_and_si256(valid_flags, write_valid));
+        rogue_write = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(attr, _mm256_set1_epi32(ATTR_WRITE_PARAMETERS_MASK)), zero), _mm256_and_si256(valid_flags, read_valid));
+        rogue_write = _mm256_andnot_si256(rogue_read, rogue_write);
+        errors = _mm256_and_si256(_mm256_andnot_si256(all_zero, _mm256_cmpeq_epi32(addr, zero)), _mm256_set1_epi32(ROW_ERROR_NULL_ADDR));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(_mm256_and_si256(write_valid, read_valid), _mm256_set1_epi32(ROW_ERROR_BOTH_READ_AND_WRITE)));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(rogue_read, _mm256_set1_epi32(ROW_ERROR_READ_PARAMETERS_WO_READ_FLAG)));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(rogue_write, _mm256_set1_epi32(ROW_ERROR_WRITE_PARAMETERS_WO_WRITE_FLAG)));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(_mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(attr, _mm256_set1_epi32(ATTR_RANGE_8_10_MASK)), zero), valid_flags), _mm256_set1_epi32(ROW_ERROR_NON_ZERO_RANGE_8_10)));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(_mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(attr, _mm256_set1_epi32(ATTR_RANGE_24_26_MASK)), zero), valid_flags), _mm256_set1_epi32(ROW_ERROR_NON_ZERO_RANGE_24_26)));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(_mm256_add_epi32(write_no_bits, write_start_bit), sum_limit), valid_flags), _mm256_set1_epi32(ROW_ERROR_WRITE_SUM_EXCEEDS_31)));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(_mm256_add_epi32(read_no_bits, read_start_bit), sum_limit), valid_flags), _mm256_set1_epi32(ROW_ERROR_READ_SUM_EXCEEDS_31)));
+
+        /* Printer's error section quirks. See ROW_ERROR_EMPTY_SECTION */
+        section = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_or_si256(write_no_bits, read_start_bit), zero), _mm256_and_si256(valid_flags, read_valid));
+        errors = _mm256_or_si256(errors, _mm256_andnot_si256(section, _mm256_and_si256(_mm256_cmpeq_epi32(errors, _mm256_set1_epi32(ROW_ERROR_WRITE_PARAMETERS_WO_WRITE_FLAG)), _mm256_set1_epi32(ROW_ERROR_HIDDEN_SECTION))));
+        errors = _mm256_or_si256(errors, _mm256_and_si256(_mm256_and_si256(section, _mm256_cmpeq_epi32(errors, zero)), _mm256_set1_epi32(ROW_ERROR_EMPTY_SECTION)));
+
+        /* Narrow to 16bits. packus works per 128bit lane -> reorder to flags 0-7, errors 0-7 */
+        flags = _mm256_permute4x64_epi64(_mm256_packus_epi32(flags, errors), 0xd8);
+        _mm_storeu_si128((__m128i*)&table->flags[i], _mm256_castsi256_si128(flags));
+        _mm_storeu_si128((__m128i*)&table->errors[i], _mm256_extracti128_si256(flags, 1));
+    }
+    return i;
+}
+#endif
+
+void decode_register_table_attributes(register_table_type *table, size_t first, size_t count){
+    size_t end = first + count;
+#if defined(__x86_64__) || defined(__i386__)
+    if(__builtin_cpu_supports("avx2")){
+        first = decode_attributes_avx2(table, first, end);
+    }
+    else if(__builtin_cpu_supports("sse4.1")){
+        first = decode_attributes_sse41(table, first, end);
+    }
+#endif
+    decode_attributes_scalar(table, first, end);
+}
+
+
+/* REGISTER BASE INDEX */
+
+static inline uint32_t register_end_address(const soc_register_type *reg){
+    return (reg->end_address < reg->base_address) ? UINT32_MAX : reg->end_address;
+}
+
+/* Max-heap of register indexes ordered by base address(higher first), then by table position(lower first) */
+static inline int register_heap_before(const soc_register_type *table, uint32_t a, uint32_t b){
+    if(table[a].base_address != table[b].base_address){
+        return (table[a].base_address > table[b].base_address);
+    }
+    return (a < b);
+}
+
+static void register_heap_push(const soc_register_type *table, uint32_t *heap, uint32_t *heap_count, uint32_t register_index){
+    uint32_t i = (*heap_count)++;
+    while(i && register_heap_before(table, register_index, heap[(i-1)/2])){
+        heap[i] = heap[(i-1)/2];
+        i = (i-1)/2;
+    }
+    heap[i] = register_index;
+}
+
+static void register_heap_pop(const soc_register_type *table, uint32_t *heap, uint32_t *heap_count){
+    uint32_t last = heap[--(*heap_count)];
+    uint32_t i = 0;
+    uint32_t child;
+    while((child = (2*i+1)) < *heap_count){
+        if(((child+1) < *heap_count) && register_heap_before(table, heap[child+1], heap[child])){
+            child++;
+        }
+        if(!register_heap_before(table, heap[child], last)){
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+
+/* Sort key: base address in high word and table position in low word */
+static int register_sort_compare(const void *a, const void *b){
+    uint64_t ka = *(const uint64_t*)a;
+    uint64_t kb = *(const uint64_t*)b;
+    return (ka < kb) ? -1 : (ka > kb);
+}
+
+static void index_add_segment(soc_register_index_type *index, uint32_t start, uint32_t end, uint32_t register_index){
+    soc_register_segment_type *last = index->segments_count ? &index->segments[index->segments_count-1] : NULL;
+    if(last && (last->register_index == register_index) && (last->end_address == (start-1))){
+        last->end_address = end;            //Merge with previous segment
+        return;
+    }
+    index->segments[index->segments_count].start_address = start;
+    index->segments[index->segments_count].end_address = end;
+    index->segments[index->segments_count].register_index = register_index;
+    index->segments_count++;
+}
+
+/* Returns 0 on success, -1 if malloc() fails */
+int build_soc_register_index(soc_register_index_type *index, const soc_register_type *table, size_t number_of_registers){
+    uint64_t *order;                        //Register indexes sorted by base address. See register_sort_compare()
+    uint32_t *heap;                         //Registers covering current address
+    uint32_t heap_count = 0;
+    uint32_t next = 0;                      //Next register in order[] to be activated
+    uint64_t address = 0;                   //Sweep position. 64bit to detect sweep past 0xFFFFFFFF
+    uint64_t segment_end;
+    uint32_t top;
+
+    memset(index, 0, sizeof(soc_register_index_type));
+    order = malloc(sizeof(uint64_t)*(number_of_registers+1));
+    heap = malloc(sizeof(uint32_t)*(number_of_registers+1));
+    index->segments = malloc(sizeof(soc_register_segment_type)*(2*number_of_registers+1));  //Every range can split at most one other
+    if((order == NULL) || (heap == NULL) || (index->segments == NULL)){
+        free(order);
+        free(heap);
+        free(index->segments);
+        index->segments = NULL;
+        return -1;
+    }
+
+    for(uint32_t i = 0; i<number_of_registers; i++){
+        order[i] = (((uint64_t)table[i].base_address)<<32) | i;
+    }
+    qsort(order, number_of_registers, sizeof(uint64_t), register_sort_compare);
+    for(uint32_t i = 0; i<number_of_registers; i++){
+        order[i] &= UINT32_MAX;             //Keep table position only
+    }
+
+    while(address <= UINT32_MAX){
+        /* Activate ranges starting at or before address */
+        while((next < number_of_registers) && (table[order[next]].base_address <= address)){
+            register_heap_push(table, heap, &heap_count, order[next]);
+            next++;
+        }
+        /* Drop ranges that have ended */
+        while(heap_count && (register_end_address(&table[heap[0]]) < address)){
+            register_heap_pop(table, heap, &heap_count);
+        }
+        
+        /* Current segment ends where next range starts or current winner ends */
+        segment_end = UINT32_MAX;
+        if(next < number_of_registers){
+            segment_end = (uint64_t)table[order[next]].base_address - 1;
+        }
+        if(heap_count){
+            if(register_end_address(&table[heap[0]]) < segment_end){
+                segment_end = register_end_address(&table[heap[0]]);
+            }
+            index_add_segment(index, address, segment_end, heap[0]);
+        }
+        else if(next >= number_of_registers){
+            break;                          //Nothing left
+        }
+        address = segment_end + 1;
+    }
+
+    /* Radix buckets */
+    top = 0;
+    for(uint32_t i = 0; i<=SOC_REGISTER_INDEX_RADIX_COUNT; i++){
+        while((top < index->segments_count) && (((uint64_t)index->segments[top].end_address) < ((uint64_t)i<<SOC_REGISTER_INDEX_RADIX_SHIFT))){
+            top++;
+        }
+        index->radix[i] = top;
+    }
+
+    free(order);
+    free(heap);
+    return 0;
+}
+
+void free_soc_register_index(soc_register_index_type *index){
+    free(index->segments);
+    index->segments = NULL;
+    index->segments_count = 0;
+}
+
+
+/* REGISTER FIELD MAP */
+
+int build_register_field_map(register_field_map_type *map, register_field_type *fields, size_t fields_count){
+    uint64_t *order;                        //address<<32 | start_bit<<27 | field index. Stable within equal address and start bit
+    register_field_type *sorted;
+    uint32_t top;
+
+    memset(map, 0, sizeof(register_field_map_type));
+    if(fields_count >= (1u<<27)){
+        return -1;
+    }
+    order = malloc(sizeof(uint64_t)*(fields_count+1));
+    sorted = malloc(sizeof(register_field_type)*(fields_count+1));
+    map->addresses = malloc(sizeof(uint32_t)*(fields_count+1));
+    map->first_field = malloc(sizeof(uint32_t)*(fields_count+1));
+    if((order == NULL) || (sorted == NULL) || (map->addresses == NULL) || (map->first_field == NULL)){
+        free(order);
+        free(sorted);
+        free_register_field_map(map);
+        return -1;
+    }
+
+    for(uint32_t i = 0; i<fields_count; i++){
+        order[i] = (((uint64_t)fields[i].address)<<32) | (((uint64_t)fields[i].start_bit & 0x1F)<<27) | i;
+    }
+    qsort(order, fields_count, sizeof(uint64_t), register_sort_compare);
+    for(uint32_t i = 0; i<fields_count; i++){
+        sorted[i] = fields[order[i] & ((1u<<27)-1)];
+    }
+    memcpy(fields, sorted, (sizeof(register_field_type)*fields_count));
+    free(order);
+    free(sorted);
+
+    /* Registers */
+    for(uint32_t i = 0; i<fields_count; i++){
+        if((i == 0) || (fields[i].address != fields[i-1].address)){
+            map->addresses[map->registers_count] = fields[i].address;
+            map->first_field[map->registers_count] = i;
+            map->registers_count++;
+        }
+    }
+    map->first_field[map->registers_count] = fields_count;
+    map->fields = fields;
+
+    /* Radix buckets */
+    top = 0;
+    for(uint32_t i = 0; i<=SOC_REGISTER_INDEX_RADIX_COUNT; i++){
+        while((top < map->registers_count) && (((uint64_t)map->addresses[top]) < ((uint64_t)i<<SOC_REGISTER_INDEX_RADIX_SHIFT))){
+            top++;
+        }
+        map->radix[i] = top;
+    }
+    return 0;
+}
+
+void free_register_field_map(register_field_map_type *map){
+    free(map->addresses);
+    free(map->first_field);
+    map->addresses = NULL;
+    map->first_field = NULL;
+    map->fields = NULL;
+    map->registers_count = 0;
+}
+
+
+/* REGISTER FILE */
+
+#define REGISTER_FILE_MIN_SIZE 64
+
+/* Multiplicative hash. Top bits of the product are used since word aligned addresses have no entropy in low bits */
+static inline uint32_t register_file_hash(uint32_t address, uint32_t size){
+    return (uint32_t)(address * 0x9e3779b1u) >> (32 - __builtin_ctz(size));
+}
+
+static uint32_t register_file_size(size_t expected_registers){
+    uint32_t size = REGISTER_FILE_MIN_SIZE;
+    while((size < (2 * expected_registers)) && (size < (1u<<31))){
+        size <<= 1;
+    }
+    return size;
+}
+
+int alloc_register_file(register_file_type *registers, size_t expected_registers){
+    memset(registers, 0, sizeof(register_file_type));
+    registers->size = register_file_size(expected_registers);
+    registers->entries = calloc(registers->size, sizeof(register_file_entry_type));
+    if(registers->entries == NULL){
+        registers->size = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void free_register_file(register_file_type *registers){
+    free(registers->entries);
+    registers->entries = NULL;
+    registers->size = 0;
+    registers->count = 0;
+}
+
+void clear_register_file(register_file_type *registers){
+    memset(registers->entries, 0, (sizeof(register_file_entry_type) * registers->size));
+    registers->count = 0;
+}
+
+static int register_file_grow(register_file_type *registers){
+    register_file_entry_type *old_entries = registers->entries;
+    uint32_t old_size = registers->size;
+    uint32_t slot;
+
+    registers->entries = calloc((2 * (size_t)old_size), sizeof(register_file_entry_type));
+    if(registers->entries == NULL){
+        registers->entries = old_entries;
+        return -1;
+    }
+    registers->size = 2 * old_size;
+    for(uint32_t i = 0; i < old_size; i++){
+        if(old_entries[i].state){
+            slot = register_file_hash(old_entries[i].address, registers->size);
+            while(registers->entries[slot].state){
+                slot = (slot + 1) & (registers->size - 1);
+            }
+            registers->entries[slot] = old_entries[i];
+        }
+    }
+    free(old_entries);
+    return 0;
+}
+
+register_file_entry_type *get_register_file_entry(register_file_type *registers, uint32_t address){
+    register_file_entry_type *entry;
+    uint32_t slot = register_file_hash(address, registers->size);
+
+    while(registers->entries[slot].state){
+        if(registers->entries[slot].address == address){
+            return &registers->entries[slot];
+        }
+        slot = (slot + 1) & (registers->size - 1);
+    }
+
+    /* Insert */
+    if((2 * (registers->count + 1)) > registers->size){
+        if(register_file_grow(registers) != 0){
+            return NULL;
+        }
+        slot = register_file_hash(address, registers->size);
+        while(registers->entries[slot].state){
+            slot = (slot + 1) & (registers->size - 1);
+        }
+    }
+    entry = &registers->entries[slot];
+    entry->address = address;
+    entry->value = registers->default_value;
+    entry->initial_value = registers->default_value;
+    entry->state = REGISTER_FILE_USED;
+    registers->count++;
+    return entry;
+}
+
+int seed_register_file(register_file_type *registers, uint32_t address, uint32_t value){
+    register_file_entry_type *entry = get_register_file_entry(registers, address);
+    if(entry == NULL){
+        return -1;
+    }
+    entry->value = value;
+    entry->initial_value = value;
+    entry->state |= REGISTER_FILE_SEEDED;
+    return 0;
+}
+
+
+/* SIMULATION */
+
+static inline uint32_t simulation_mask(uint32_t no_bits){
+    return (no_bits >= 31) ? UINT32_MAX : ((1u<<(no_bits + 1)) - 1);
+}
+
+static inline void simulation_write(register_file_entry_type *entry, uint32_t value, uint32_t attr){
+    uint32_t mask = simulation_mask(ATTR_WRITE_NO_BITS(attr));
+    uint32_t start = ATTR_WRITE_START_BIT(attr);
+    entry->value = (entry->value & ~(mask<<start)) | ((value & mask)<<start);
+    entry->state |= REGISTER_FILE_WRITTEN;
+    entry->writes++;
+}
+
+int simulate_register_table(register_file_type *registers, const register_table_type *table, simulation_result_type *result){
+    register_file_entry_type *entry;
+    simulation_poll_type *temp_ptr;
+    uint32_t attr;
+    uint32_t mask;
+    uint32_t start;
+    uint32_t actual;
+
+    result->rows_executed = 0;
+    result->terminate_row = SIZE_MAX;
+    result->delay_total = 0;
+    result->writes = 0;
+    result->polls = 0;
+    result->stuck_polls_count = 0;
+
+    for(size_t i = 0; i < table->count; i++){
+        attr = table->attr[i];
+        if(!(table->addr[i] | table->value[i] | table->delay[i] | attr)){
+            result->terminate_row = i;
+            break;
+        }
+        result->rows_executed++;
+
+        if(ATTR_WRITE_FLAG(attr) & VALID_WRITE_FLAG_4){
+            entry = get_register_file_entry(registers, table->addr[i]);
+            if(entry == NULL){
+                return -1;
+            }
+            simulation_write(entry, table->value[i], attr);
+            result->writes++;
+        }
+        else if(ATTR_READ_FLAG(attr) & VALID_READ_FLAG_4){
+            entry = get_register_file_entry(registers, table->addr[i]);
+            if(entry == NULL){
+                return -1;
+            }
+            mask = simulation_mask(ATTR_READ_NO_BITS(attr));
+            start = ATTR_READ_START_BIT(attr);
+            actual = (entry->value>>start) & mask;
+            entry->state |= REGISTER_FILE_READ;
+            entry->reads++;
+            result->polls++;
+            if(actual != table->value[i]){
+                if(result->stuck_polls_count == result->stuck_polls_size){
+                    result->stuck_polls_size = result->stuck_polls_size ? (result->stuck_polls_size * 2) : 16;
+                    temp_ptr = realloc(result->stuck_polls, (sizeof(simulation_poll_type) * result->stuck_polls_size));
+                    if(temp_ptr == NULL){
+                        return -1;
+                    }
+                    result->stuck_polls = temp_ptr;
+                }
+                result->stuck_polls[result->stuck_polls_count].row = i;
+                result->stuck_polls[result->stuck_polls_count].address = table->addr[i];
+                result->stuck_polls[result->stuck_polls_count].expected = table->value[i];
+                result->stuck_polls[result->stuck_polls_count].actual = actual;
+                result->stuck_polls_count++;
+            }
+        }
+        result->delay_total += table->delay[i];
+    }
+    return 0;
+}
+
+void free_simulation_result(simulation_result_type *result){
+    free(result->stuck_polls);
+    memset(result, 0, sizeof(simulation_result_type));
+}
+
+
+/* TIMING */
+
+static inline int clock_field_written(const clock_field_type *field, uint32_t address){
+    return (field->bits && (field->address == address));
+}
+
+/* Field value from register file. Returns missing_value if model has no such field. Sets *ok to 0 if malloc() fails */
+static uint32_t clock_field_value(register_file_type *registers, const clock_field_type *field, uint32_t missing_value, int *ok){
+    register_file_entry_type *entry;
+    if(!field->bits){
+        return missing_value;
+    }
+    entry = get_register_file_entry(registers, field->address);
+    if(entry == NULL){
+        *ok = 0;
+        return 0;
+    }
+    return (entry->value >> field->start_bit) & simulation_mask(field->bits - 1);
+}
+
+/* Current core clock. Returns 0 on success, -1 if malloc() fails */
+static int timing_clock(register_file_type *registers, const clock_model_type *model, uint32_t *mode, uint32_t *clock_hz){
+    uint64_t divider;
+    uint64_t hz;
+    int ok = 1;
+
+    *mode = clock_field_value(registers, &model->mode, 0, &ok) & (CLOCK_MODEL_MODES - 1);
+    *clock_hz = model->mode_hz[*mode];
+    if(*clock_hz == CLOCK_MODE_PLL){
+        hz = (uint64_t)model->reference_hz * clock_field_value(registers, &model->fbdiv, 1, &ok);
+        divider = (uint64_t)clock_field_value(registers, &model->refdiv, 1, &ok) * clock_field_value(registers, &model->postdiv1, 1, &ok);
+        divider *= (uint64_t)clock_field_value(registers, &model->postdiv2, 1, &ok) * (model->pll_divider ? model->pll_divider : 1);
+        hz = divider ? (hz / divider) : 0;              //Unprogrammed divider -> unknown
+        *clock_hz = (hz < UINT32_MAX) ? (uint32_t)hz : 0;
+    }
+    return ok ? 0 : -1;
+}
+
+/* cycles * 1e9 / clock_hz without overflow */
+static inline uint64_t timing_nanoseconds(uint64_t cycles, uint32_t clock_hz){
+    return ((cycles / clock_hz) * 1000000000ull) + (((cycles % clock_hz) * 1000000000ull) / clock_hz);
+}
+
+static int timing_add_phase(timing_result_type *result, size_t first_row, uint32_t mode, uint32_t clock_hz){
+    timing_phase_type *temp_ptr;
+    if(result->phases_count == result->phases_size){
+        result->phases_size = result->phases_size ? (result->phases_size * 2) : 8;
+        temp_ptr = realloc(result->phases, (sizeof(timing_phase_type) * result->phases_size));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        result->phases = temp_ptr;
+    }
+    memset(&result->phases[result->phases_count], 0, sizeof(timing_phase_type));
+    result->phases[result->phases_count].first_row = first_row;
+    result->phases[result->phases_count].mode = mode;
+    result->phases[result->phases_count].clock_hz = clock_hz;
+    result->phases_count++;
+    return 0;
+}
+
+int estimate_register_table_timing(register_file_type *registers, const clock_model_type *model, const register_table_type *table, timing_result_type *result){
+    register_file_entry_type *entry;
+    timing_phase_type *phase;
+    timing_row_type *temp_ptr;
+    uint32_t attr;
+    uint32_t mode;
+    uint32_t clock_hz;
+    uint64_t cycles;
+
+    result->rows_executed = 0;
+    result->terminate_row = SIZE_MAX;
+    result->delay_total = 0;
+    result->cycles_total = 0;
+    result->nanoseconds_total = 0;
+    result->unknown_clock_cycles = 0;
+    result->phases_count = 0;
+
+    if(table->count > result->rows_size){
+        temp_ptr = realloc(result->rows, (sizeof(timing_row_type) * table->count));
+        if(temp_ptr == NULL){
+            return -1;
+        }
+        result->rows = temp_ptr;
+        result->rows_size = table->count;
+    }
+    if((timing_clock(registers, model, &mode, &clock_hz) != 0) || (timing_add_phase(result, 0, mode, clock_hz) != 0)){
+        return -1;
+    }
+
+    for(size_t i = 0; i < table->count; i++){
+        attr = table->attr[i];
+        if(!(table->addr[i] | table->value[i] | table->delay[i] | attr)){
+            result->terminate_row = i;
+            break;
+        }
+        result->rows_executed++;
+        phase = &result->phases[result->phases_count - 1];
+
+        if(ATTR_WRITE_FLAG(attr) & VALID_WRITE_FLAG_4){
+            entry = get_register_file_entry(registers, table->addr[i]);
+            if(entry == NULL){
+                return -1;
+            }
+            simulation_write(entry, table->value[i], attr);
+            if(clock_field_written(&model->mode, entry->address) || clock_field_written(&model->fbdiv, entry->address) ||
+               clock_field_written(&model->refdiv, entry->address) || clock_field_written(&model->postdiv1, entry->address) ||
+               clock_field_written(&model->postdiv2, entry->address)){
+                if(timing_clock(registers, model, &mode, &clock_hz) != 0){
+                    return -1;
+                }
+                if((mode != phase->mode) || (clock_hz != phase->clock_hz)){
+                    if(timing_add_phase(result, i, mode, clock_hz) != 0){
+                        return -1;
+                    }
+                    phase = &result->phases[result->phases_count - 1];
+                }
+            }
+        }
+        else if(ATTR_READ_FLAG(attr) & VALID_READ_FLAG_4){
+            phase->polls++;
+        }
+
+        cycles = ((uint64_t)table->delay[i] * model->loop_cycles) + model->row_cycles;
+        result->rows[i].cycles = cycles;
+        result->rows[i].nanoseconds = phase->clock_hz ? timing_nanoseconds(cycles, phase->clock_hz) : 0;
+        phase->rows++;
+        phase->delay += table->delay[i];
+        phase->cycles += cycles;
+        result->delay_total += table->delay[i];
+        result->cycles_total += cycles;
+    }
+
+    for(size_t i = 0; i < result->phases_count; i++){
+        phase = &result->phases[i];
+        if(phase->clock_hz){
+            phase->nanoseconds = timing_nanoseconds(phase->cycles, phase->clock_hz);
+            result->nanoseconds_total += phase->nanoseconds;
+        }
+        else{
+            result->unknown_clock_cycles += phase->cycles;
+        }
+    }
+    return 0;
+}
+
+void free_timing_result(timing_result_type *result){
+    free(result->phases);
+    free(result->rows);
+    memset(result, 0, sizeof(timing_result_type));
+}
+
+
+/* OPTIMIZATION */
+
+/* Valid write without read flags or attribute errors. Only these rows are dropped or merged */
+static inline int optimize_plain_write(const register_table_type *table, size_t row){
+    return ((table->flags[row] & (ROW_FLAG_WRITE | ROW_FLAG_READ | ROW_FLAG_READ_INVALID)) == ROW_FLAG_WRITE) && !(table->errors[row] & ROW_ERROR_MASK);
+}
+
+/* Register bits written by a write row */
+static inline uint32_t optimize_write_bits(uint32_t attr){
+    return simulation_mask(ATTR_WRITE_NO_BITS(attr)) << ATTR_WRITE_START_BIT(attr);
+}
+
+static int optimize_key_compare(const void *a, const void *b){
+    uint64_t key_a = *(const uint64_t*)a;
+    uint64_t key_b = *(const uint64_t*)b;
+    return (key_a < key_b) ? -1 : (key_a > key_b);
+}
+
+/* Mark dead writes of segment [first, end). Segment is a run of plain writes with zero delay except possibly the last one */
+static void optimize_dead_writes(const register_table_type *table, size_t first, size_t end, optimization_result_type *result){
+    size_t count = end - first;
+    size_t group_end;
+    uint32_t covered;
+    uint32_t row;
+
+    if(count < 2){
+        return;
+    }
+    for(size_t i = 0; i < count; i++){
+        result->keys[i] = ((uint64_t)table->addr[first + i] << 32) | (first + i);
+    }
+    qsort(result->keys, count, sizeof(uint64_t), optimize_key_compare);
+
+    /* Every address from the last write backwards */
+    for(size_t i = count; i > 0; i = group_end){
+        covered = 0;
+        group_end = i;
+        while((group_end > 0) && ((result->keys[group_end - 1] >> 32) == (result->keys[i - 1] >> 32))){
+            group_end--;
+            row = (uint32_t)result->keys[group_end];
+            if((optimize_write_bits(table->attr[row]) & ~covered) == 0){
+                result->actions[row] = OPTIMIZE_DEAD_WRITE;
+                result->dead_writes++;
+            }
+            covered |= optimize_write_bits(table->attr[row]);
+        }
+    }
+}
+
+/* Merge write row into previous write out_row of the same address if their bits form one field. Returns 1 if merged */
+static int optimize_merge_write(register_table_type *optimized, size_t out_row, uint32_t value, uint32_t attr){
+    uint32_t previous_bits = optimize_write_bits(optimized->attr[out_row]);
+    uint32_t bits = optimize_write_bits(attr);
+    uint32_t merged_bits = previous_bits | bits;
+    uint32_t start = __builtin_ctz(merged_bits);
+    uint32_t field = merged_bits >> start;
+    uint32_t merged_value;
+
+    if(field & (field + 1)){
+        return 0;                           //Not contiguous
+    }
+    merged_value = ((optimized->value[out_row] << ATTR_WRITE_START_BIT(optimized->attr[out_row])) & previous_bits & ~bits) | ((value << ATTR_WRITE_START_BIT(attr)) & bits);
+    optimized->value[out_row] = merged_value >> start;
+    optimized->attr[out_row] = ATTR_WRITE_FLAG(attr) | ((__builtin_popcount(merged_bits) - 1) << 3) | (start << 11);
+    return 1;
+}
+
+int optimize_register_table(const register_table_type *table, register_table_type *optimized, optimization_result_type *result){
+    uint8_t *temp_actions;
+    uint32_t *temp_rows;
+    uint64_t *temp_keys;
+    size_t rows = table->count;
+    size_t segment_first;
+    size_t out_count = 0;
+    size_t out_source = SIZE_MAX;           //Input row of the last optimized row
+    uint64_t delay;
+
+    result->dead_writes = 0;
+    result->merged_writes = 0;
+    result->folded_delays = 0;
+    result->unreachable_rows = 0;
+
+    if(table->count > result->rows_size){
+        temp_actions = realloc(result->actions, table->count);
+        if(temp_actions == NULL){
+            return -1;
+        }
+        result->actions = temp_actions;
+        temp_rows = realloc(result->output_row, (sizeof(uint32_t) * table->count));
+        if(temp_rows == NULL){
+            return -1;
+        }
+        result->output_row = temp_rows;
+        result->rows_size = table->count;
+    }
+    if(table->count > result->keys_size){
+        temp_keys = realloc(result->keys, (sizeof(uint64_t) * table->count));
+        if(temp_keys == NULL){
+            return -1;
+        }
+        result->keys = temp_keys;
+        result->keys_size = table->count;
+    }
+    if(table->count > optimized->size){
+        free_register_table(optimized);
+        if(alloc_register_table(optimized, table->count) != 0){
+            return -1;
+        }
+    }
+    memset(result->actions, OPTIMIZE_KEPT, table->count);
+
+    /* Executed rows */
+    for(size_t i = 0; i < table->count; i++){
+        if(table->flags[i] & ROW_FLAG_TERMINATE){
+            rows = i + 1;
+            break;
+        }
+    }
+    for(size_t i = rows; i < table->count; i++){
+        result->actions[i] = OPTIMIZE_UNREACHABLE;
+        result->output_row[i] = UINT32_MAX;
+        result->unreachable_rows++;
+    }
+
+    /* Dead writes per segment between barriers */
+    segment_first = 0;
+    for(size_t i = 0; i <= rows; i++){
+        if((i == rows) || !optimize_plain_write(table, i)){
+            optimize_dead_writes(table, segment_first, i, result);
+            segment_first = i + 1;
+        }
+        else if(table->delay[i]){
+            optimize_dead_writes(table, segment_first, (i + 1), result);
+            segment_first = i + 1;
+        }
+    }
+
+    /* Emit rows merging adjacent writes and folding delays */
+    for(size_t i = 0; i < rows; i++){
+        if(result->actions[i] == OPTIMIZE_DEAD_WRITE){
+            result->output_row[i] = UINT32_MAX;
+            continue;
+        }
+        if(out_count && optimize_plain_write(table, i) && optimize_plain_write(table, out_source) &&
+           (optimized->addr[out_count - 1] == table->addr[i]) && !optimized->delay[out_count - 1] &&
+           optimize_merge_write(optimized, (out_count - 1), table->value[i], table->attr[i])){
+            result->actions[out_source] = OPTIMIZE_MERGED_WRITE;
+            result->merged_writes++;
+            optimized->delay[out_count - 1] = table->delay[i];
+            result->output_row[i] = out_count - 1;
+            out_source = i;
+            continue;
+        }
+        if(out_count && (table->flags[i] & ROW_FLAG_DELAY_ONLY) && !(table->errors[i] & ROW_ERROR_MASK & ~ROW_ERROR_NULL_ADDR) &&
+           !(table->flags[out_source] & (ROW_FLAG_WRITE_INVALID | ROW_FLAG_READ_INVALID | ROW_FLAG_NONE)) && !(table->errors[out_source] & ROW_ERROR_MASK)){
+            delay = (uint64_t)optimized->delay[out_count - 1] + table->delay[i];
+            if(delay <= UINT32_MAX){
+                optimized->delay[out_count - 1] = (uint32_t)delay;
+                result->actions[i] = OPTIMIZE_FOLDED_DELAY;
+                result->output_row[i] = out_count - 1;
+                result->folded_delays++;
+                continue;
+            }
+        }
+        optimized->addr[out_count] = table->addr[i];
+        optimized->value[out_count] = table->value[i];
+        optimized->delay[out_count] = table->delay[i];
+        optimized->attr[out_count] = table->attr[i];
+        result->output_row[i] = out_count;
+        out_source = i;
+        out_count++;
+    }
+    optimized->count = out_count;
+    decode_register_table_attributes(optimized, 0, out_count);
+    return 0;
+}
+
+void free_optimization_result(optimization_result_type *result){
+    free(result->actions);
+    free(result->output_row);
+    free(result->keys);
+    memset(result, 0, sizeof(optimization_result_type));
+}
@@ -0,0 +1,568 @@
+/*
+ *            DO WHAT THE FUCK YOU WANT TO PUBLIC LICENSE
+ *                    Version 2, December 2004
+ *  
+ * Copyright (C) 2004 Sam Hocevar <sam@hocevar.net>
+ * 
+ * Everyone is permitted to copy and distribute verbatim or modified
+ * copies of this license document, and changing it is allowed as long
+ * as the name is changed.
+ *  
+ *            DO WHAT THE FUCK YOU WANT TO PUBLIC LICENSE
+ *   TERMS AND CONDITIONS FOR COPYING, DISTRIBUTION AND MODIFICATION
+ * 
+ *  0. You just DO WHAT THE FUCK YOU WANT TO.
+ * 
+ *
+ *
+ *
+ * Hisi-initregtable library
+ * janne kaikkonen (c) 2020
+ *
+ * Decodes HiSilicon init register tables into a struct of arrays table and maps addresses to SoC register bases.
+ * See hisi-initregtable-parser.c for description of the table and attribute format.
+ *
+ * Build: make lib -> libhisi-initregtable.a and libhisi-initregtable.so
+ *
+ *
+ * Usage:
+ *   register_table_type table;
+ *   if(alloc_register_table(&table, 0) == 0 && decode_register_table(&table, data, length) == 0){
+ *       for(size_t i = 0; i < table.count; i++){
+ *           if(table.errors[i] & ROW_ERROR_MASK) ...      //Fields: addr, value, delay, attr, flags, errors
+ *       }
+ *   }
+ *   free_register_table(&table);
+ *
+ */
+
+#ifndef HISI_INITREGTABLE_H
+#define HISI_INITREGTABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+
+#define DATA_ROW_SIZE (4*4)                 //One "row" 4*4bytes = 16bytes
+
+
+/* Little endian 32bit load from unaligned pointer. Compiles to a single load on little endian hosts */
+static inline uint32_t get_le32(const uint8_t *ptr){
+    uint32_t temp;
+    memcpy(&temp, ptr, sizeof(temp));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    temp = __builtin_bswap32(temp);
+#endif
+    return temp;
+}
+
+
+/* Little endian 32bit store to unaligned pointer */
+static inline void put_le32(uint8_t *ptr, uint32_t value){
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    value = __builtin_bswap32(value);
+#endif
+    memcpy(ptr, &value, sizeof(value));
+}
+
+
+/* ATTRIBUTE FIELDS */
+
+#define ATTR_WRITE_FLAG(attr)       ((attr)&0x7)
+#define ATTR_WRITE_NO_BITS(attr)    (((attr)>>3)&0x1f)
+#define ATTR_WRITE_START_BIT(attr)  (((attr)>>11)&0x1f)
+#define ATTR_READ_FLAG(attr)        (((attr)>>16)&0x7)
+#define ATTR_READ_NO_BITS(attr)     (((attr)>>19)&0x1f)
+#define ATTR_READ_START_BIT(attr)   (((attr)>>27)&0x1f)
+
+#define VALID_WRITE_FLAG_4 0x4  //Actual valid flag
+#define VALID_WRITE_FLAG_5 0x5  //What is used mostly
+#define VALID_NO_WRITE_FLAG 0x0
+
+#define VALID_READ_FLAG_4 0x4  //Actual valid flag
+#define VALID_READ_FLAG_5 0x5  //What is used mostly
+#define VALID_NO_READ_FLAG 0x0
+
+
+/* ROW FLAGS. Decoded operation of a table entry */
+
+#define ROW_FLAG_WRITE                              (1<<0)      //Write flag 0x4 or 0x5
+#define ROW_FLAG_WRITE_5                            (1<<1)      //Write flag is 0x5
+#define ROW_FLAG_WRITE_INVALID                      (1<<2)      //Non-zero write flag other than 0x4 or 0x5
+#define ROW_FLAG_READ                               (1<<3)      //Read flag 0x4 or 0x5. Write overrides read in init_registers()
+#define ROW_FLAG_READ_5                             (1<<4)      //Read flag is 0x5
+#define ROW_FLAG_READ_INVALID                       (1<<5)      //Non-zero read flag other than 0x4 or 0x5
+#define ROW_FLAG_DELAY_ONLY                         (1<<6)      //No flags, non-zero delay
+#define ROW_FLAG_TERMINATE                          (1<<7)      //Full null entry. Ends init_registers()
+#define ROW_FLAG_NONE                               (1<<8)      //No flags, no delay but not a null entry
+
+/* Returns ROW_FLAG_* bits of a table entry */
+static inline uint32_t get_row_flags(uint32_t addr, uint32_t value, uint32_t delay, uint32_t attr){
+    uint32_t write_flag = ATTR_WRITE_FLAG(attr);
+    uint32_t read_flag = ATTR_READ_FLAG(attr);
+    uint32_t flags = 0;
+
+    if(write_flag==VALID_WRITE_FLAG_4){
+        flags |= ROW_FLAG_WRITE;
+    }
+    else if(write_flag==VALID_WRITE_FLAG_5){
+        flags |= (ROW_FLAG_WRITE | ROW_FLAG_WRITE_5);
+    }
+    else if(write_flag){
+        flags |= ROW_FLAG_WRITE_INVALID;
+    }
+
+    if(read_flag==VALID_READ_FLAG_4){
+        flags |= ROW_FLAG_READ;
+    }
+    else if(read_flag==VALID_READ_FLAG_5){
+        flags |= (ROW_FLAG_READ | ROW_FLAG_READ_5);
+    }
+    else if(read_flag){
+        flags |= ROW_FLAG_READ_INVALID;
+    }
+
+    if(!write_flag && !read_flag){
+        if(delay){
+            flags |= ROW_FLAG_DELAY_ONLY;
+        }
+        else if((addr==0)&&(value==0)&&(attr==0)){
+            flags |= ROW_FLAG_TERMINATE;
+        }
+        else{
+            flags |= ROW_FLAG_NONE;
+        }
+    }
+    return flags;
+}
+
+
+/* ROW ERRORS */
+
+/* Error bits. Listed in the order they are printed */
+#define ROW_ERROR_NULL_ADDR                         (1<<0)
+#define ROW_ERROR_BOTH_READ_AND_WRITE               (1<<1)
+#define ROW_ERROR_READ_PARAMETERS_WO_READ_FLAG      (1<<2)
+#define ROW_ERROR_WRITE_PARAMETERS_WO_WRITE_FLAG    (1<<3)
+#define ROW_ERROR_NON_ZERO_RANGE_8_10               (1<<4)
+#define ROW_ERROR_NON_ZERO_RANGE_24_26              (1<<5)
+#define ROW_ERROR_WRITE_SUM_EXCEEDS_31              (1<<6)
+#define ROW_ERROR_READ_SUM_EXCEEDS_31               (1<<7)
+#define ROW_ERROR_COUNT                             8
+#define ROW_ERROR_MASK                              ((1<<ROW_ERROR_COUNT)-1)
+
+/*
+ * Not errors. The original printer decides whether to print the error section with a condition that checks read start bit
+ * where write start bit is meant(rogue write parameters). Kept for identical output:
+ * - Read entry with non-zero read start bit prints an empty error section(" " and colors) when there are no errors.
+ * - Rogue write parameters with zero write bit count and zero read start bit as the only error are not printed.
+ */
+#define ROW_ERROR_EMPTY_SECTION                     (1<<8)
+#define ROW_ERROR_HIDDEN_SECTION                    (1<<9)
+
+/* Indexed by error bit number */
+extern const char *row_error_str[ROW_ERROR_COUNT];
+
+/* Returns ROW_ERROR_* bits of a table entry */
+static inline uint32_t get_row_errors(uint32_t addr, uint32_t value, uint32_t delay, uint32_t attr){
+    uint32_t write_flag = ATTR_WRITE_FLAG(attr);
+    uint32_t read_flag = ATTR_READ_FLAG(attr);
+    uint32_t write_no_bits = ATTR_WRITE_NO_BITS(attr);
+    uint32_t write_start_bit = ATTR_WRITE_START_BIT(attr);
+    uint32_t read_no_bits = ATTR_READ_NO_BITS(attr);
+    uint32_t read_start_bit = ATTR_READ_START_BIT(attr);
+    uint32_t valid_flags;
+    uint32_t errors = 0;
+
+    if(write_flag==VALID_WRITE_FLAG_5){
+        write_flag = VALID_WRITE_FLAG_4;
+    }
+    if(read_flag==VALID_READ_FLAG_5){
+        read_flag = VALID_READ_FLAG_4;
+    }
+    valid_flags = (((write_flag==VALID_WRITE_FLAG_4)||(write_flag==VALID_NO_WRITE_FLAG))&&((read_flag==VALID_READ_FLAG_4)||(read_flag==VALID_NO_READ_FLAG)));
+
+    if(addr==0 && ( value||delay||attr )){                                                  //If non-null table entry has null addr
+        errors |= ROW_ERROR_NULL_ADDR;
+    }
+    if(write_flag==VALID_WRITE_FLAG_4 && read_flag==VALID_READ_FLAG_4){                     //Both read and write
+        errors |= ROW_ERROR_BOTH_READ_AND_WRITE;
+    }
+    if(valid_flags){
+        if(write_flag==VALID_WRITE_FLAG_4 && (read_no_bits || read_start_bit)){             //Rogue read parameters
+            errors |= ROW_ERROR_READ_PARAMETERS_WO_READ_FLAG;
+        }
+        else if(read_flag==VALID_READ_FLAG_4 && (write_no_bits || write_start_bit)){        //Rogue write parameters
+            errors |= ROW_ERROR_WRITE_PARAMETERS_WO_WRITE_FLAG;
+        }
+        if((attr>>8)&0x3){                                                                  //Bitfield 8-10 is non-zero
+            errors |= ROW_ERROR_NON_ZERO_RANGE_8_10;
+        }
+        if((attr>>24)&0x3){                                                                 //Bitfield 24-26 is non-zero
+            errors |= ROW_ERROR_NON_ZERO_RANGE_24_26;
+        }
+        if((write_no_bits + write_start_bit) > 31){                                         //Sum exceeds 31
+            errors |= ROW_ERROR_WRITE_SUM_EXCEEDS_31;
+        }
+        if((read_no_bits + read_start_bit) > 31){                                           //Sum exceeds 31
+            errors |= ROW_ERROR_READ_SUM_EXCEEDS_31;
+        }
+        if(read_flag==VALID_READ_FLAG_4 && (write_no_bits || read_start_bit)){         //Printer's section condition for rogue write parameters
+            if(!errors){
+                errors |= ROW_ERROR_EMPTY_SECTION;
+            }
+        }
+        else if(errors == ROW_ERROR_WRITE_PARAMETERS_WO_WRITE_FLAG){
+            errors |= ROW_ERROR_HIDDEN_SECTION;
+        }
+    }
+    return errors;
+}
+
+
+/* REGISTER TABLE */
+
+/*
+ * Decoded table as struct of arrays. Row i is addr[i], value[i], delay[i], attr[i] with decoded flags[i](ROW_FLAG_*) and errors[i](ROW_ERROR_*).
+ * Arrays are allocated as one 64byte aligned block.
+ */
+
+typedef struct{
+    uint32_t *addr;
+    uint32_t *value;
+    uint32_t *delay;
+    uint32_t *attr;
+    uint16_t *flags;
+    uint16_t *errors;
+    size_t count;                           //Decoded rows
+    size_t size;                            //Allocated rows
+} register_table_type;
+
+/* Returns 0 on success, -1 if malloc() fails. rows may be 0 */
+int alloc_register_table(register_table_type *table, size_t rows);
+void free_register_table(register_table_type *table);
+
+/* Decode length/DATA_ROW_SIZE rows of data into table replacing previous rows. Grows table if needed. Returns 0 on success, -1 if malloc() fails */
+int decode_register_table(register_table_type *table, const uint8_t *data, size_t length);
+
+/* (Re)compute flags and errors of rows [first, first+count) from addr, value, delay and attr arrays. Uses AVX2 or SSE4.1 kernel when the CPU has one */
+void decode_register_table_attributes(register_table_type *table, size_t first, size_t count);
+
+
+/* REGISTER BASE INDEX */
+
+typedef struct{
+    uint32_t base_address;
+    uint32_t end_address;
+    const char *register_name;
+} soc_register_type;
+
+
+/*
+ * Register bases are indexed once at load time. Possibly overlapping [base, end] ranges are flattened to sorted non-overlapping segments.
+ * - Where ranges overlap, range with the closest(highest) base address wins. On equal base the first one in the table wins.
+ * - End address smaller than base address means the range is open ended(extends to 0xFFFFFFFF).
+ * - Addresses that fall outside every range don't have a segment -> no match.
+ * Lookup is a binary search within a 256 entry radix bucket(top 8 address bits) with a last hit cache in front of it.
+ */
+
+#define SOC_REGISTER_INDEX_RADIX_SHIFT 24
+#define SOC_REGISTER_INDEX_RADIX_COUNT (1<<(32-SOC_REGISTER_INDEX_RADIX_SHIFT))
+
+typedef struct{
+    uint32_t start_address;
+    uint32_t end_address;                   //Inclusive
+    uint32_t register_index;                //Index in soc_register_type table
+} soc_register_segment_type;
+
+typedef struct{
+    soc_register_segment_type *segments;
+    uint32_t segments_count;
+    uint32_t radix[SOC_REGISTER_INDEX_RADIX_COUNT+1];   //radix[n] = first segment with end_address >= (n<<SOC_REGISTER_INDEX_RADIX_SHIFT)
+} soc_register_index_type;
+
+/* Returns 0 on success, -1 if malloc() fails */
+int build_soc_register_index(soc_register_index_type *index, const soc_register_type *table, size_t number_of_registers);
+void free_soc_register_index(soc_register_index_type *index);
+
+/* Returns index of register base the address belongs to or -1 if no register matches. last_hit is lookup cache owned by the caller */
+static inline int32_t get_register_index(uint32_t address, const soc_register_index_type *index, uint32_t *last_hit){
+    const soc_register_segment_type *segment;
+    uint32_t low;
+    uint32_t high;
+    uint32_t middle;
+
+    if(*last_hit < index->segments_count){
+        segment = &index->segments[*last_hit];
+        if((segment->start_address <= address) && (address <= segment->end_address)){
+            return segment->register_index;
+        }
+    }
+
+    /* First segment with end_address >= address */
+    low = index->radix[address>>SOC_REGISTER_INDEX_RADIX_SHIFT];
+    high = index->radix[(address>>SOC_REGISTER_INDEX_RADIX_SHIFT)+1];
+    if(high >= index->segments_count){
+        high = index->segments_count;
+    }
+    else{
+        high++;                             //Segment reaching into next bucket
+    }
+    while(low < high){
+        middle = low + ((high - low)/2);
+        if(index->segments[middle].end_address < address){
+            low = middle + 1;
+        }
+        else{
+            high = middle;
+        }
+    }
+    if((low < index->segments_count) && (index->segments[low].start_address <= address)){
+        *last_hit = low;
+        return index->segments[low].register_index;
+    }
+    return -1;                              //No match
+}
+
+
+/* REGISTER FIELD MAP */
+
+/*
+ * Optional map of individual registers and their bitfields. Fields are sorted by register address and start bit.
+ * Register addresses are kept in their own sorted array: lookup is a binary search within a 256 entry radix bucket(top 8 address bits).
+ * - Fields of register i are fields[first_field[i]] ... fields[first_field[i+1]-1]. Fields may overlap.
+ * - Field array and names are owned by the caller. Map only orders the array and indexes it.
+ */
+
+typedef struct{
+    uint32_t address;
+    uint32_t start_bit;                     //0-31
+    uint32_t bits;                          //Width 1-32. start_bit + bits <= 32
+    const char *register_name;
+    const char *field_name;
+} register_field_type;
+
+typedef struct{
+    uint32_t *addresses;                    //Sorted register addresses
+    uint32_t *first_field;                  //registers_count+1 entries
+    register_field_type *fields;
+    uint32_t registers_count;
+    uint32_t radix[SOC_REGISTER_INDEX_RADIX_COUNT+1];   //radix[n] = first register with address >= (n<<SOC_REGISTER_INDEX_RADIX_SHIFT)
+} register_field_map_type;
+
+/* Sorts fields in place and indexes them. Returns 0 on success, -1 if malloc() fails */
+int build_register_field_map(register_field_map_type *map, register_field_type *fields, size_t fields_count);
+void free_register_field_map(register_field_map_type *map);
+
+/* Returns register index in map or -1 if address has no fields */
+static inline int32_t get_register_fields(uint32_t address, const register_field_map_type *map){
+    uint32_t low;
+    uint32_t high;
+    uint32_t middle;
+
+    if(map->registers_count == 0){
+        return -1;
+    }
+    low = map->radix[address>>SOC_REGISTER_INDEX_RADIX_SHIFT];
+    high = map->radix[(address>>SOC_REGISTER_INDEX_RADIX_SHIFT)+1];
+    while(low < high){
+        middle = low + ((high - low)/2);
+        if(map->addresses[middle] < address){
+            low = middle + 1;
+        }
+        else{
+            high = middle;
+        }
+    }
+    if((low < map->registers_count) && (map->addresses[low] == address)){
+        return low;
+    }
+    return -1;
+}
+
+
+/* REGISTER FILE */
+
+/*
+ * Sparse register model used by the simulator. Open addressing hash map(linear probing) from register address to value.
+ * - Registers that haven't been seeded read as default_value.
+ * - Sized once for the expected number of registers. Grows only if the load factor exceeds 1/2.
+ * - Owned by the caller. Independent register files can be used by concurrent simulations.
+ */
+
+#define REGISTER_FILE_USED                          (1<<0)
+#define REGISTER_FILE_SEEDED                        (1<<1)      //Initial value from register dump
+#define REGISTER_FILE_WRITTEN                       (1<<2)
+#define REGISTER_FILE_READ                          (1<<3)      //Read by poll
+
+typedef struct{
+    uint32_t address;
+    uint32_t value;
+    uint32_t initial_value;
+    uint32_t state;                         //REGISTER_FILE_*. 0 = free slot
+    uint32_t writes;
+    uint32_t reads;
+} register_file_entry_type;
+
+typedef struct{
+    register_file_entry_type *entries;
+    uint32_t size;                          //Slots. Power of two
+    uint32_t count;                         //Used slots
+    uint32_t default_value;
+} register_file_type;
+
+/* Returns 0 on success, -1 if malloc() fails */
+int alloc_register_file(register_file_type *registers, size_t expected_registers);
+void free_register_file(register_file_type *registers);
+void clear_register_file(register_file_type *registers);
+
+/* Returns entry of address. Missing register is inserted with default_value. NULL if malloc() fails */
+register_file_entry_type *get_register_file_entry(register_file_type *registers, uint32_t address);
+
+/* Set initial value of register. Returns 0 on success, -1 if malloc() fails */
+int seed_register_file(register_file_type *registers, uint32_t address, uint32_t value);
+
+
+/* SIMULATION */
+
+/*
+ * Executes table rows like init_registers() in "normal mode" against a register file:
+ * - Write(write flag bit 2): register = (register & ~(mask<<start)) | ((value & mask)<<start). mask = "number of bits"+1 wide
+ * - Else read(read flag bit 2): poll until ((register>>start) & mask) == value. Registers don't change by themselves so
+ *   a poll that doesn't match would spin forever. It is reported and execution continues as if it had matched.
+ * - Delay is summed.
+ * - Full null entry ends execution.
+ */
+
+typedef struct{
+    size_t row;
+    uint32_t address;
+    uint32_t expected;                      //Value field
+    uint32_t actual;                        //Shifted and masked register value
+} simulation_poll_type;
+
+typedef struct{
+    size_t rows_executed;
+    size_t terminate_row;                   //Row of the null entry. SIZE_MAX if execution ran to the end of the table
+    uint64_t delay_total;
+    size_t writes;
+    size_t polls;
+    simulation_poll_type *stuck_polls;      //Polls that would spin forever
+    size_t stuck_polls_count;
+    size_t stuck_polls_size;
+} simulation_result_type;
+
+/* Result buffers are reused between calls. Returns 0 on success, -1 if malloc() fails */
+int simulate_register_table(register_file_type *registers, const register_table_type *table, simulation_result_type *result);
+void free_simulation_result(simulation_result_type *result);
+
+
+/* TIMING */
+
+/*
+ * Boot time estimate of a table. Delay field is a countdown loop of a few instructions so its duration depends on the core clock,
+ * and the core clock changes within the table(DOZE -> SLOW -> NORMAL mode, PLL setup). Clock model describes where the core clock comes from:
+ * - Mode field selects clock of the core. Mode clock is fixed(ie. crystal) or CLOCK_MODE_PLL.
+ * - PLL output = reference_hz * fbdiv / (refdiv * postdiv1 * postdiv2 * pll_divider). Missing divider fields count as 1.
+ * Table is executed against a register file like simulate_register_table(). Clock is recomputed after every write to a model register.
+ * A phase is a run of rows with the same clock. The row that changes the clock belongs to the new phase as its delay runs on the new clock.
+ * Poll time(PLL lock etc.) isn't known and is not included.
+ */
+
+#define CLOCK_MODEL_MODES                           16
+#define CLOCK_MODE_NAME_LENGTH                      16
+#define CLOCK_MODE_PLL                              UINT32_MAX      //mode_hz: core runs from PLL
+
+typedef struct{
+    uint32_t address;
+    uint32_t start_bit;
+    uint32_t bits;                          //Field width. 0 = no field
+} clock_field_type;
+
+typedef struct{
+    uint32_t loop_cycles;                   //Core cycles per delay count
+    uint32_t row_cycles;                    //Core cycles per executed entry besides delay
+    clock_field_type mode;
+    uint32_t mode_hz[CLOCK_MODEL_MODES];    //Core clock per mode field value. 0 = unknown
+    char mode_name[CLOCK_MODEL_MODES][CLOCK_MODE_NAME_LENGTH];
+    uint32_t reference_hz;
+    clock_field_type fbdiv;
+    clock_field_type refdiv;
+    clock_field_type postdiv1;
+    clock_field_type postdiv2;
+    uint32_t pll_divider;                   //PLL to core divider. 0 counts as 1
+} clock_model_type;
+
+typedef struct{
+    size_t first_row;
+    size_t rows;
+    uint32_t mode;                          //Mode field value
+    uint32_t clock_hz;                      //0 = unknown. Time isn't counted
+    uint64_t delay;                         //Sum of delay fields
+    uint64_t cycles;
+    uint64_t nanoseconds;
+    size_t polls;
+} timing_phase_type;
+
+typedef struct{
+    uint64_t cycles;
+    uint64_t nanoseconds;
+} timing_row_type;
+
+typedef struct{
+    size_t rows_executed;
+    size_t terminate_row;                   //Row of the null entry. SIZE_MAX if execution ran to the end of the table
+    uint64_t delay_total;
+    uint64_t cycles_total;
+    uint64_t nanoseconds_total;
+    uint64_t unknown_clock_cycles;          //Cycles of phases without known clock
+    timing_phase_type *phases;
+    size_t phases_count;
+    size_t phases_size;
+    timing_row_type *rows;                  //Cost of executed rows
+    size_t rows_size;
+} timing_result_type;
+
+/* Result buffers are reused between calls. Returns 0 on success, -1 if malloc() fails */
+int estimate_register_table_timing(register_file_type *registers, const clock_model_type *model, const register_table_type *table, timing_result_type *result);
+void free_timing_result(timing_result_type *result);
+
+
+/* OPTIMIZATION */
+
+/*
+ * Shorter equivalent table by init_registers() write and read semantics. Rows before the first null entry are optimized:
+ * - Dead write: every bit the write sets is overwritten by later writes to the same address before the next barrier.
+ * - Merged write: write is folded into the directly following write to the same address when the union of their bits
+ *   is one contiguous field. Register isn't written with the intermediate value.
+ * - Folded delay: delay only row is added to the delay of the previous row. Delay is performed after the operation of a row.
+ *   Address of delay only row isn't used so null address doesn't prevent folding.
+ * Barriers are read-polls, rows with non-zero delay(delay runs after the write so the written value is observed) and rows
+ * with invalid flags or attribute errors. Barriers are kept as they are and writes are never moved across them.
+ * Rows are never reordered. Null entry is kept, rows after it are unreachable and dropped.
+ */
+
+#define OPTIMIZE_KEPT                               0
+#define OPTIMIZE_DEAD_WRITE                         1
+#define OPTIMIZE_MERGED_WRITE                       2       //Merged into output_row
+#define OPTIMIZE_FOLDED_DELAY                       3       //Delay added to output_row
+#define OPTIMIZE_UNREACHABLE                        4       //After null entry
+
+typedef struct{
+    uint8_t *actions;                       //OPTIMIZE_* per input row
+    uint32_t *output_row;                   //Row of optimized table the input row ended up in. UINT32_MAX if dropped
+    size_t rows_size;
+    size_t dead_writes;
+    size_t merged_writes;
+    size_t folded_delays;
+    size_t unreachable_rows;
+    uint64_t *keys;                         //Work buffer
+    size_t keys_size;
+} optimization_result_type;
+
+/* Write optimized rows of table into optimized(reused). Result buffers are reused between calls. Returns 0 on success, -1 if malloc() fails */
+int optimize_register_table(const register_table_type *table, register_table_type *optimized, optimization_result_type *result);
+void free_optimization_result(optimization_result_type *result);
+
+#endif
@@ -0,0 +1,293 @@
+/*
+ *            DO WHAT THE FUCK YOU WANT TO PUBLIC LICENSE
+ *                    Version 2, December 2004
+ *
+ * Copyright (C) 2004 Sam Hocevar <sam@hocevar.net>
+ *
+ * Everyone is permitted to copy and distribute verbatim or modified
+ * copies of this license document, and changing it is allowed as long
+ * as the name is changed.
+ *
+ *            DO WHAT THE FUCK YOU WANT TO PUBLIC LICENSE
+ *   TERMS AND CONDITIONS FOR COPYING, DISTRIBUTION AND MODIFICATION
+ *
+ *  0. You just DO WHAT THE FUCK YOU WANT TO.
+ *
+ *
+ *
+ *
+ * Soc-tablegen
+ * Build time generator of built in SoC tables for hisi-initregtable-parser
+ *
+ * Usage: soc-tablegen OutputHeader SocCsvFile [SocCsvFile ...]
+ *
+ * Every SoC CSV file(same format as "csv" SoC type, see hisi-initregtable-parser.c) is turned into constant C tables:
+ * - Registers sorted by base address. Sort is stable so "first one in the table wins" on equal base still holds.
+ * - Register index(segments and radix buckets) built with build_soc_register_index() so nothing is indexed at run time.
+ * SoC type name is the CSV file name without directory and ".csv"(ie. csv/hi3516a_d.csv -> hi3516a_d).
+ * Output header defines SOC_TABLES_LIST: soc_list[] entries of all given files in command line order.
+ */
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "hisi-initregtable.h"
+
+#define CSV_OMIT_LINES_COUNT 1              //Header line
+
+
+typedef struct{
+    char *name;                             //SoC type name
+    char *identifier;                       //C identifier
+    soc_register_type *registers;
+    size_t registers_count;
+    soc_register_index_type index;
+} soc_table_type;
+
+
+/* Number field followed by delimiter. Returns pointer after delimiter or NULL */
+static char *parse_number_field(char *ptr, uint32_t *value){
+    char *end;
+    while((*ptr == ' ') || (*ptr == '\t')){
+        ptr++;
+    }
+    if(!isdigit((uint8_t)*ptr)){
+        return NULL;
+    }
+    *value = strtoul(ptr, &end, 0);
+    ptr = strchr(end, ',');
+    return ptr ? (ptr + 1) : NULL;
+}
+
+static int register_base_compare(const void *a, const void *b){
+    const soc_register_type *register_a = a;
+    const soc_register_type *register_b = b;
+    return (register_a->base_address > register_b->base_address) - (register_a->base_address < register_b->base_address);
+}
+
+/* Returns 0 or -1 (printed to stderr) */
+static int load_csv(const char *filename, soc_table_type *table){
+    FILE *fptr;
+    char *line = NULL;
+    size_t line_size = 0;
+    size_t line_number = 0;
+    size_t registers_size = 0;
+    size_t length;
+    char *ptr;
+    char *name_end;
+    uint32_t base_address;
+    uint32_t end_address;
+    soc_register_type *temp_ptr;
+    int result = 0;
+
+    fptr = fopen(filename, "r");
+    if(fptr == NULL){
+        fprintf(stderr, "%s: Can't open\n", filename);
+        return -1;
+    }
+    while(getline(&line, &line_size, fptr) >= 0){
+        line_number++;
+        if(line_number <= CSV_OMIT_LINES_COUNT){
+            continue;
+        }
+        length = strlen(line);
+        while(length && ((line[length-1] == '\n') || (line[length-1] == '\r') || (line[length-1] == ' ') || (line[length-1] == '\t'))){
+            length--;
+        }
+        line[length] = '\0';
+        name_end = &line[length];
+        ptr = line;
+        while((*ptr == ' ') || (*ptr == '\t')){
+            ptr++;
+        }
+        if(ptr == name_end){
+            continue;                       //Empty line
+        }
+
+        /* Fields: base address, end address, name */
+        ptr = parse_number_field(ptr, &base_address);
+        if(ptr){
+            ptr = parse_number_field(ptr, &end_address);
+        }
+        while(ptr && ((*ptr == ' ') || (*ptr == '\t'))){
+            ptr++;
+        }
+        if((ptr == NULL) || (ptr == name_end)){
+            fprintf(stderr, "%s:%zu: CSV parsing error\n", filename, line_number);
+            result = -1;
+            break;
+        }
+
+        if(table->registers_count == registers_size){
+            registers_size = registers_size ? (registers_size * 2) : 256;
+            temp_ptr = realloc(table->registers, (sizeof(soc_register_type) * registers_size));
+            if(temp_ptr == NULL){
+                result = -1;
+                break;
+            }
+            table->registers = temp_ptr;
+        }
+        table->registers[table->registers_count].base_address = base_address;
+        table->registers[table->registers_count].end_address = end_address;
+        table->registers[table->registers_count].register_name = strdup(ptr);
+        if(table->registers[table->registers_count].register_name == NULL){
+            result = -1;
+            break;
+        }
+        table->registers_count++;
+    }
+    free(line);
+    fclose(fptr);
+    if(!result && (table->registers_count == 0)){
+        fprintf(stderr, "%s: No registers\n", filename);
+        result = -1;
+    }
+    return result;
+}
+
+/* SoC type name and C identifier from file name */
+static int name_table(const char *filename, soc_table_type *table){
+    const char *name = strrchr(filename, '/');
+    size_t length;
+
+    name = name ? (name + 1) : filename;
+    length = strlen(name);
+    if((length > 4) && (strcmp(&name[length-4], ".csv") == 0)){
+        length -= 4;
+    }
+    table->name = strndup(name, length);
+    table->identifier = strndup(name, length);
+    if((table->name == NULL) || (table->identifier == NULL)){
+        return -1;
+    }
+    for(size_t i = 0; i < length; i++){
+        if(!isalnum((uint8_t)table->identifier[i])){
+            table->identifier[i] = '_';
+        }
+    }
+    return 0;
+}
+
+static void print_c_string(FILE *fptr, const char *str){
+    fputc('"', fptr);
+    for(; *str; str++){
+        if((*str == '"') || (*str == '\\')){
+            fprintf(fptr, "\\%c", *str);
+        }
+        else if(isprint((uint8_t)*str)){
+            fputc(*str, fptr);
+        }
+        else{
+            fprintf(fptr, "\\%03o", (uint8_t)*str);
+        }
+    }
+    fputc('"', fptr);
+}
+
+static void print_table(FILE *fptr, const char *filename, const soc_table_type *table){
+    fprintf(fptr, "/* %s - %s */\n", table->name, filename);
+
+    fprintf(fptr, "static const soc_register_type soc_%s_registers[] = {\n", table->identifier);
+    for(size_t i = 0; i < table->registers_count; i++){
+        fprintf(fptr, "    {0x%08x, 0x%08x, ", table->registers[i].base_address, table->registers[i].end_address);
+        print_c_string(fptr, table->registers[i].register_name);
+        fprintf(fptr, "}%s\n", ((i + 1) < table->registers_count) ? "," : "");
+    }
+    fprintf(fptr, "};\n\n");
+
+    fprintf(fptr, "static const soc_register_segment_type soc_%s_segments[] = {\n", table->identifier);
+    for(uint32_t i = 0; i < table->index.segments_count; i++){
+        fprintf(fptr, "    {0x%08x, 0x%08x, %u}%s\n", table->index.segments[i].start_address, table->index.segments[i].end_address,
+                table->index.segments[i].register_index, ((i + 1) < table->index.segments_count) ? "," : "");
+    }
+    fprintf(fptr, "};\n\n");
+
+    fprintf(fptr, "static const soc_register_index_type soc_%s_index = {\n", table->identifier);
+    fprintf(fptr, "    (soc_register_segment_type*)soc_%s_segments,\n", table->identifier);
+    fprintf(fptr, "    %u,\n    {", table->index.segments_count);
+    for(uint32_t i = 0; i <= SOC_REGISTER_INDEX_RADIX_COUNT; i++){
+        fprintf(fptr, "%s%u%s", ((i % 16) ? "" : "\n        "), table->index.radix[i], ((i < SOC_REGISTER_INDEX_RADIX_COUNT) ? "," : ""));
+    }
+    fprintf(fptr, "\n    }\n};\n\n\n");
+}
+
+
+int main(int argc, char **argv){
+    soc_table_type *tables;
+    soc_register_type *sorted;
+    FILE *fptr;
+    int i;
+
+    if(argc < 3){
+        fprintf(stderr, "Usage: soc-tablegen OutputHeader SocCsvFile [SocCsvFile ...]\n");
+        return 1;
+    }
+    tables = calloc((argc - 2), sizeof(soc_table_type));
+    if(tables == NULL){
+        return 1;
+    }
+
+    for(i = 2; i < argc; i++){
+        soc_table_type *table = &tables[i-2];
+        if((name_table(argv[i], table) != 0) || (load_csv(argv[i], table) != 0)){
+            return 1;
+        }
+        for(int j = 2; j < i; j++){
+            if(strcmp(tables[j-2].name, table->name) == 0){
+                fprintf(stderr, "%s: SoC type %s is already defined\n", argv[i], table->name);
+                return 1;
+            }
+        }
+
+        /* Stable sort: equal bases keep their CSV order */
+        sorted = malloc(sizeof(soc_register_type) * table->registers_count);
+        if(sorted == NULL){
+            return 1;
+        }
+        for(size_t j = 0; j < table->registers_count; j++){
+            sorted[j] = table->registers[j];
+        }
+        for(size_t j = 1; j < table->registers_count; j++){            //Insertion sort. CSV files are small and mostly ordered
+            soc_register_type temp = sorted[j];
+            size_t k = j;
+            while(k && (register_base_compare(&sorted[k-1], &temp) > 0)){
+                sorted[k] = sorted[k-1];
+                k--;
+            }
+            sorted[k] = temp;
+        }
+        free(table->registers);
+        table->registers = sorted;
+
+        if(build_soc_register_index(&table->index, table->registers, table->registers_count) != 0){
+            fprintf(stderr, "%s: Index malloc failed\n", argv[i]);
+            return 1;
+        }
+    }
+
+    fptr = fopen(argv[1], "w");
+    if(fptr == NULL){
+        fprintf(stderr, "%s: Can't open\n", argv[1]);
+        return 1;
+    }
+    fprintf(fptr, "/* Built in SoC tables. Generated by soc-tablegen from csv/. Do not edit */\n\n");
+    for(i = 2; i < argc; i++){
+        print_table(fptr, argv[i], &tables[i-2]);
+    }
+    fprintf(fptr, "#define SOC_TABLES_LIST");
+    for(i = 2; i < argc; i++){
+        fprintf(fptr, " \\\n    {soc_%s_registers, %zu, ", tables[i-2].identifier, tables[i-2].registers_count);
+        print_c_string(fptr, tables[i-2].name);
+        fprintf(fptr, ", &soc_%s_index},", tables[i-2].identifier);
+    }
+    fprintf(fptr, "\n");
+    if(fclose(fptr) != 0){
+        fprintf(stderr, "%s: Write failed\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}